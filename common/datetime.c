@@ -3,6 +3,7 @@
 
 #include <openenclave/internal/datetime.h>
 #include <openenclave/internal/raise.h>
+#include <openenclave/internal/time.h>
 
 #define UNIX_EPOCH_YEAR (1970)
 
@@ -221,3 +222,51 @@ int32_t oe_datetime_compare(
 
     return 0;
 }
+
+oe_result_t oe_datetime_now(oe_datetime_t* datetime)
+{
+    oe_result_t result = OE_FAILURE;
+    uint64_t milliseconds = oe_get_time();
+    uint64_t seconds;
+    uint64_t days;
+    uint64_t era;
+    uint64_t day_of_era;
+    uint64_t year_of_era;
+    uint64_t day_of_year;
+    uint64_t mp;
+
+    if (datetime == NULL)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (milliseconds == (uint64_t)-1)
+        OE_RAISE(OE_FAILURE);
+
+    seconds = milliseconds / 1000;
+    days = seconds / 86400;
+
+    datetime->hours = (uint32_t)(seconds % 86400 / 3600);
+    datetime->minutes = (uint32_t)(seconds % 3600 / 60);
+    datetime->seconds = (uint32_t)(seconds % 60);
+
+    // Convert days since the epoch to a civil date, counting eras of 400
+    // years from 0000-03-01 so that the leap day ends the year.
+    days += 719468;
+    era = days / 146097;
+    day_of_era = days - era * 146097;
+    year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 -
+                   day_of_era / 146096) /
+                  365;
+    day_of_year =
+        day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    mp = (5 * day_of_year + 2) / 153;
+
+    datetime->day = (uint32_t)(day_of_year - (153 * mp + 2) / 5 + 1);
+    datetime->month = (uint32_t)(mp < 10 ? mp + 3 : mp - 9);
+    datetime->year =
+        (uint32_t)(year_of_era + era * 400 + (datetime->month <= 2 ? 1 : 0));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
@@ -99,6 +99,10 @@ const char* oe_result_str(oe_result_t result)
             return "OE_UNSUPPORTED_ENCLAVE_IMAGE";
         case OE_VERIFY_CRL_EXPIRED:
             return "OE_VERIFY_CRL_EXPIRED";
+        case OE_CONTEXT_SWITCHLESS_OCALL_MISSED:
+            return "OE_CONTEXT_SWITCHLESS_OCALL_MISSED";
+        case OE_CONTEXT_SWITCHLESS_ECALL_MISSED:
+            return "OE_CONTEXT_SWITCHLESS_ECALL_MISSED";
         case __OE_RESULT_MAX:
             break;
     }
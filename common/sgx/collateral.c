@@ -0,0 +1,585 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "collateral.h"
+#include <openenclave/bits/safecrt.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/report.h>
+#include <openenclave/internal/trace.h>
+#include "../common.h"
+#include "revocation.h"
+
+#ifdef OE_BUILD_ENCLAVE
+#include <openenclave/internal/thread.h>
+#else
+#include "../../host/hostthread.h"
+#endif
+
+#ifdef OE_USE_LIBSGX
+
+#ifdef OE_BUILD_ENCLAVE
+typedef oe_mutex_t _lock_t;
+#define _LOCK_INITIALIZER OE_MUTEX_INITIALIZER
+#else
+typedef oe_mutex _lock_t;
+#define _LOCK_INITIALIZER OE_H_MUTEX_INITIALIZER
+#endif
+
+typedef struct _cache_entry
+{
+    /* Must be first: oe_collateral_t pointers are cast back to entries */
+    oe_collateral_t collateral;
+
+    /* Held by the caller between oe_acquire_collateral() and release */
+    _lock_t lock;
+
+    /* Number of parsed objects to free */
+    bool has_tcb_issuer_chain;
+    uint32_t num_crls;
+    uint32_t num_crl_issuer_chains;
+
+    /* Fields below are protected by _cache_lock */
+    uint64_t last_used;
+    uint32_t refs;
+    bool cached;
+} _cache_entry_t;
+
+typedef struct _pck_chain_entry
+{
+    bool used;
+    OE_SHA256 hash;
+    uint8_t leaf_key_pem[OE_PCK_LEAF_KEY_PEM_MAX];
+    size_t leaf_key_pem_size;
+    oe_datetime_t issue_date;
+    oe_datetime_t expiry;
+    uint64_t last_used;
+} _pck_chain_entry_t;
+
+/* Both caches and the counters are protected by _cache_lock */
+static _cache_entry_t* _cache[OE_COLLATERAL_CACHE_SIZE];
+static _pck_chain_entry_t _pck_chains[OE_PCK_CHAIN_CACHE_SIZE];
+static _lock_t _cache_lock = _LOCK_INITIALIZER;
+static uint64_t _cache_clock;
+static oe_collateral_cache_stats_t _cache_stats;
+
+static char* _strdup(const char* str)
+{
+    size_t size = oe_strlen(str) + 1;
+    char* copy = (char*)oe_malloc(size);
+
+    if (copy && oe_memcpy_s(copy, size, str, size) != OE_OK)
+    {
+        oe_free(copy);
+        copy = NULL;
+    }
+
+    return copy;
+}
+
+static void _free_entry(_cache_entry_t* entry)
+{
+    oe_collateral_t* collateral = &entry->collateral;
+
+    for (uint32_t i = 0; i < entry->num_crls; i++)
+        oe_crl_free(&collateral->crls[i]);
+
+    for (uint32_t i = 0; i < entry->num_crl_issuer_chains; i++)
+        oe_cert_chain_free(&collateral->crl_issuer_chain[i]);
+
+    if (entry->has_tcb_issuer_chain)
+        oe_cert_chain_free(&collateral->tcb_issuer_chain);
+
+    for (uint32_t i = 0; i < collateral->num_crl_urls; i++)
+        oe_free(collateral->crl_urls[i]);
+
+    oe_free(collateral->tcb_info);
+    oe_mutex_destroy(&entry->lock);
+    oe_free(entry);
+}
+
+static bool _entry_matches(
+    const _cache_entry_t* entry,
+    const uint8_t fmspc[6],
+    const char* const* crl_urls,
+    uint32_t num_crl_urls)
+{
+    const oe_collateral_t* collateral = &entry->collateral;
+
+    for (size_t i = 0; i < sizeof(collateral->fmspc); i++)
+    {
+        if (collateral->fmspc[i] != fmspc[i])
+            return false;
+    }
+
+    if (collateral->num_crl_urls != num_crl_urls)
+        return false;
+
+    for (uint32_t i = 0; i < num_crl_urls; i++)
+    {
+        if (oe_strcmp(collateral->crl_urls[i], crl_urls[i]) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+static bool _is_expired(const oe_datetime_t* expiry)
+{
+    oe_datetime_t now;
+
+    // Without a clock, nothing can be reused.
+    if (oe_datetime_now(&now) != OE_OK)
+        return true;
+
+    return oe_datetime_compare(&now, expiry) >= 0;
+}
+
+static bool _hash_equal(const OE_SHA256* hash1, const OE_SHA256* hash2)
+{
+    for (size_t i = 0; i < sizeof(hash1->buf); i++)
+    {
+        if (hash1->buf[i] != hash2->buf[i])
+            return false;
+    }
+
+    return true;
+}
+
+/* Drop an entry from the cache. Returns the entry if the caller must free it
+ * (after releasing _cache_lock) or NULL if it is still in use. */
+static _cache_entry_t* _uncache_entry(size_t index)
+{
+    _cache_entry_t* entry = _cache[index];
+
+    _cache[index] = NULL;
+    entry->cached = false;
+
+    return entry->refs == 0 ? entry : NULL;
+}
+
+/* Fetch and parse the collateral and verify the signature of the TCB info */
+static oe_result_t _fetch_entry(
+    const uint8_t fmspc[6],
+    const char* const* crl_urls,
+    uint32_t num_crl_urls,
+    _cache_entry_t** entry_out)
+{
+    oe_result_t result = OE_FAILURE;
+    oe_get_revocation_info_args_t args = {0};
+    _cache_entry_t* entry = NULL;
+    oe_collateral_t* collateral = NULL;
+    oe_tcb_level_t tcb_level = {{0}};
+    oe_parsed_tcb_info_t parsed_tcb_info = {0};
+    oe_datetime_t* expiry = NULL;
+
+    OE_CHECK(oe_memcpy_s(args.fmspc, sizeof(args.fmspc), fmspc, 6));
+    for (uint32_t i = 0; i < num_crl_urls; i++)
+        args.crl_urls[i] = crl_urls[i];
+    args.num_crl_urls = num_crl_urls;
+
+    OE_CHECK(oe_get_revocation_info(&args));
+
+    entry = (_cache_entry_t*)oe_calloc(1, sizeof(*entry));
+    if (entry == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (oe_mutex_init(&entry->lock) != 0)
+    {
+        oe_free(entry);
+        entry = NULL;
+        OE_RAISE(OE_FAILURE);
+    }
+
+    collateral = &entry->collateral;
+    expiry = &collateral->expiry;
+
+    // Key.
+    OE_CHECK(oe_memcpy_s(
+        collateral->fmspc, sizeof(collateral->fmspc), fmspc, 6));
+    for (uint32_t i = 0; i < num_crl_urls; i++)
+    {
+        collateral->crl_urls[i] = _strdup(crl_urls[i]);
+        if (collateral->crl_urls[i] == NULL)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+        collateral->num_crl_urls++;
+    }
+
+    // TCB info and its signing chain.
+    collateral->tcb_info = (uint8_t*)oe_malloc(args.tcb_info_size);
+    if (collateral->tcb_info == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+    OE_CHECK(oe_memcpy_s(
+        collateral->tcb_info,
+        args.tcb_info_size,
+        args.tcb_info,
+        args.tcb_info_size));
+    collateral->tcb_info_size = args.tcb_info_size;
+
+    OE_CHECK(oe_cert_chain_read_pem(
+        &collateral->tcb_issuer_chain,
+        args.tcb_issuer_chain,
+        args.tcb_issuer_chain_size));
+    entry->has_tcb_issuer_chain = true;
+
+    // Read CRLs for each cert other than root. If any CRL is missing, the read
+    // will error out.
+    for (uint32_t i = 0; i < num_crl_urls; i++)
+    {
+        OE_CHECK(oe_crl_read_der(
+            &collateral->crls[i], args.crl[i], args.crl_size[i]));
+        entry->num_crls++;
+
+        OE_CHECK(oe_cert_chain_read_pem(
+            &collateral->crl_issuer_chain[i],
+            args.crl_issuer_chain[i],
+            args.crl_issuer_chain_size[i]));
+        entry->num_crl_issuer_chains++;
+
+        OE_TRACE_VERBOSE(
+            "CRL certificate[%d]: \n[%s]\n", i, args.crl_issuer_chain[i]);
+
+        OE_CHECK(oe_crl_get_update_dates(
+            &collateral->crls[i],
+            &collateral->crl_this_update[i],
+            &collateral->crl_next_update[i]));
+    }
+
+    // Parse the TCB info against the highest possible platform TCB level,
+    // which is only done here to locate the signed part of the JSON. The
+    // status of the actual platform is determined by each verification.
+    for (uint32_t i = 0; i < OE_COUNTOF(tcb_level.sgx_tcb_comp_svn); i++)
+        tcb_level.sgx_tcb_comp_svn[i] = OE_UINT8_MAX;
+    tcb_level.pce_svn = OE_UINT16_MAX;
+    tcb_level.status = OE_TCB_LEVEL_STATUS_UNKNOWN;
+
+    result = oe_parse_tcb_info_json(
+        collateral->tcb_info,
+        collateral->tcb_info_size,
+        &tcb_level,
+        &parsed_tcb_info);
+    if (result != OE_OK && result != OE_TCB_LEVEL_INVALID)
+        OE_RAISE(result);
+
+    OE_CHECK(oe_verify_ecdsa256_signature(
+        parsed_tcb_info.tcb_info_start,
+        parsed_tcb_info.tcb_info_size,
+        (sgx_ecdsa256_signature_t*)parsed_tcb_info.signature,
+        &collateral->tcb_issuer_chain));
+
+    collateral->tcb_issue_date = parsed_tcb_info.issue_date;
+    collateral->tcb_next_update = parsed_tcb_info.next_update;
+
+    // The entry is good until any part of it is due to be updated.
+    *expiry = collateral->tcb_next_update;
+    for (uint32_t i = 0; i < num_crl_urls; i++)
+    {
+        if (oe_datetime_compare(&collateral->crl_next_update[i], expiry) < 0)
+            *expiry = collateral->crl_next_update[i];
+    }
+
+    *entry_out = entry;
+    entry = NULL;
+    result = OE_OK;
+
+done:
+    if (entry)
+        _free_entry(entry);
+
+    oe_cleanup_get_revocation_info_args(&args);
+
+    return result;
+}
+
+oe_result_t oe_acquire_collateral(
+    const uint8_t fmspc[6],
+    const char* const* crl_urls,
+    uint32_t num_crl_urls,
+    oe_collateral_t** collateral)
+{
+    oe_result_t result = OE_FAILURE;
+    _cache_entry_t* entry = NULL;
+    _cache_entry_t* dropped = NULL;
+    size_t slot;
+
+    if (collateral)
+        *collateral = NULL;
+
+    if (fmspc == NULL || crl_urls == NULL || num_crl_urls == 0 ||
+        num_crl_urls > OE_COLLATERAL_MAX_CRLS || collateral == NULL)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (uint32_t i = 0; i < num_crl_urls; i++)
+    {
+        if (crl_urls[i] == NULL)
+            OE_RAISE(OE_INVALID_PARAMETER);
+    }
+
+    /* Look for an entry that can be reused */
+    oe_mutex_lock(&_cache_lock);
+    {
+        for (size_t i = 0; i < OE_COUNTOF(_cache); i++)
+        {
+            if (_cache[i] &&
+                _entry_matches(_cache[i], fmspc, crl_urls, num_crl_urls))
+            {
+                if (_is_expired(&_cache[i]->collateral.expiry))
+                {
+                    _cache_stats.expirations++;
+                    dropped = _uncache_entry(i);
+                }
+                else
+                {
+                    entry = _cache[i];
+                    entry->refs++;
+                    entry->last_used = ++_cache_clock;
+                }
+                break;
+            }
+        }
+
+        if (entry)
+            _cache_stats.hits++;
+        else
+            _cache_stats.misses++;
+    }
+    oe_mutex_unlock(&_cache_lock);
+
+    if (dropped)
+        _free_entry(dropped);
+
+    if (entry)
+    {
+        oe_mutex_lock(&entry->lock);
+        *collateral = &entry->collateral;
+        result = OE_OK;
+        goto done;
+    }
+
+    /* Fetch without holding the cache lock, since this leaves the enclave */
+    OE_CHECK(_fetch_entry(fmspc, crl_urls, num_crl_urls, &entry));
+
+    oe_mutex_lock(&_cache_lock);
+    {
+        dropped = NULL;
+
+        /* Replace an entry another thread inserted meanwhile, or else use a
+         * free slot, or else evict the least recently used entry */
+        for (slot = 0; slot < OE_COUNTOF(_cache); slot++)
+        {
+            if (_cache[slot] &&
+                _entry_matches(_cache[slot], fmspc, crl_urls, num_crl_urls))
+                break;
+        }
+
+        if (slot == OE_COUNTOF(_cache))
+        {
+            slot = 0;
+            for (size_t i = 0; i < OE_COUNTOF(_cache) && _cache[slot]; i++)
+            {
+                if (_cache[i] == NULL ||
+                    _cache[i]->last_used < _cache[slot]->last_used)
+                    slot = i;
+            }
+
+            if (_cache[slot])
+                _cache_stats.evictions++;
+        }
+
+        if (_cache[slot])
+            dropped = _uncache_entry(slot);
+
+        entry->refs = 1;
+        entry->last_used = ++_cache_clock;
+        entry->cached = true;
+        _cache[slot] = entry;
+    }
+    oe_mutex_unlock(&_cache_lock);
+
+    if (dropped)
+        _free_entry(dropped);
+
+    oe_mutex_lock(&entry->lock);
+    *collateral = &entry->collateral;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+void oe_release_collateral(oe_collateral_t* collateral)
+{
+    _cache_entry_t* entry = (_cache_entry_t*)collateral;
+    bool free_entry = false;
+
+    if (entry == NULL)
+        return;
+
+    oe_mutex_unlock(&entry->lock);
+
+    oe_mutex_lock(&_cache_lock);
+    {
+        entry->refs--;
+        free_entry = !entry->cached && entry->refs == 0;
+    }
+    oe_mutex_unlock(&_cache_lock);
+
+    if (free_entry)
+        _free_entry(entry);
+}
+
+oe_result_t oe_find_verified_pck_chain(
+    const OE_SHA256* hash,
+    uint8_t* leaf_key_pem,
+    size_t* leaf_key_pem_size,
+    oe_datetime_t* issue_date)
+{
+    oe_result_t result = OE_NOT_FOUND;
+
+    if (hash == NULL || leaf_key_pem == NULL || leaf_key_pem_size == NULL ||
+        issue_date == NULL)
+        return OE_INVALID_PARAMETER;
+
+    oe_mutex_lock(&_cache_lock);
+    {
+        for (size_t i = 0; i < OE_COUNTOF(_pck_chains); i++)
+        {
+            _pck_chain_entry_t* entry = &_pck_chains[i];
+
+            if (!entry->used || !_hash_equal(&entry->hash, hash))
+                continue;
+
+            if (_is_expired(&entry->expiry))
+            {
+                entry->used = false;
+                _cache_stats.expirations++;
+            }
+            else if (entry->leaf_key_pem_size <= *leaf_key_pem_size)
+            {
+                // The size was checked above and cannot fail.
+                oe_memcpy_s(
+                    leaf_key_pem,
+                    *leaf_key_pem_size,
+                    entry->leaf_key_pem,
+                    entry->leaf_key_pem_size);
+                *leaf_key_pem_size = entry->leaf_key_pem_size;
+                *issue_date = entry->issue_date;
+                entry->last_used = ++_cache_clock;
+                result = OE_OK;
+            }
+            break;
+        }
+
+        if (result == OE_OK)
+            _cache_stats.pck_chain_hits++;
+        else
+            _cache_stats.pck_chain_misses++;
+    }
+    oe_mutex_unlock(&_cache_lock);
+
+    return result;
+}
+
+oe_result_t oe_add_verified_pck_chain(
+    const OE_SHA256* hash,
+    const uint8_t* leaf_key_pem,
+    size_t leaf_key_pem_size,
+    const oe_datetime_t* issue_date,
+    const oe_datetime_t* expiry)
+{
+    oe_result_t result = OE_FAILURE;
+    _pck_chain_entry_t* entry = NULL;
+
+    if (hash == NULL || leaf_key_pem == NULL || issue_date == NULL ||
+        expiry == NULL)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (leaf_key_pem_size > OE_PCK_LEAF_KEY_PEM_MAX)
+        OE_RAISE(OE_BUFFER_TOO_SMALL);
+
+    oe_mutex_lock(&_cache_lock);
+    {
+        /* Replace the same chain, or else use a free slot, or else evict the
+         * least recently used chain */
+        for (size_t i = 0; i < OE_COUNTOF(_pck_chains) && !entry; i++)
+        {
+            if (_pck_chains[i].used && _hash_equal(&_pck_chains[i].hash, hash))
+                entry = &_pck_chains[i];
+        }
+
+        for (size_t i = 0; i < OE_COUNTOF(_pck_chains) && !entry; i++)
+        {
+            if (!_pck_chains[i].used)
+                entry = &_pck_chains[i];
+        }
+
+        if (!entry)
+        {
+            entry = &_pck_chains[0];
+            for (size_t i = 1; i < OE_COUNTOF(_pck_chains); i++)
+            {
+                if (_pck_chains[i].last_used < entry->last_used)
+                    entry = &_pck_chains[i];
+            }
+            _cache_stats.evictions++;
+        }
+
+        entry->used = true;
+        entry->hash = *hash;
+        oe_memcpy_s(
+            entry->leaf_key_pem,
+            sizeof(entry->leaf_key_pem),
+            leaf_key_pem,
+            leaf_key_pem_size);
+        entry->leaf_key_pem_size = leaf_key_pem_size;
+        entry->issue_date = *issue_date;
+        entry->expiry = *expiry;
+        entry->last_used = ++_cache_clock;
+    }
+    oe_mutex_unlock(&_cache_lock);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+void oe_get_collateral_cache_stats(oe_collateral_cache_stats_t* stats)
+{
+    if (stats == NULL)
+        return;
+
+    oe_mutex_lock(&_cache_lock);
+    *stats = _cache_stats;
+    oe_mutex_unlock(&_cache_lock);
+}
+
+void oe_clear_collateral_cache(void)
+{
+    _cache_entry_t* dropped[OE_COLLATERAL_CACHE_SIZE];
+    size_t num_dropped = 0;
+
+    oe_mutex_lock(&_cache_lock);
+    {
+        for (size_t i = 0; i < OE_COUNTOF(_cache); i++)
+        {
+            if (_cache[i])
+            {
+                _cache_entry_t* entry = _uncache_entry(i);
+                if (entry)
+                    dropped[num_dropped++] = entry;
+            }
+        }
+
+        for (size_t i = 0; i < OE_COUNTOF(_pck_chains); i++)
+            _pck_chains[i].used = false;
+
+        oe_memset_s(
+            &_cache_stats, sizeof(_cache_stats), 0, sizeof(_cache_stats));
+    }
+    oe_mutex_unlock(&_cache_lock);
+
+    for (size_t i = 0; i < num_dropped; i++)
+        _free_entry(dropped[i]);
+}
+
+#endif
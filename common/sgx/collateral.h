@@ -0,0 +1,147 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_COMMON_COLLATERAL_H
+#define _OE_COMMON_COLLATERAL_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+#include <openenclave/internal/cert.h>
+#include <openenclave/internal/crl.h>
+#include <openenclave/internal/datetime.h>
+#include <openenclave/internal/sha.h>
+#include "tcbinfo.h"
+
+OE_EXTERNC_BEGIN
+
+#ifdef OE_USE_LIBSGX
+
+/*
+**==============================================================================
+**
+** Revocation collateral cache
+**
+**     oe_enforce_revocation() needs the TCB info, the CRLs and the issuer
+**     chains of the platform that generated the quote. Fetching them goes
+**     through the quote provider (and an OCALL inside the enclave), so they
+**     are cached here, keyed by FMSPC and CRL distribution point URLs, in the
+**     parsed form that verification uses. The signature of the TCB info is
+**     checked once, when the collateral is fetched.
+**
+**     An entry expires at the earliest nextUpdate of its TCB info and CRLs,
+**     after which it is fetched again. Least recently used entries are
+**     evicted when the cache is full.
+**
+**     PCK certificate chains that passed verification against the root of
+**     trust and the collateral are cached as well, keyed by the SHA-256 of
+**     their PEM encoding, until the collateral they were checked against
+**     expires. A quote whose chain is found only needs its signatures
+**     checked with the cached public key of the leaf certificate.
+**
+**==============================================================================
+*/
+
+#define OE_COLLATERAL_CACHE_SIZE 64
+#define OE_COLLATERAL_MAX_CRLS 3
+#define OE_PCK_CHAIN_CACHE_SIZE 64
+#define OE_PCK_LEAF_KEY_PEM_MAX 256
+
+typedef struct _oe_collateral
+{
+    /* Key */
+    uint8_t fmspc[6];
+    char* crl_urls[OE_COLLATERAL_MAX_CRLS];
+    uint32_t num_crl_urls;
+
+    /* TCB info JSON (signature already verified) and its signing chain */
+    uint8_t* tcb_info;
+    size_t tcb_info_size;
+    oe_cert_chain_t tcb_issuer_chain;
+    oe_datetime_t tcb_issue_date;
+    oe_datetime_t tcb_next_update;
+
+    /* CRLs and their issuer chains, in the order of crl_urls */
+    oe_crl_t crls[OE_COLLATERAL_MAX_CRLS];
+    oe_cert_chain_t crl_issuer_chain[OE_COLLATERAL_MAX_CRLS];
+    oe_datetime_t crl_this_update[OE_COLLATERAL_MAX_CRLS];
+    oe_datetime_t crl_next_update[OE_COLLATERAL_MAX_CRLS];
+
+    /* Earliest of tcb_next_update and crl_next_update[] */
+    oe_datetime_t expiry;
+} oe_collateral_t;
+
+typedef struct _oe_collateral_cache_stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t expirations;
+    uint64_t evictions;
+    uint64_t pck_chain_hits;
+    uint64_t pck_chain_misses;
+} oe_collateral_cache_stats_t;
+
+/**
+ * Get the collateral for the given FMSPC and CRL distribution points, from
+ * the cache if it holds an entry that has not expired, otherwise by calling
+ * oe_get_revocation_info().
+ *
+ * The collateral is returned locked for exclusive use by the caller, since
+ * the parsed certificates and CRLs may not be used concurrently. It remains
+ * valid until it is passed to oe_release_collateral().
+ */
+oe_result_t oe_acquire_collateral(
+    const uint8_t fmspc[6],
+    const char* const* crl_urls,
+    uint32_t num_crl_urls,
+    oe_collateral_t** collateral);
+
+/**
+ * Unlock collateral obtained with oe_acquire_collateral().
+ */
+void oe_release_collateral(oe_collateral_t* collateral);
+
+/**
+ * Look up a verified PCK certificate chain by the SHA-256 of its PEM data.
+ *
+ * @param hash SHA-256 of the PEM certificate chain.
+ * @param leaf_key_pem Receives the PEM public key of the leaf certificate.
+ * @param leaf_key_pem_size Size of leaf_key_pem; receives the key size.
+ * @param issue_date Receives the earliest issue date of the collateral that
+ * the chain was verified against.
+ *
+ * @return OE_OK if the chain was found and has not expired.
+ * @return OE_NOT_FOUND otherwise.
+ */
+oe_result_t oe_find_verified_pck_chain(
+    const OE_SHA256* hash,
+    uint8_t* leaf_key_pem,
+    size_t* leaf_key_pem_size,
+    oe_datetime_t* issue_date);
+
+/**
+ * Remember a PCK certificate chain that passed verification, until the
+ * given expiry date.
+ */
+oe_result_t oe_add_verified_pck_chain(
+    const OE_SHA256* hash,
+    const uint8_t* leaf_key_pem,
+    size_t leaf_key_pem_size,
+    const oe_datetime_t* issue_date,
+    const oe_datetime_t* expiry);
+
+/**
+ * Get the hit/miss counters of the collateral and PCK chain caches.
+ */
+void oe_get_collateral_cache_stats(oe_collateral_cache_stats_t* stats);
+
+/**
+ * Drop every cached collateral and PCK chain and reset the counters.
+ */
+void oe_clear_collateral_cache(void);
+
+#endif
+
+OE_EXTERNC_END
+
+#endif // _OE_COMMON_COLLATERAL_H
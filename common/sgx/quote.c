@@ -9,6 +9,7 @@
 #include <openenclave/internal/sha.h>
 #include <openenclave/internal/utils.h>
 #include "../common.h"
+#include "collateral.h"
 #include "qeidentity.h"
 #include "revocation.h"
 
@@ -162,6 +163,11 @@ oe_result_t VerifyQuoteImpl(
     oe_ec_public_key_t root_public_key = {0};
     oe_ec_public_key_t expected_root_public_key = {0};
     bool key_equal = false;
+    OE_SHA256 pck_cert_chain_hash = {0};
+    uint8_t leaf_key_pem[OE_PCK_LEAF_KEY_PEM_MAX];
+    size_t leaf_key_pem_size = sizeof(leaf_key_pem);
+    oe_revocation_validity_t validity = {{0}};
+    bool cached_chain = false;
 
     OE_UNUSED(pck_crl);
     OE_UNUSED(pck_crl_size);
@@ -204,7 +210,29 @@ oe_result_t VerifyQuoteImpl(
         OE_RAISE_MSG(
             OE_MISSING_CERTIFICATE_CHAIN, "No certificate found", NULL);
 
-    // PckCertificate Chain validations.
+    // A chain that was already validated against the root of trust and the
+    // revocation info, which have not expired since, only needs the public
+    // key of its leaf certificate.
+    OE_CHECK(oe_sha256_init(&sha256_ctx));
+    OE_CHECK(oe_sha256_update(
+        &sha256_ctx, pem_pck_certificate, pem_pck_certificate_size));
+    OE_CHECK(oe_sha256_final(&sha256_ctx, &pck_cert_chain_hash));
+
+    if (oe_find_verified_pck_chain(
+            &pck_cert_chain_hash,
+            leaf_key_pem,
+            &leaf_key_pem_size,
+            &validity.issue_date) == OE_OK)
+    {
+        cached_chain = true;
+
+        // The minimum issue date may have been raised since.
+        OE_CHECK(oe_enforce_minimum_issue_date(&validity.issue_date));
+
+        OE_CHECK(oe_ec_public_key_read_pem(
+            &leaf_public_key, leaf_key_pem, leaf_key_pem_size));
+    }
+    else
     {
         // Read and validate the chain.
         OE_CHECK(oe_cert_chain_read_pem(
@@ -219,7 +247,9 @@ oe_result_t VerifyQuoteImpl(
         OE_CHECK(oe_cert_get_ec_public_key(&leaf_cert, &leaf_public_key));
         OE_CHECK(oe_cert_get_ec_public_key(&root_cert, &root_public_key));
 
-        // Ensure that the root certificate matches root of trust.
+        // Ensure that the root certificate matches root of trust. The key is
+        // parsed for each chain rather than shared, since mbedtls key objects
+        // must not be used by several threads at once. Cached chains skip it.
         OE_CHECK(oe_ec_public_key_read_pem(
             &expected_root_public_key,
             (const uint8_t*)g_expected_root_certificate_key,
@@ -232,9 +262,21 @@ oe_result_t VerifyQuoteImpl(
 
         OE_CHECK_MSG(
             oe_enforce_revocation(
-                &leaf_cert, &intermediate_cert, &pck_cert_chain),
+                &leaf_cert, &intermediate_cert, &pck_cert_chain, &validity),
             "enforcing CRL",
             NULL);
+
+        // Failing to cache the chain does not fail the verification.
+        if (oe_ec_public_key_write_pem(
+                &leaf_public_key, leaf_key_pem, &leaf_key_pem_size) == OE_OK)
+        {
+            oe_add_verified_pck_chain(
+                &pck_cert_chain_hash,
+                leaf_key_pem,
+                leaf_key_pem_size,
+                &validity.issue_date,
+                &validity.next_update);
+        }
     }
 
     // Quote validations.
@@ -295,13 +337,16 @@ oe_result_t VerifyQuoteImpl(
 
 done:
     oe_ec_public_key_free(&leaf_public_key);
-    oe_ec_public_key_free(&root_public_key);
-    oe_ec_public_key_free(&expected_root_public_key);
     oe_ec_public_key_free(&attestation_key);
-    oe_cert_free(&leaf_cert);
-    oe_cert_free(&root_cert);
-    oe_cert_free(&intermediate_cert);
-    oe_cert_chain_free(&pck_cert_chain);
+    if (!cached_chain)
+    {
+        oe_ec_public_key_free(&root_public_key);
+        oe_ec_public_key_free(&expected_root_public_key);
+        oe_cert_free(&leaf_cert);
+        oe_cert_free(&root_cert);
+        oe_cert_free(&intermediate_cert);
+        oe_cert_chain_free(&pck_cert_chain);
+    }
     return result;
 }
 
@@ -18,6 +18,7 @@
 #include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
 #include "../common.h"
+#include "collateral.h"
 #include "tcbinfo.h"
 
 #ifdef OE_USE_LIBSGX
@@ -44,6 +45,14 @@ done:
     return result;
 }
 
+oe_result_t oe_enforce_minimum_issue_date(const oe_datetime_t* issue_date)
+{
+    if (oe_datetime_compare(issue_date, &_sgx_minimim_crl_tcb_issue_date) != 1)
+        return OE_INVALID_REVOCATION_INFO;
+
+    return OE_OK;
+}
+
 /**
  * Parse sgx extensions from given cert.
  */
@@ -157,73 +166,47 @@ static void _trace_datetime(const char* msg, const oe_datetime_t* date)
 oe_result_t oe_enforce_revocation(
     oe_cert_t* leaf_cert,
     oe_cert_t* intermediate_cert,
-    oe_cert_chain_t* pck_cert_chain)
+    oe_cert_chain_t* pck_cert_chain,
+    oe_revocation_validity_t* validity)
 {
     oe_result_t result = OE_FAILURE;
     oe_result_t r = OE_FAILURE;
     ParsedExtensionInfo parsed_extension_info = {{0}};
-    oe_get_revocation_info_args_t revocation_args = {0};
-    oe_cert_chain_t tcb_issuer_chain = {0};
-    oe_cert_chain_t crl_issuer_chain[3] = {{{0}}};
+    oe_collateral_t* collateral = NULL;
+    const char* crl_urls[2] = {NULL};
     oe_parsed_tcb_info_t parsed_tcb_info = {0};
     oe_tcb_level_t platform_tcb_level = {{0}};
     oe_verify_cert_error_t cert_verify_error = {0};
     char* intermediate_crl_url = NULL;
     char* leaf_crl_url = NULL;
-    oe_crl_t crls[2] = {{{0}}};
-    const oe_crl_t* crl_ptrs[2] = {&crls[0], &crls[1]};
-    oe_datetime_t crl_this_update_date = {0};
-    oe_datetime_t crl_next_update_date = {0};
+    const oe_crl_t* crl_ptrs[2] = {NULL};
 
     OE_UNUSED(pck_cert_chain);
 
     if (intermediate_cert == NULL || leaf_cert == NULL)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    OE_STATIC_ASSERT(
-        OE_COUNTOF(crl_issuer_chain) ==
-        OE_COUNTOF(revocation_args.crl_issuer_chain));
-
     // Gather fmspc.
     OE_CHECK(_parse_sgx_extensions(leaf_cert, &parsed_extension_info));
-    OE_CHECK(oe_memcpy_s(
-        revocation_args.fmspc,
-        sizeof(revocation_args.fmspc),
-        parsed_extension_info.fmspc,
-        sizeof(parsed_extension_info.fmspc)));
 
     // Gather CRL distribution point URLs from certs.
     OE_CHECK(
         _get_crl_distribution_point(intermediate_cert, &intermediate_crl_url));
     OE_CHECK(_get_crl_distribution_point(leaf_cert, &leaf_crl_url));
 
-    revocation_args.crl_urls[0] = leaf_crl_url;
-    revocation_args.crl_urls[1] = intermediate_crl_url;
-    revocation_args.num_crl_urls = 2;
-
-    OE_CHECK(oe_get_revocation_info(&revocation_args));
+    crl_urls[0] = leaf_crl_url;
+    crl_urls[1] = intermediate_crl_url;
 
-    // Apply revocation info.
-    OE_CHECK(oe_cert_chain_read_pem(
-        &tcb_issuer_chain,
-        revocation_args.tcb_issuer_chain,
-        revocation_args.tcb_issuer_chain_size));
+    // Get the parsed revocation info, fetching it only if it is not cached.
+    // The signature of the TCB info has been verified by the cache.
+    OE_CHECK(oe_acquire_collateral(
+        parsed_extension_info.fmspc,
+        crl_urls,
+        OE_COUNTOF(crl_urls),
+        &collateral));
 
-    // Read CRLs for each cert other than root. If any CRL is missing, the read
-    // will error out.
-    for (uint32_t i = 0; i < revocation_args.num_crl_urls; ++i)
-    {
-        OE_CHECK(oe_crl_read_der(
-            &crls[i], revocation_args.crl[i], revocation_args.crl_size[i]));
-        OE_CHECK(oe_cert_chain_read_pem(
-            &crl_issuer_chain[i],
-            revocation_args.crl_issuer_chain[i],
-            revocation_args.crl_issuer_chain_size[i]));
-        OE_TRACE_VERBOSE(
-            "CRL certificate[%d]: \n[%s]\n",
-            i,
-            revocation_args.crl_issuer_chain[i]);
-    }
+    for (uint32_t i = 0; i < OE_COUNTOF(crl_ptrs); ++i)
+        crl_ptrs[i] = &collateral->crls[i];
 
     // Verify the leaf cert.
     // oe_cert_verify incorporates openssl -crl_check_all semantics.
@@ -241,7 +224,11 @@ oe_result_t oe_enforce_revocation(
     // chain, then verification would fail because the CRLs will not be found
     // for certificates in the chain.
     r = oe_cert_verify(
-        leaf_cert, &crl_issuer_chain[0], crl_ptrs, 2, &cert_verify_error);
+        leaf_cert,
+        &collateral->crl_issuer_chain[0],
+        crl_ptrs,
+        OE_COUNTOF(crl_ptrs),
+        &cert_verify_error);
     if (r != OE_OK)
     {
         OE_RAISE_MSG(
@@ -258,61 +245,52 @@ oe_result_t oe_enforce_revocation(
     platform_tcb_level.status = OE_TCB_LEVEL_STATUS_UNKNOWN;
 
     OE_CHECK(oe_parse_tcb_info_json(
-        revocation_args.tcb_info,
-        revocation_args.tcb_info_size,
+        collateral->tcb_info,
+        collateral->tcb_info_size,
         &platform_tcb_level,
         &parsed_tcb_info));
 
-    OE_CHECK(oe_verify_ecdsa256_signature(
-        parsed_tcb_info.tcb_info_start,
-        parsed_tcb_info.tcb_info_size,
-        (sgx_ecdsa256_signature_t*)parsed_tcb_info.signature,
-        &tcb_issuer_chain));
-
     // Check that the tcb has been issued after the earliest date that the
     // enclave accepts.
-    if (oe_datetime_compare(
-            &parsed_tcb_info.issue_date, &_sgx_minimim_crl_tcb_issue_date) != 1)
-        OE_RAISE(OE_INVALID_REVOCATION_INFO);
+    OE_CHECK(oe_enforce_minimum_issue_date(&collateral->tcb_issue_date));
 
     // Check that the CRLs have not expired.
     // The next update of the CRL must be after the earliest date that
     // the enclave accepts.
-    for (uint32_t i = 0; i < OE_COUNTOF(crls); ++i)
+    for (uint32_t i = 0; i < collateral->num_crl_urls; ++i)
     {
-        OE_CHECK(oe_crl_get_update_dates(
-            &crls[0], &crl_this_update_date, &crl_next_update_date));
-
-        _trace_datetime("crl this update date ", &crl_this_update_date);
-        _trace_datetime("crl next update date ", &crl_next_update_date);
+        _trace_datetime(
+            "crl this update date ", &collateral->crl_this_update[i]);
+        _trace_datetime(
+            "crl next update date ", &collateral->crl_next_update[i]);
 
         // CRL must be issued after minimum date.
-        if (oe_datetime_compare(
-                &crl_this_update_date, &_sgx_minimim_crl_tcb_issue_date) != 1)
-            OE_RAISE(OE_INVALID_REVOCATION_INFO);
+        OE_CHECK(
+            oe_enforce_minimum_issue_date(&collateral->crl_this_update[i]));
 
         // Also check that next update date is after minimum date.
-        if (oe_datetime_compare(
-                &crl_next_update_date, &_sgx_minimim_crl_tcb_issue_date) != 1)
-            OE_RAISE(OE_INVALID_REVOCATION_INFO);
+        OE_CHECK(
+            oe_enforce_minimum_issue_date(&collateral->crl_next_update[i]));
     }
 
-    result = OE_OK;
-
-done:
-    for (int32_t i = (int32_t)revocation_args.num_crl_urls - 1; i >= 0; --i)
+    if (validity)
     {
-        oe_crl_free(&crls[i]);
+        validity->issue_date = collateral->tcb_issue_date;
+        for (uint32_t i = 0; i < collateral->num_crl_urls; ++i)
+        {
+            const oe_datetime_t* date = &collateral->crl_this_update[i];
+            if (oe_datetime_compare(date, &validity->issue_date) < 0)
+                validity->issue_date = *date;
+        }
+        validity->next_update = collateral->expiry;
     }
-    for (uint32_t i = 0; i < revocation_args.num_crl_urls; ++i)
-    {
-        oe_cert_chain_free(&crl_issuer_chain[i]);
-    }
-    oe_cert_chain_free(&tcb_issuer_chain);
 
+    result = OE_OK;
+
+done:
+    oe_release_collateral(collateral);
     oe_free(leaf_crl_url);
     oe_free(intermediate_crl_url);
-    oe_cleanup_get_revocation_info_args(&revocation_args);
 
     return result;
 }
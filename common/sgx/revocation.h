@@ -8,16 +8,32 @@
 #include <openenclave/bits/result.h>
 #include <openenclave/bits/types.h>
 #include <openenclave/internal/cert.h>
+#include <openenclave/internal/datetime.h>
 #include <openenclave/internal/report.h>
 
 OE_EXTERNC_BEGIN
 
 #ifdef OE_USE_LIBSGX
 
+// Dates of the revocation info that a certificate chain was checked against.
+typedef struct _oe_revocation_validity
+{
+    // Earliest issue date of the TCB info and the CRLs.
+    oe_datetime_t issue_date;
+
+    // Earliest next update date of the TCB info and the CRLs.
+    oe_datetime_t next_update;
+} oe_revocation_validity_t;
+
 oe_result_t oe_enforce_revocation(
     oe_cert_t* leaf_cert,
     oe_cert_t* intermediate_cert,
-    oe_cert_chain_t* pck_cert_chain);
+    oe_cert_chain_t* pck_cert_chain,
+    oe_revocation_validity_t* validity);
+
+// Check that revocation info issued on the given date is still accepted,
+// i.e. that it was issued after the minimum CRL/TCB issue date.
+oe_result_t oe_enforce_minimum_issue_date(const oe_datetime_t* issue_date);
 
 // Fetch revocation info using the specified args structure.
 oe_result_t oe_get_revocation_info(oe_get_revocation_info_args_t* args);
@@ -0,0 +1,166 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/bits/safemath.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/atomic.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/sgxtypes.h>
+#include "arena.h"
+#include "td.h"
+
+/*
+**==============================================================================
+**
+** OCALL arenas
+**
+**     At creation the host maps one untrusted arena per TCS and passes them
+**     to the enclave with OE_ECALL_INIT_ENCLAVE. The first thread to run on
+**     a TCS claims the next arena and records it in its td_t, where it stays
+**     for the lifetime of the enclave.
+**
+**     Buffers are bump-allocated from the arena. The arena is rewound when
+**     the last outstanding buffer is freed, which is the common case since
+**     OCALL buffers are released before the OCALL wrapper returns.
+**
+**     When a request does not fit and no buffer is outstanding, the arena is
+**     replaced with a larger one from OE_OCALL_GROW_OCALL_ARENA, doubling up
+**     to OE_OCALL_ARENA_MAX_SIZE. The host keeps the grown arena for the TCS
+**     (freeing the one it replaces), so a thread with large OCALL buffers
+**     pays for one OCALL rather than one per buffer. Requests that still do
+**     not fit fall back to oe_host_malloc().
+**
+**==============================================================================
+*/
+
+#define OE_OCALL_ARENA_ALIGNMENT 16
+
+static uint8_t* _arenas;
+static size_t _arena_size;
+static size_t _num_arenas;
+static volatile uint64_t _num_claimed;
+
+oe_result_t oe_ocall_arena_init(
+    void* arenas,
+    size_t arena_size,
+    size_t num_arenas)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t total_size;
+
+    /* The host did not map any arenas */
+    if (!arenas || !arena_size || !num_arenas)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    OE_CHECK(oe_safe_mul_sizet(arena_size, num_arenas, &total_size));
+
+    if (!oe_is_outside_enclave(arenas, total_size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    _arenas = (uint8_t*)arenas;
+    _arena_size = arena_size;
+    _num_arenas = num_arenas;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static bool _claim_arena(td_t* td)
+{
+    uint64_t index;
+
+    if (!_arenas || _num_claimed >= _num_arenas)
+        return false;
+
+    index = oe_atomic_increment(&_num_claimed) - 1;
+
+    if (index >= _num_arenas)
+        return false;
+
+    td->ocall_arena_base = (uint64_t)(_arenas + index * _arena_size);
+    td->ocall_arena_size = _arena_size;
+    td->ocall_arena_used = 0;
+    td->ocall_arena_count = 0;
+
+    return true;
+}
+
+/* Replace the arena of td with a host allocation of at least size bytes */
+static bool _grow_arena(td_t* td, size_t size)
+{
+    uint64_t new_size = td->ocall_arena_size;
+    uint64_t arena = 0;
+
+    /* Buffers in the current arena are still in use */
+    if (td->ocall_arena_count)
+        return false;
+
+    while (new_size < size && new_size <= OE_OCALL_ARENA_MAX_SIZE / 2)
+        new_size *= 2;
+
+    if (new_size < size)
+        return false;
+
+    if (oe_ocall(OE_OCALL_GROW_OCALL_ARENA, new_size, &arena) != OE_OK ||
+        !arena || !oe_is_outside_enclave((void*)arena, new_size))
+        return false;
+
+    td->ocall_arena_base = arena;
+    td->ocall_arena_size = new_size;
+    td->ocall_arena_used = 0;
+
+    return true;
+}
+
+void* oe_ocall_arena_alloc(size_t size)
+{
+    td_t* td = oe_get_td();
+    size_t aligned_size;
+    void* ptr;
+
+    if (!td->ocall_arena_base && !_claim_arena(td))
+        return NULL;
+
+    if (oe_safe_add_sizet(size, OE_OCALL_ARENA_ALIGNMENT - 1, &aligned_size) !=
+        OE_OK)
+        return NULL;
+
+    aligned_size &= ~(size_t)(OE_OCALL_ARENA_ALIGNMENT - 1);
+
+    if (aligned_size > td->ocall_arena_size - td->ocall_arena_used &&
+        !_grow_arena(td, aligned_size))
+        return NULL;
+
+    ptr = (void*)(td->ocall_arena_base + td->ocall_arena_used);
+    td->ocall_arena_used += aligned_size;
+    td->ocall_arena_count++;
+
+    return ptr;
+}
+
+bool oe_ocall_arena_free(void* ptr)
+{
+    td_t* td = oe_get_td();
+    uint64_t addr = (uint64_t)ptr;
+
+    if (!td->ocall_arena_base || addr < td->ocall_arena_base ||
+        addr >= td->ocall_arena_base + td->ocall_arena_size)
+        return false;
+
+    if (td->ocall_arena_count && --td->ocall_arena_count == 0)
+        td->ocall_arena_used = 0;
+
+    return true;
+}
+
+void oe_ocall_arena_reset(td_t* td)
+{
+    td->ocall_arena_used = 0;
+    td->ocall_arena_count = 0;
+}
@@ -0,0 +1,21 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_ARENA_H
+#define _OE_ARENA_H
+
+#include <openenclave/enclave.h>
+#include "td.h"
+
+oe_result_t oe_ocall_arena_init(
+    void* arenas,
+    size_t arena_size,
+    size_t num_arenas);
+
+void* oe_ocall_arena_alloc(size_t size);
+
+bool oe_ocall_arena_free(void* ptr);
+
+void oe_ocall_arena_reset(td_t* td);
+
+#endif /* _OE_ARENA_H */
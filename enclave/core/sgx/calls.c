@@ -16,14 +16,17 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/sgxtypes.h>
 #include <openenclave/internal/thread.h>
+#include <openenclave/internal/time.h>
 #include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
 #include "../../sgx/report.h"
+#include "arena.h"
 #include "asmdefs.h"
 #include "atexit.h"
 #include "cpuid.h"
 #include "init.h"
 #include "report.h"
+#include "switchlesscalls.h"
 #include "td.h"
 
 oe_result_t __oe_enclave_status = OE_OK;
@@ -168,6 +171,21 @@ static oe_result_t _handle_init_enclave(uint64_t arg_in)
                     OE_RAISE(OE_INVALID_PARAMETER);
 
                 oe_enclave = safe_args.enclave;
+
+                OE_CHECK(oe_ocall_arena_init(
+                    safe_args.ocall_arenas,
+                    safe_args.ocall_arena_size,
+                    safe_args.num_ocall_arenas));
+
+                if (safe_args.shared_clock)
+                {
+                    if (!oe_is_outside_enclave(
+                            safe_args.shared_clock, sizeof(oe_shared_clock_t)))
+                        OE_RAISE(OE_INVALID_PARAMETER);
+
+                    oe_set_shared_clock(
+                        (const oe_shared_clock_t*)safe_args.shared_clock);
+                }
             }
 
             /* Call all enclave state initialization functions */
@@ -252,12 +270,69 @@ done:
 extern const oe_ecall_func_t __oe_ecalls_table[];
 extern const size_t __oe_ecalls_table_size;
 
-/**
- * This is the preferred way to call enclave functions.
- */
-static oe_result_t _handle_call_enclave_function(uint64_t arg_in)
+/*
+**==============================================================================
+**
+** _get_ecall_buffer()
+** _put_ecall_buffer()
+**
+**     Each TCS keeps the enclave buffer of its last ECALL in td_t and reuses
+**     it for the next one, growing it to the largest size seen so far, so
+**     that ECALLs do not go through oe_malloc(). _handle_ecall() rejects
+**     ECALLs nested on the same TCS, so the buffer is normally free on entry;
+**     should it still be in use, the call gets a buffer of its own instead.
+**     Debug malloc builds do not keep buffers, which would be reported as
+**     leaks.
+**
+**==============================================================================
+*/
+
+static uint8_t* _get_ecall_buffer(td_t* td, size_t size)
+{
+#if !defined(OE_USE_DEBUG_MALLOC)
+    if (!td->ecall_buffer_in_use)
+    {
+        if (size > td->ecall_buffer_size)
+        {
+            void* buffer;
+
+            oe_free((void*)td->ecall_buffer);
+            td->ecall_buffer = 0;
+            td->ecall_buffer_size = 0;
+
+            if (!(buffer = oe_malloc(size)))
+                return NULL;
+
+            td->ecall_buffer = (uint64_t)buffer;
+            td->ecall_buffer_size = size;
+        }
+
+        td->ecall_buffer_in_use = 1;
+        return (uint8_t*)td->ecall_buffer;
+    }
+#else
+    OE_UNUSED(td);
+#endif
+
+    return (uint8_t*)oe_malloc(size);
+}
+
+static void _put_ecall_buffer(td_t* td, uint8_t* buffer)
+{
+    if (buffer && (uint64_t)buffer == td->ecall_buffer)
+        td->ecall_buffer_in_use = 0;
+    else
+        oe_free(buffer);
+}
+
+/* Call the enclave function that args, a copy in enclave memory of the
+ * arguments at args_ptr in host memory, refers to. The result is returned
+ * but not stored in args_ptr, which is up to the caller. */
+static oe_result_t _call_enclave_function(
+    td_t* td,
+    const oe_call_enclave_function_args_t* args,
+    oe_call_enclave_function_args_t* args_ptr)
 {
-    oe_call_enclave_function_args_t args, *args_ptr;
     oe_result_t result = OE_OK;
     oe_ecall_func_t func = NULL;
     uint8_t* buffer = NULL;
@@ -266,82 +341,161 @@ static oe_result_t _handle_call_enclave_function(uint64_t arg_in)
     size_t buffer_size = 0;
     size_t output_bytes_written = 0;
 
-    // Ensure that args lies outside the enclave.
-    if (!oe_is_outside_enclave(
-            (void*)arg_in, sizeof(oe_call_enclave_function_args_t)))
-        OE_RAISE(OE_INVALID_PARAMETER);
-
-    // Copy args to enclave memory to avoid TOCTOU issues.
-    args_ptr = (oe_call_enclave_function_args_t*)arg_in;
-    args = *args_ptr;
-
     // Ensure that input buffer is valid.
-    if (args.input_buffer == NULL || args.input_buffer_size == 0 ||
-        !oe_is_outside_enclave(args.input_buffer, args.input_buffer_size))
+    if (args->input_buffer == NULL || args->input_buffer_size == 0 ||
+        !oe_is_outside_enclave(args->input_buffer, args->input_buffer_size))
         OE_RAISE(OE_INVALID_PARAMETER);
 
     // Ensure that output buffer is valid.
-    if (args.output_buffer == NULL || args.output_buffer_size == 0 ||
-        !oe_is_outside_enclave(args.output_buffer, args.output_buffer_size))
+    if (args->output_buffer == NULL || args->output_buffer_size == 0 ||
+        !oe_is_outside_enclave(args->output_buffer, args->output_buffer_size))
         OE_RAISE(OE_INVALID_PARAMETER);
 
     // Validate output and input buffer sizes.
     // Buffer sizes must be correctly aligned.
-    if ((args.input_buffer_size % OE_EDGER8R_BUFFER_ALIGNMENT) != 0)
+    if ((args->input_buffer_size % OE_EDGER8R_BUFFER_ALIGNMENT) != 0)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    if ((args.output_buffer_size % OE_EDGER8R_BUFFER_ALIGNMENT) != 0)
+    if ((args->output_buffer_size % OE_EDGER8R_BUFFER_ALIGNMENT) != 0)
         OE_RAISE(OE_INVALID_PARAMETER);
 
     OE_CHECK(oe_safe_add_u64(
-        args.input_buffer_size, args.output_buffer_size, &buffer_size));
+        args->input_buffer_size, args->output_buffer_size, &buffer_size));
 
     // Fetch matching function.
-    if (args.function_id >= __oe_ecalls_table_size)
+    if (args->function_id >= __oe_ecalls_table_size)
         OE_RAISE(OE_NOT_FOUND);
 
-    func = __oe_ecalls_table[args.function_id];
+    func = __oe_ecalls_table[args->function_id];
 
     if (func == NULL)
         OE_RAISE(OE_NOT_FOUND);
 
-    // Allocate buffers in enclave memory
-    buffer = input_buffer = oe_malloc(buffer_size);
+    // Get a buffer in enclave memory
+    buffer = input_buffer = _get_ecall_buffer(td, buffer_size);
     if (buffer == NULL)
         OE_RAISE(OE_OUT_OF_MEMORY);
 
     // Copy input buffer to enclave buffer.
-    memcpy(input_buffer, args.input_buffer, args.input_buffer_size);
+    memcpy(input_buffer, args->input_buffer, args->input_buffer_size);
 
     // Clear out output buffer.
     // This ensures reproducible behavior if say the function is reading from
     // output buffer.
-    output_buffer = buffer + args.input_buffer_size;
-    memset(output_buffer, 0, args.output_buffer_size);
+    output_buffer = buffer + args->input_buffer_size;
+    memset(output_buffer, 0, args->output_buffer_size);
 
     // Call the function.
     func(
         input_buffer,
-        args.input_buffer_size,
+        args->input_buffer_size,
         output_buffer,
-        args.output_buffer_size,
+        args->output_buffer_size,
         &output_bytes_written);
 
     // Copy outputs to host memory.
-    memcpy(args.output_buffer, output_buffer, output_bytes_written);
+    memcpy(args->output_buffer, output_buffer, output_bytes_written);
 
     // The ecall succeeded.
     args_ptr->output_bytes_written = output_bytes_written;
-    args_ptr->result = OE_OK;
     result = OE_OK;
 
 done:
     if (buffer)
-        oe_free(buffer);
+        _put_ecall_buffer(td, buffer);
+
+    return result;
+}
+
+/**
+ * Call the enclave function that the host arguments at arg_in refer to,
+ * without storing the result in them. Used by the enclave workers that
+ * service switchless ECALLs, which publish the result themselves once they
+ * are ready for the next call.
+ */
+oe_result_t oe_dispatch_call_enclave_function(uint64_t arg_in)
+{
+    oe_call_enclave_function_args_t args, *args_ptr;
+    oe_result_t result = OE_OK;
+
+    // Ensure that args lies outside the enclave.
+    if (!oe_is_outside_enclave(
+            (void*)arg_in, sizeof(oe_call_enclave_function_args_t)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Copy args to enclave memory to avoid TOCTOU issues.
+    args_ptr = (oe_call_enclave_function_args_t*)arg_in;
+    args = *args_ptr;
+
+    result = _call_enclave_function(oe_get_td(), &args, args_ptr);
+
+done:
+    return result;
+}
+
+/**
+ * This is the preferred way to call enclave functions.
+ */
+static oe_result_t _handle_call_enclave_function(uint64_t arg_in)
+{
+    oe_result_t result = oe_dispatch_call_enclave_function(arg_in);
+
+    /* On failure the host learns the result from the ECALL's return value */
+    if (result == OE_OK)
+        ((oe_call_enclave_function_args_t*)arg_in)->result = OE_OK;
 
     return result;
 }
 
+/*
+**==============================================================================
+**
+** _handle_call_enclave_function_batch()
+**
+**     Call the enclave functions of a batch, so that the host enters the
+**     enclave once for many small calls. Each call is validated and made as
+**     by _handle_call_enclave_function() and gets its own result; a call
+**     that fails does not stop the later ones.
+**
+**==============================================================================
+*/
+
+static oe_result_t _handle_call_enclave_function_batch(uint64_t arg_in)
+{
+    td_t* td = oe_get_td();
+    oe_call_enclave_function_batch_args_t batch;
+    oe_call_enclave_function_args_t* calls;
+    oe_result_t result = OE_UNEXPECTED;
+    uint64_t size;
+
+    // Ensure that the batch and its calls lie outside the enclave.
+    if (!oe_is_outside_enclave(
+            (void*)arg_in, sizeof(oe_call_enclave_function_batch_args_t)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    batch = *(oe_call_enclave_function_batch_args_t*)arg_in;
+    calls = batch.calls;
+
+    OE_CHECK(oe_safe_mul_u64(
+        batch.num_calls, sizeof(oe_call_enclave_function_args_t), &size));
+
+    if (!calls || size == 0 || !oe_is_outside_enclave(calls, size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (uint64_t i = 0; i < batch.num_calls; i++)
+    {
+        // Copy the args of each call to enclave memory (see above).
+        oe_call_enclave_function_args_t args = calls[i];
+
+        calls[i].result = _call_enclave_function(td, &args, &calls[i]);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 /*
 **==============================================================================
 **
@@ -477,6 +631,26 @@ static void _handle_ecall(
             _handle_oelog_init(arg_in);
             break;
         }
+        case OE_ECALL_INIT_CONTEXT_SWITCHLESS:
+        {
+            arg_out = oe_handle_init_switchless(arg_in);
+            break;
+        }
+        case OE_ECALL_LAUNCH_ENCLAVE_WORKER:
+        {
+            arg_out = oe_handle_launch_enclave_worker(arg_in);
+            break;
+        }
+        case OE_ECALL_GET_ENCLAVE_STATUS:
+        {
+            arg_out = (uint64_t)oe_get_enclave_status();
+            break;
+        }
+        case OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH:
+        {
+            arg_out = _handle_call_enclave_function_batch(arg_in);
+            break;
+        }
         default:
         {
             /* No function found with the number */
@@ -575,6 +749,7 @@ oe_result_t oe_ocall(uint16_t func, uint64_t arg_in, uint64_t* arg_out)
     if (oe_setjmp(&callsite->jmpbuf) == 0)
     {
         /* Exit, giving control back to the host so it can handle OCALL */
+        td->ocall_depth++;
         _handle_exit(OE_CODE_OCALL, func, arg_in);
 
         /* Unreachable! Host will transfer control back to oe_enter() */
@@ -582,6 +757,8 @@ oe_result_t oe_ocall(uint16_t func, uint64_t arg_in, uint64_t* arg_out)
     }
     else
     {
+        td->ocall_depth--;
+
         OE_CHECK_NO_TRACE(result = (oe_result_t)td->oret_result);
 
         if (arg_out)
@@ -704,19 +881,23 @@ done:
 /*
 **==============================================================================
 **
-** oe_call_host_function()
-** This is the preferred way to call host functions.
+** _call_host_function()
+**
+**     Marshal the call arguments into host memory and call the host function
+**     either with a regular OCALL or, if **switchless** is true, by posting
+**     it to a host worker thread.
 **
 **==============================================================================
 */
 
-oe_result_t oe_call_host_function(
+static oe_result_t _call_host_function(
     size_t function_id,
     const void* input_buffer,
     size_t input_buffer_size,
     void* output_buffer,
     size_t output_buffer_size,
-    size_t* output_bytes_written)
+    size_t* output_bytes_written,
+    bool switchless)
 {
     oe_result_t result = OE_UNEXPECTED;
     oe_call_host_function_args_t* args = NULL;
@@ -727,13 +908,14 @@ oe_result_t oe_call_host_function(
 
     /* Initialize the arguments */
     {
-        if (!(args = oe_host_calloc(1, sizeof(*args))))
+        if (!(args = oe_allocate_ocall_buffer(sizeof(*args))))
         {
             /* Fail if the enclave is crashing. */
             OE_CHECK(__oe_enclave_status);
             OE_RAISE(OE_OUT_OF_MEMORY);
         }
 
+        memset(args, 0, sizeof(*args));
         args->function_id = function_id;
         args->input_buffer = input_buffer;
         args->input_buffer_size = input_buffer_size;
@@ -742,8 +924,15 @@ oe_result_t oe_call_host_function(
         args->result = OE_UNEXPECTED;
     }
 
-    /* Call the host function with this address */
-    OE_CHECK(oe_ocall(OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args, NULL));
+    /* Fall back to a regular OCALL if no host worker is available */
+    if (!switchless ||
+        oe_post_switchless_ocall(args) == OE_CONTEXT_SWITCHLESS_OCALL_MISSED)
+    {
+        args->result = OE_UNEXPECTED;
+
+        /* Call the host function with this address */
+        OE_CHECK(oe_ocall(OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args, NULL));
+    }
 
     /* Check the result */
     OE_CHECK(args->result);
@@ -753,11 +942,68 @@ oe_result_t oe_call_host_function(
 
 done:
 
-    oe_host_free(args);
+    if (args)
+        oe_free_ocall_buffer(args);
 
     return result;
 }
 
+/*
+**==============================================================================
+**
+** oe_call_host_function()
+** This is the preferred way to call host functions.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_host_function(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    size_t* output_bytes_written)
+{
+    return _call_host_function(
+        function_id,
+        input_buffer,
+        input_buffer_size,
+        output_buffer,
+        output_buffer_size,
+        output_bytes_written,
+        false);
+}
+
+/*
+**==============================================================================
+**
+** oe_switchless_call_host_function()
+**
+**     Call a host function without leaving the enclave, falling back to a
+**     regular OCALL when no host worker is available.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_switchless_call_host_function(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    size_t* output_bytes_written)
+{
+    return _call_host_function(
+        function_id,
+        input_buffer,
+        input_buffer_size,
+        output_buffer,
+        output_buffer_size,
+        output_bytes_written,
+        true);
+}
+
 /*
 **==============================================================================
 **
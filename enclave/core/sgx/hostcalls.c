@@ -10,6 +10,7 @@
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/print.h>
 #include <openenclave/internal/stack_alloc.h>
+#include "arena.h"
 #include "td.h"
 
 void* oe_host_malloc(size_t size)
@@ -102,35 +103,80 @@ char* oe_host_strndup(const char* str, size_t n)
 
 int oe_host_write(int device, const char* str, size_t len)
 {
-    int ret = -1;
-    oe_print_args_t* args = NULL;
+    oe_host_iovec_t iov;
 
-    /* Reject invalid arguments */
-    if ((device != 0 && device != 1) || !str)
-        goto done;
+    if (!str)
+        return -1;
 
     /* Determine the length of the string */
     if (len == (size_t)-1)
         len = oe_strlen(str);
 
-    /* Check for integer overflow and allocate space for the arguments followed
-     * by null-terminated string */
+    iov.base = str;
+    iov.size = len;
+
+    return oe_host_writev(device, &iov, 1);
+}
+
+int oe_host_writev(int device, const oe_host_iovec_t* iov, size_t iovcnt)
+{
+    int ret = -1;
+    oe_print_args_t* args = NULL;
+    size_t len = 0;
     size_t total_size;
+    char* p;
+
+    /* Reject invalid arguments */
+    if ((device != 0 && device != 1) || (!iov && iovcnt))
+        goto done;
+
+    /* Determine the total length, checking for integer overflow */
+    for (size_t i = 0; i < iovcnt; i++)
+    {
+        if (!iov[i].base && iov[i].size)
+            goto done;
+
+        if (oe_safe_add_sizet(len, iov[i].size, &len) != OE_OK)
+            goto done;
+    }
+
+    /* Nothing to write */
+    if (len == 0)
+    {
+        ret = 0;
+        goto done;
+    }
+
+    /* Allocate space for the arguments followed by the null-terminated
+     * concatenation of the buffers. The space comes from the OCALL arena of
+     * the thread when possible, so that the write takes a single OCALL */
     if (oe_safe_add_sizet(len, 1 + sizeof(oe_print_args_t), &total_size) !=
         OE_OK)
         goto done;
 
-    if (!(args = (oe_print_args_t*)oe_host_calloc(1, total_size)))
+    if (!(args = (oe_print_args_t*)oe_allocate_ocall_buffer(total_size)))
         goto done;
 
     /* Initialize the arguments */
     args->device = device;
     args->str = (char*)(args + 1);
 
-    if (oe_memcpy_s(args->str, len, str, len) != OE_OK)
-        goto done;
+    p = args->str;
 
-    args->str[len] = '\0';
+    for (size_t i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].size)
+        {
+            size_t remaining = len - (size_t)(p - args->str);
+
+            if (oe_memcpy_s(p, remaining, iov[i].base, iov[i].size) != OE_OK)
+                goto done;
+
+            p += iov[i].size;
+        }
+    }
+
+    *p = '\0';
 
     /* Perform OCALL */
     if (oe_ocall(OE_OCALL_WRITE, (uint64_t)args, NULL) != OE_OK)
@@ -139,7 +185,9 @@ int oe_host_write(int device, const char* str, size_t len)
     ret = 0;
 
 done:
-    oe_host_free(args);
+    if (args)
+        oe_free_ocall_buffer(args);
+
     return ret;
 }
 
@@ -198,14 +246,22 @@ int oe_host_fprintf(int device, const char* fmt, ...)
     return n;
 }
 
-// Function used by oeedger8r for allocating ocall buffers.
+// Function used by oeedger8r for allocating ocall buffers. Buffers come from
+// the untrusted arena of the calling thread when possible, which avoids the
+// OCALLs to allocate and free them.
 void* oe_allocate_ocall_buffer(size_t size)
 {
-    return oe_host_malloc(size);
+    void* buffer = oe_ocall_arena_alloc(size);
+
+    if (!buffer)
+        buffer = oe_host_malloc(size);
+
+    return buffer;
 }
 
 // Function used by oeedger8r for freeing ocall buffers.
 void oe_free_ocall_buffer(void* buffer)
 {
-    oe_host_free(buffer);
+    if (!oe_ocall_arena_free(buffer))
+        oe_host_free(buffer);
 }
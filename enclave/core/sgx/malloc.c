@@ -5,12 +5,14 @@
 #include <openenclave/corelibc/stdio.h>
 #include <openenclave/corelibc/string.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/fault.h>
 #include <openenclave/internal/globals.h>
 #include <openenclave/internal/malloc.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/thread.h>
 #include "debugmalloc.h"
+#include "td.h"
 
 /* The use of dlmalloc/malloc.c below requires stdc names from these headers */
 #define OE_NEED_STDC_NAMES
@@ -43,7 +45,258 @@ static int _dlmalloc_stats_fprintf(FILE* stream, const char* format, ...);
 
 #pragma GCC diagnostic pop
 
-/* Choose release mode or debug mode allocation functions */
+/*
+**==============================================================================
+**
+** Per-thread caches
+**
+**     When oecore is built with OE_USE_THREAD_CACHED_MALLOC, small blocks
+**     are served from a cache owned by the calling thread (TCS) so that the
+**     common malloc/free pairs never take the dlmalloc lock. Each cache keeps
+**     one free list per dlmalloc chunk size up to _CACHE_MAX_CHUNK_SIZE. An
+**     empty list is refilled with _CACHE_REFILL_COUNT blocks carved out by
+**     a single call to dlindependent_comalloc() and a full list releases half
+**     of its blocks with a single call to dlbulk_free(), so the lock is taken
+**     once per batch rather than once per block.
+**
+**     All blocks come from the one global mspace, so a block freed by a
+**     thread other than the one that allocated it simply joins the cache of
+**     the freeing thread. The per-list and per-cache limits bound how much a
+**     producer/consumer pattern can pile up in one cache.
+**
+**     Caches are created on first use, referenced from td_t.malloc_cache and
+**     live as long as the enclave. They are also linked together so that
+**     oe_get_malloc_stats() can exclude cached blocks from in_use_bytes.
+**
+**     Cached blocks are still marked in use for dlmalloc, so its double-free
+**     checks do not apply to them: a block freed twice is cached twice and
+**     later returned by two calls to malloc. Build without the caches (or
+**     with OE_USE_DEBUG_MALLOC) to track down such heap corruption.
+**
+**==============================================================================
+*/
+
+#if defined(OE_USE_THREAD_CACHED_MALLOC) && !defined(OE_USE_DEBUG_MALLOC)
+
+/* Largest dlmalloc chunk size (header included) held by the caches */
+#define _CACHE_MAX_CHUNK_SIZE 512
+
+/* Chunk sizes are multiples of 16, so (size >> 4) indexes the lists */
+#define _CACHE_NUM_LISTS ((_CACHE_MAX_CHUNK_SIZE >> 4) + 1)
+
+/* Number of blocks obtained from dlmalloc when a list is empty */
+#define _CACHE_REFILL_COUNT 16
+
+/* Maximum number of blocks on a list and of bytes held by a cache */
+#define _CACHE_MAX_COUNT 64
+#define _CACHE_MAX_BYTES (64 * 1024)
+
+typedef struct _thread_cache
+{
+    /* Next cache on the global list */
+    struct _thread_cache* next;
+
+    /* Free blocks (linked through their first word) and their counts */
+    void* lists[_CACHE_NUM_LISTS];
+    size_t counts[_CACHE_NUM_LISTS];
+
+    /* Total chunk bytes held by this cache (read by other threads) */
+    volatile size_t bytes;
+} thread_cache_t;
+
+static thread_cache_t* volatile _caches;
+
+/* Get the cache of the calling thread, creating it if requested */
+static thread_cache_t* _get_thread_cache(bool create)
+{
+    td_t* td = oe_get_td();
+    thread_cache_t* cache;
+
+    if (!td_initialized(td))
+        return NULL;
+
+    if ((cache = (thread_cache_t*)td->malloc_cache) || !create)
+        return cache;
+
+    if (!(cache = (thread_cache_t*)dlcalloc(1, sizeof(thread_cache_t))))
+        return NULL;
+
+    /* Caches are never removed, so a simple push is enough */
+    do
+    {
+        cache->next = _caches;
+    } while (!oe_atomic_compare_and_swap_ptr(
+        (void* volatile*)&_caches, cache->next, cache));
+
+    td->malloc_cache = (uint64_t)cache;
+    return cache;
+}
+
+static void* _thread_cache_pop(thread_cache_t* cache, size_t index)
+{
+    void* ptr = cache->lists[index];
+
+    cache->lists[index] = *(void**)ptr;
+    cache->counts[index]--;
+    cache->bytes -= chunksize(mem2chunk(ptr));
+
+    return ptr;
+}
+
+static void _thread_cache_push(thread_cache_t* cache, size_t index, void* ptr)
+{
+    *(void**)ptr = cache->lists[index];
+    cache->lists[index] = ptr;
+    cache->counts[index]++;
+    cache->bytes += chunksize(mem2chunk(ptr));
+}
+
+/* Return up to count blocks of the given list to dlmalloc */
+static void _thread_cache_release(
+    thread_cache_t* cache,
+    size_t index,
+    size_t count)
+{
+    void* blocks[_CACHE_MAX_COUNT / 2];
+
+    while (count && cache->lists[index])
+    {
+        size_t n = 0;
+
+        while (n < OE_COUNTOF(blocks) && n < count && cache->lists[index])
+            blocks[n++] = _thread_cache_pop(cache, index);
+
+        dlbulk_free(blocks, n);
+        count -= n;
+    }
+}
+
+static void _thread_cache_flush(thread_cache_t* cache)
+{
+    for (size_t i = 0; i < _CACHE_NUM_LISTS; i++)
+        _thread_cache_release(cache, i, OE_SIZE_MAX);
+}
+
+static bool _thread_cache_refill(
+    thread_cache_t* cache,
+    size_t index,
+    size_t chunk_size)
+{
+    size_t sizes[_CACHE_REFILL_COUNT];
+    void* blocks[_CACHE_REFILL_COUNT];
+
+    if (cache->bytes + _CACHE_REFILL_COUNT * chunk_size > _CACHE_MAX_BYTES)
+        return false;
+
+    for (size_t i = 0; i < _CACHE_REFILL_COUNT; i++)
+        sizes[i] = chunk_size - CHUNK_OVERHEAD;
+
+    if (!dlindependent_comalloc(_CACHE_REFILL_COUNT, sizes, blocks))
+        return false;
+
+    /* The last block may absorb a few bytes of slack, which is harmless */
+    for (size_t i = 0; i < _CACHE_REFILL_COUNT; i++)
+        _thread_cache_push(cache, index, blocks[i]);
+
+    return true;
+}
+
+static void* _cached_malloc(size_t size)
+{
+    thread_cache_t* cache = NULL;
+    void* ptr;
+
+    if (size <= _CACHE_MAX_CHUNK_SIZE - CHUNK_OVERHEAD &&
+        (cache = _get_thread_cache(true)))
+    {
+        size_t chunk_size = request2size(size);
+        size_t index = chunk_size >> 4;
+
+        if (cache->lists[index] ||
+            _thread_cache_refill(cache, index, chunk_size))
+        {
+            return _thread_cache_pop(cache, index);
+        }
+    }
+
+    if (!(ptr = dlmalloc(size)) && size)
+    {
+        /* Give the blocks held by this thread back and retry once */
+        if (cache || (cache = _get_thread_cache(false)))
+        {
+            _thread_cache_flush(cache);
+            ptr = dlmalloc(size);
+        }
+    }
+
+    return ptr;
+}
+
+static void* _cached_calloc(size_t nmemb, size_t size)
+{
+    /* Both bounds keep (nmemb * size) from overflowing */
+    if (nmemb <= _CACHE_MAX_CHUNK_SIZE && size <= _CACHE_MAX_CHUNK_SIZE &&
+        nmemb * size <= _CACHE_MAX_CHUNK_SIZE - CHUNK_OVERHEAD)
+    {
+        void* ptr = _cached_malloc(nmemb * size);
+
+        if (ptr)
+            memset(ptr, 0, nmemb * size);
+
+        return ptr;
+    }
+
+    return dlcalloc(nmemb, size);
+}
+
+static void _cached_free(void* ptr)
+{
+    thread_cache_t* cache;
+    mchunkptr chunk;
+    size_t chunk_size;
+    size_t index;
+
+    if (!ptr)
+        return;
+
+    chunk = mem2chunk(ptr);
+    chunk_size = chunksize(chunk);
+
+    /* Let dlfree() handle large blocks and report invalid ones */
+    if (chunk_size > _CACHE_MAX_CHUNK_SIZE || !is_inuse(chunk) ||
+        !(cache = _get_thread_cache(true)))
+    {
+        dlfree(ptr);
+        return;
+    }
+
+    index = chunk_size >> 4;
+
+    if (cache->counts[index] == _CACHE_MAX_COUNT)
+        _thread_cache_release(cache, index, _CACHE_MAX_COUNT / 2);
+
+    if (cache->bytes + chunk_size > _CACHE_MAX_BYTES)
+    {
+        dlfree(ptr);
+        return;
+    }
+
+    _thread_cache_push(cache, index, ptr);
+}
+
+static size_t _get_thread_cache_bytes(void)
+{
+    size_t bytes = 0;
+
+    for (thread_cache_t* p = _caches; p; p = p->next)
+        bytes += p->bytes;
+
+    return bytes;
+}
+
+#endif /* defined(OE_USE_THREAD_CACHED_MALLOC) && !OE_USE_DEBUG_MALLOC */
+
+/* Choose release mode, thread-cached or debug mode allocation functions */
 #if defined(OE_USE_DEBUG_MALLOC)
 #define MALLOC oe_debug_malloc
 #define CALLOC oe_debug_calloc
@@ -51,6 +304,13 @@ static int _dlmalloc_stats_fprintf(FILE* stream, const char* format, ...);
 #define MEMALIGN oe_debug_memalign
 #define POSIX_MEMALIGN oe_debug_posix_memalign
 #define FREE oe_debug_free
+#elif defined(OE_USE_THREAD_CACHED_MALLOC)
+#define MALLOC _cached_malloc
+#define CALLOC _cached_calloc
+#define REALLOC dlrealloc
+#define MEMALIGN dlmemalign
+#define POSIX_MEMALIGN dlposix_memalign
+#define FREE _cached_free
 #else
 #define MALLOC dlmalloc
 #define CALLOC dlcalloc
@@ -230,6 +490,16 @@ oe_result_t oe_get_malloc_stats(oe_malloc_stats_t* stats)
 
     *stats = _malloc_stats;
 
+#if defined(OE_USE_THREAD_CACHED_MALLOC) && !defined(OE_USE_DEBUG_MALLOC)
+    /* Blocks held by the thread caches are free from the caller's view */
+    {
+        size_t cached = _get_thread_cache_bytes();
+
+        if (stats->in_use_bytes >= cached)
+            stats->in_use_bytes -= cached;
+    }
+#endif
+
     result = OE_OK;
 
 done:
@@ -12,6 +12,7 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/report.h>
 #include <openenclave/internal/sgxtypes.h>
+#include <openenclave/internal/thread.h>
 #include <openenclave/internal/utils.h>
 
 OE_STATIC_ASSERT(OE_REPORT_DATA_SIZE == sizeof(sgx_report_data_t));
@@ -129,9 +130,8 @@ static oe_result_t _oe_get_sgx_target_info(sgx_target_info_t* target_info)
 
     OE_CHECK(oe_ocall(OE_OCALL_GET_QE_TARGET_INFO, (uint64_t)args, NULL));
 
-    result = args->result;
-    if (result == OE_OK)
-        *target_info = args->target_info;
+    OE_CHECK(args->result);
+    *target_info = args->target_info;
 
     result = OE_OK;
 done:
@@ -144,13 +144,58 @@ done:
     return result;
 }
 
+/*
+ * The target info of the Quoting Enclave only changes when the QE does, in
+ * which case the quote for a report targeting the old QE fails. It is
+ * therefore fetched once and refreshed only when getting a quote fails.
+ */
+static oe_spinlock_t _qe_target_info_lock = OE_SPINLOCK_INITIALIZER;
+static sgx_target_info_t _qe_target_info;
+static bool _qe_target_info_valid;
+
+static oe_result_t _get_qe_target_info(
+    sgx_target_info_t* target_info,
+    bool refresh)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    bool found = false;
+
+    if (!refresh)
+    {
+        oe_spin_lock(&_qe_target_info_lock);
+        if (_qe_target_info_valid)
+        {
+            *target_info = _qe_target_info;
+            found = true;
+        }
+        oe_spin_unlock(&_qe_target_info_lock);
+
+        if (found)
+        {
+            result = OE_OK;
+            goto done;
+        }
+    }
+
+    OE_CHECK(_oe_get_sgx_target_info(target_info));
+
+    oe_spin_lock(&_qe_target_info_lock);
+    _qe_target_info = *target_info;
+    _qe_target_info_valid = true;
+    oe_spin_unlock(&_qe_target_info_lock);
+
+    result = OE_OK;
+done:
+    return result;
+}
+
 static oe_result_t _oe_get_quote(
     const sgx_report_t* sgx_report,
     uint8_t* quote,
     size_t* quote_size)
 {
     oe_result_t result = OE_UNEXPECTED;
-    size_t arg_size = sizeof(oe_get_qetarget_info_args_t);
+    size_t arg_size = sizeof(oe_get_quote_args_t);
 
     // If quote buffer is NULL, then ignore passed in quote_size value.
     // This treats scenarios where quote == NULL and *quote_size == large-value
@@ -163,12 +208,12 @@ static oe_result_t _oe_get_quote(
 
     oe_get_quote_args_t* args =
         (oe_get_quote_args_t*)oe_host_calloc(1, arg_size);
-    args->sgx_report = *sgx_report;
-    args->quote_size = *quote_size;
-
     if (args == NULL)
         OE_RAISE(OE_OUT_OF_MEMORY);
 
+    args->sgx_report = *sgx_report;
+    args->quote_size = *quote_size;
+
     OE_CHECK(oe_ocall(OE_OCALL_GET_QUOTE, (uint64_t)args, NULL));
     result = args->result;
 
@@ -188,6 +233,104 @@ done:
     return result;
 }
 
+/*
+ * Get the quote for the local report in a buffer allocated by the host, and
+ * copy it into a new enclave buffer after header_size bytes of space.
+ */
+static oe_result_t _get_quote_v2(
+    const sgx_report_t* sgx_report,
+    size_t header_size,
+    uint8_t** buffer,
+    size_t* quote_size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_get_quote_v2_args_t* host_args = NULL;
+    oe_get_quote_v2_args_t args = {0};
+    size_t buffer_size = 0;
+
+    *buffer = NULL;
+    *quote_size = 0;
+
+    host_args = (oe_get_quote_v2_args_t*)oe_host_calloc(1, sizeof(*host_args));
+    if (host_args == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    host_args->sgx_report = *sgx_report;
+
+    OE_CHECK(oe_ocall(OE_OCALL_GET_QUOTE_V2, (uint64_t)host_args, NULL));
+
+    // Copy args to prevent TOCTOU issues.
+    args = *host_args;
+
+    OE_CHECK(args.result);
+
+    if (args.quote == NULL || args.quote_size == 0 ||
+        args.quote_size > OE_MAX_REPORT_SIZE ||
+        !oe_is_outside_enclave(args.quote, args.quote_size))
+        OE_RAISE(OE_UNEXPECTED);
+
+    OE_CHECK(oe_safe_add_sizet(header_size, args.quote_size, &buffer_size));
+
+    *buffer = (uint8_t*)oe_malloc(buffer_size);
+    if (*buffer == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    OE_CHECK(oe_memcpy_s(
+        *buffer + header_size, args.quote_size, args.quote, args.quote_size));
+    *quote_size = args.quote_size;
+
+    result = OE_OK;
+done:
+    // Free the quote the host returned, even if it was rejected.
+    if (args.quote && oe_is_outside_enclave(args.quote, 1))
+        oe_host_free(args.quote);
+
+    if (host_args)
+    {
+        oe_secure_zero_fill(host_args, sizeof(*host_args));
+        oe_host_free(host_args);
+    }
+
+    if (result != OE_OK)
+    {
+        oe_free(*buffer);
+        *buffer = NULL;
+        *quote_size = 0;
+    }
+
+    return result;
+}
+
+/*
+ * Check that the entire report body in the returned quote matches the local
+ * report.
+ */
+static oe_result_t _check_quote(
+    const uint8_t* quote,
+    size_t quote_size,
+    const sgx_report_t* sgx_report)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const sgx_quote_t* sgx_quote = (const sgx_quote_t*)quote;
+
+    if (quote_size < sizeof(sgx_quote_t))
+        OE_RAISE(OE_UNEXPECTED);
+
+    // Ensure that report is within acceptable size.
+    if (quote_size > OE_MAX_REPORT_SIZE)
+        OE_RAISE(OE_UNEXPECTED);
+
+    if (memcmp(
+            &sgx_quote->report_body,
+            &sgx_report->body,
+            sizeof(sgx_report->body)) != 0)
+        OE_RAISE(OE_UNEXPECTED);
+
+    result = OE_OK;
+done:
+    return result;
+}
+
 oe_result_t oe_get_remote_report(
     const uint8_t* report_data,
     size_t report_data_size,
@@ -200,7 +343,6 @@ oe_result_t oe_get_remote_report(
     sgx_target_info_t sgx_target_info = {{0}};
     sgx_report_t sgx_report = {{{0}}};
     size_t sgx_report_size = sizeof(sgx_report);
-    sgx_quote_t* sgx_quote = NULL;
 
     // For remote attestation, the Quoting Enclave's target info is used.
     // opt_params must not be supplied.
@@ -208,52 +350,109 @@ oe_result_t oe_get_remote_report(
         OE_RAISE(OE_INVALID_PARAMETER);
 
     /*
-     * OCall: Get target info from Quoting Enclave.
-     * This involves a call to host. The target provided by targetinfo does not
-     * need to be trusted because returning a report is not an operation that
-     * requires privacy. The trust decision is one of integrity verification
-     * on the part of the report recipient.
+     * Get target info from Quoting Enclave, with an OCALL unless it is cached.
+     * The target provided by targetinfo does not need to be trusted because
+     * returning a report is not an operation that requires privacy. The trust
+     * decision is one of integrity verification on the part of the report
+     * recipient.
      */
-    OE_CHECK(_oe_get_sgx_target_info(&sgx_target_info));
+    for (uint32_t attempt = 0;; attempt++)
+    {
+        OE_CHECK(_get_qe_target_info(&sgx_target_info, attempt > 0));
 
-    /*
-     * Get enclave's local report passing in the quoting enclave's target info.
-     */
-    OE_CHECK(_oe_get_local_report(
-        report_data,
-        report_data_size,
-        &sgx_target_info,
-        sizeof(sgx_target_info),
-        &sgx_report,
-        &sgx_report_size));
+        /*
+         * Get enclave's local report passing in the quoting enclave's target
+         * info.
+         */
+        sgx_report_size = sizeof(sgx_report);
+        OE_CHECK(_oe_get_local_report(
+            report_data,
+            report_data_size,
+            &sgx_target_info,
+            sizeof(sgx_target_info),
+            &sgx_report,
+            &sgx_report_size));
+
+        /*
+         * OCall: Get the quote for the local report. If it fails, the cached
+         * target info may be stale, so try again once with a fresh one.
+         */
+        result = _oe_get_quote(&sgx_report, report_buffer, report_buffer_size);
+        if (result == OE_OK || result == OE_BUFFER_TOO_SMALL || attempt > 0)
+            break;
+    }
+    OE_CHECK(result);
 
-    /*
-     * OCall: Get the quote for the local report.
-     */
-    OE_CHECK(_oe_get_quote(&sgx_report, report_buffer, report_buffer_size));
+    OE_CHECK(_check_quote(report_buffer, *report_buffer_size, &sgx_report));
 
-    /*
-     * Check that the entire report body in the returned quote matches the local
-     * report.
-     */
-    if (*report_buffer_size < sizeof(sgx_quote_t))
-        OE_RAISE(OE_UNEXPECTED);
+    result = OE_OK;
+done:
 
-    sgx_quote = (sgx_quote_t*)report_buffer;
+    return result;
+}
 
-    // Ensure that report is within acceptable size.
-    if (*report_buffer_size > OE_MAX_REPORT_SIZE)
-        OE_RAISE(OE_UNEXPECTED);
+/*
+ * Generate a remote report in a single pass, in a new buffer of the report
+ * header followed by the quote.
+ */
+static oe_result_t _get_remote_report_v2(
+    const uint8_t* report_data,
+    size_t report_data_size,
+    const void* opt_params,
+    size_t opt_params_size,
+    uint8_t** report_buffer,
+    size_t* report_buffer_size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    sgx_target_info_t sgx_target_info = {{0}};
+    sgx_report_t sgx_report = {{{0}}};
+    size_t sgx_report_size = sizeof(sgx_report);
+    oe_report_header_t* header = NULL;
+    uint8_t* buffer = NULL;
+    size_t quote_size = 0;
 
-    if (memcmp(
-            &sgx_quote->report_body,
-            &sgx_report.body,
-            sizeof(sgx_report.body)) != 0)
-        OE_RAISE(OE_UNEXPECTED);
+    // For remote attestation, the Quoting Enclave's target info is used.
+    // opt_params must not be supplied.
+    if (opt_params != NULL || opt_params_size != 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (uint32_t attempt = 0;; attempt++)
+    {
+        OE_CHECK(_get_qe_target_info(&sgx_target_info, attempt > 0));
 
+        sgx_report_size = sizeof(sgx_report);
+        OE_CHECK(_oe_get_local_report(
+            report_data,
+            report_data_size,
+            &sgx_target_info,
+            sizeof(sgx_target_info),
+            &sgx_report,
+            &sgx_report_size));
+
+        // If the quote fails, the cached target info may be stale, so try
+        // again once with a fresh one.
+        result = _get_quote_v2(
+            &sgx_report, sizeof(oe_report_header_t), &buffer, &quote_size);
+        if (result == OE_OK || attempt > 0)
+            break;
+    }
+    OE_CHECK(result);
+
+    OE_CHECK(_check_quote(
+        buffer + sizeof(oe_report_header_t), quote_size, &sgx_report));
+
+    header = (oe_report_header_t*)buffer;
+    header->version = OE_REPORT_HEADER_VERSION;
+    header->report_type = OE_REPORT_TYPE_SGX_REMOTE;
+    header->report_size = quote_size;
+
+    *report_buffer = buffer;
+    *report_buffer_size = sizeof(oe_report_header_t) + quote_size;
+    buffer = NULL;
     result = OE_OK;
-done:
 
+done:
+    oe_free(buffer);
     return result;
 }
 
@@ -341,6 +540,18 @@ oe_result_t oe_get_report_v2(
     *report_buffer = NULL;
     *report_buffer_size = 0;
 
+    // Remote reports are generated once, into a buffer sized by the host.
+    if (flags & OE_REPORT_FLAGS_REMOTE_ATTESTATION)
+    {
+        return _get_remote_report_v2(
+            report_data,
+            report_data_size,
+            opt_params,
+            opt_params_size,
+            report_buffer,
+            report_buffer_size);
+    }
+
     result = oe_get_report_v1(
         flags,
         report_data,
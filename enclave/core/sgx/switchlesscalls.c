@@ -0,0 +1,171 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/bits/safemath.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/atomic.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/switchless.h>
+#include "switchlesscalls.h"
+
+/* Enclave copies of the manager fields, captured once at initialization */
+static oe_host_worker_context_t* _host_worker_contexts = NULL;
+static size_t _num_host_workers = 0;
+
+/*
+**==============================================================================
+**
+** oe_handle_init_switchless()
+**
+**     Handle OE_ECALL_INIT_CONTEXT_SWITCHLESS. The manager and the worker
+**     contexts live in host memory.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_handle_init_switchless(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager =
+        (oe_switchless_call_manager_t*)arg_in;
+    oe_switchless_call_manager_t safe_manager;
+    size_t contexts_size;
+
+    if (_host_worker_contexts)
+        OE_RAISE(OE_UNEXPECTED);
+
+    if (!manager || !oe_is_outside_enclave(manager, sizeof(*manager)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    safe_manager = *manager;
+
+    if (!safe_manager.host_worker_contexts || !safe_manager.num_host_workers)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(oe_safe_mul_sizet(
+        safe_manager.num_host_workers,
+        sizeof(oe_host_worker_context_t),
+        &contexts_size));
+
+    if (!oe_is_outside_enclave(safe_manager.host_worker_contexts, contexts_size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    _num_host_workers = safe_manager.num_host_workers;
+    _host_worker_contexts = safe_manager.host_worker_contexts;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_post_switchless_ocall()
+**
+**     Post the call to an idle host worker and wait for its completion
+**     without leaving the enclave. Returns OE_CONTEXT_SWITCHLESS_OCALL_MISSED
+**     if there are no workers or all of them are busy, in which case the
+**     caller should make a regular OCALL.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args)
+{
+    volatile oe_result_t* call_result = &args->result;
+
+    args->result = OE_SWITCHLESS_CALL_PENDING;
+
+    for (size_t i = 0; i < _num_host_workers; i++)
+    {
+        oe_host_worker_context_t* context = &_host_worker_contexts[i];
+
+        if (!oe_atomic_compare_and_swap_ptr(
+                (void* volatile*)&context->call_arg, NULL, args))
+            continue;
+
+        /* Wake the worker if it parked itself before seeing the call */
+        if (context->worker.event == (uint32_t)-1)
+            oe_ocall(OE_OCALL_WAKE_HOST_WORKER, (uint64_t)context, NULL);
+
+        while (*call_result == OE_SWITCHLESS_CALL_PENDING)
+            oe_cpu_relax();
+
+        return OE_OK;
+    }
+
+    return OE_CONTEXT_SWITCHLESS_OCALL_MISSED;
+}
+
+/*
+**==============================================================================
+**
+** oe_handle_launch_enclave_worker()
+**
+**     Handle OE_ECALL_LAUNCH_ENCLAVE_WORKER. Runs the dispatch loop of an
+**     enclave worker on the calling TCS until the host stops it. Calls are
+**     dispatched through the same path as regular ECALLs.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_handle_launch_enclave_worker(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_enclave_worker_context_t* context =
+        (oe_enclave_worker_context_t*)arg_in;
+    uint64_t spin_count = 0;
+
+    if (!context || !oe_is_outside_enclave(context, sizeof(*context)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    context->is_running = true;
+
+    for (;;)
+    {
+        oe_call_enclave_function_args_t* call_arg = context->call_arg;
+
+        if (call_arg)
+        {
+            bool valid = oe_is_outside_enclave(call_arg, sizeof(*call_arg));
+
+            if (valid)
+                result = oe_dispatch_call_enclave_function((uint64_t)call_arg);
+
+            context->total_call_count++;
+            context->total_spin_count += spin_count;
+            spin_count = 0;
+
+            /* Free the worker before publishing the result, which must be
+             * the last access: the host may post its next call as soon as it
+             * sees the result, or release call_arg */
+            context->call_arg = NULL;
+
+            if (valid)
+                *(volatile oe_result_t*)&call_arg->result = result;
+        }
+        else if (context->worker.is_stopping)
+        {
+            break;
+        }
+        else if (++spin_count >= OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD)
+        {
+            context->total_spin_count += spin_count;
+            spin_count = 0;
+            oe_ocall(OE_OCALL_WAIT_ENCLAVE_WORKER, (uint64_t)context, NULL);
+        }
+        else
+        {
+            oe_cpu_relax();
+        }
+    }
+
+    context->is_running = false;
+    result = OE_OK;
+
+done:
+    return result;
+}
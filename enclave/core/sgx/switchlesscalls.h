@@ -0,0 +1,19 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_SWITCHLESSCALLS_H
+#define _OE_SWITCHLESSCALLS_H
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+
+oe_result_t oe_handle_init_switchless(uint64_t arg_in);
+
+oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args);
+
+oe_result_t oe_handle_launch_enclave_worker(uint64_t arg_in);
+
+/* Defined in calls.c */
+oe_result_t oe_dispatch_call_enclave_function(uint64_t arg_in);
+
+#endif /* _OE_SWITCHLESSCALLS_H */
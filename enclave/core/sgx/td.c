@@ -10,6 +10,7 @@
 #include <openenclave/internal/globals.h>
 #include <openenclave/internal/sgxtypes.h>
 #include <openenclave/internal/utils.h>
+#include "arena.h"
 #include "asmdefs.h"
 #include "thread.h"
 
@@ -302,6 +303,12 @@ void td_clear(td_t* td)
     if (td->depth != 0 || td->callsites != NULL)
         oe_abort();
 
+    /* No OCALL buffers are in use once the ECALL stack is unwound */
+    oe_ocall_arena_reset(td);
+
+    /* Drop any wake-up that was posted but never consumed */
+    td->wait_state = 0;
+
     /* Clear base structure */
     memset(&td->base, 0, sizeof(td->base));
 
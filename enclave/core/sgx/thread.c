@@ -5,6 +5,7 @@
 #include <openenclave/bits/safecrt.h>
 #include <openenclave/corelibc/string.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/sgxtypes.h>
@@ -16,22 +17,110 @@
 **
 ** Host requests:
 **
+**     A thread that must wait first spins for up to _spin_count iterations
+**     before asking the host to wait (OE_OCALL_THREAD_WAIT). The waiter's
+**     td_t.wait_state field tells the waker whether it went to the host:
+**
+**         _WAIT_STATE_NONE      - no wake-up is pending
+**         _WAIT_STATE_SIGNALED  - a wake-up was posted while the waiter spun
+**         _WAIT_STATE_SLEEPING  - the waiter is waiting (or about to wait) on
+**                                 the host
+**
+**     The waker only performs the OE_OCALL_THREAD_WAKE OCALL when it replaces
+**     _WAIT_STATE_SLEEPING, so a hand-off within the spin window takes no
+**     OCALL on either side. Callers of _thread_wait() recheck their condition
+**     in a loop, so a spurious return is harmless.
+**
 **==============================================================================
 */
 
-static int _thread_wait(oe_thread_data_t* self)
+#define _WAIT_STATE_NONE 0
+#define _WAIT_STATE_SIGNALED 1
+#define _WAIT_STATE_SLEEPING 2
+
+static volatile uint64_t _spin_count = OE_THREAD_DEFAULT_SPIN_COUNT;
+static volatile uint64_t _num_wait_ocalls;
+static volatile uint64_t _num_wake_ocalls;
+
+void oe_thread_set_spin_count(uint64_t spin_count)
+{
+    _spin_count = spin_count;
+}
+
+void oe_thread_get_ocall_counts(uint64_t* num_waits, uint64_t* num_wakes)
+{
+    if (num_waits)
+        *num_waits = _num_wait_ocalls;
+
+    if (num_wakes)
+        *num_wakes = _num_wake_ocalls;
+}
+
+/* Whether the given thread has left the enclave to perform an OCALL */
+static bool _thread_is_outside(const oe_thread_data_t* thread)
 {
-    const void* tcs = td_to_tcs((td_t*)self);
+    return ((const td_t*)thread)->ocall_depth != 0;
+}
+
+/* Spin until a wake-up is posted for self, or until the thread we are
+ * waiting on (if known) leaves the enclave. Return true if woken. */
+static bool _thread_spin(td_t* self, const oe_thread_data_t* owner)
+{
+    for (uint64_t i = 0; i < _spin_count; i++)
+    {
+        if (self->wait_state == _WAIT_STATE_SIGNALED)
+            break;
+
+        if (owner && _thread_is_outside(owner))
+            break;
+
+        oe_cpu_relax();
+    }
+
+    /* Consume the wake-up, if any, or announce that self is going to sleep */
+    if (oe_atomic_compare_and_swap_u32(
+            &self->wait_state, _WAIT_STATE_NONE, _WAIT_STATE_SLEEPING))
+        return false;
+
+    oe_atomic_exchange_u32(&self->wait_state, _WAIT_STATE_NONE);
+    return true;
+}
+
+/* Post a wake-up to the given thread. Return true if it must be woken by
+ * the host. */
+static bool _thread_signal(oe_thread_data_t* waiter)
+{
+    td_t* td = (td_t*)waiter;
+
+    return oe_atomic_exchange_u32(&td->wait_state, _WAIT_STATE_SIGNALED) ==
+           _WAIT_STATE_SLEEPING;
+}
+
+static int _thread_wait(oe_thread_data_t* self, const oe_thread_data_t* owner)
+{
+    td_t* td = (td_t*)self;
+    const void* tcs = td_to_tcs(td);
+    int ret = 0;
+
+    if (_thread_spin(td, owner))
+        return 0;
+
+    oe_atomic_increment(&_num_wait_ocalls);
 
     if (oe_ocall(OE_OCALL_THREAD_WAIT, (uint64_t)tcs, NULL) != OE_OK)
-        return -1;
+        ret = -1;
 
-    return 0;
+    oe_atomic_exchange_u32(&td->wait_state, _WAIT_STATE_NONE);
+
+    return ret;
 }
 
-static int _thread_wake(oe_thread_data_t* self)
+/* Ask the host to wake a waiter that was signaled by _thread_signal() */
+static int _thread_wake_sleeping(oe_thread_data_t* waiter)
 {
-    const void* tcs = td_to_tcs((td_t*)self);
+    const void* tcs = td_to_tcs((td_t*)waiter);
+
+    oe_atomic_increment(&_num_wake_ocalls);
 
     if (oe_ocall(OE_OCALL_THREAD_WAKE, (uint64_t)tcs, NULL) != OE_OK)
         return -1;
@@ -39,23 +128,52 @@ static int _thread_wake(oe_thread_data_t* self)
     return 0;
 }
 
+static int _thread_wake(oe_thread_data_t* waiter)
+{
+    if (!_thread_signal(waiter))
+        return 0;
+
+    return _thread_wake_sleeping(waiter);
+}
+
 static int _thread_wake_wait(oe_thread_data_t* waiter, oe_thread_data_t* self)
 {
     int ret = -1;
+    td_t* td = (td_t*)self;
     oe_thread_wake_wait_args_t* args = NULL;
 
+    /* The waiter is still spinning, so only self may need the host */
+    if (!_thread_signal(waiter))
+        return _thread_wait(self, NULL);
+
+    /* Self was woken in the meantime, so only the waiter needs the host */
+    if (!oe_atomic_compare_and_swap_u32(
+            &td->wait_state, _WAIT_STATE_NONE, _WAIT_STATE_SLEEPING))
+    {
+        oe_atomic_exchange_u32(&td->wait_state, _WAIT_STATE_NONE);
+        return _thread_wake_sleeping(waiter);
+    }
+
     if (!(args = oe_host_calloc(1, sizeof(oe_thread_wake_wait_args_t))))
+    {
+        /* The waiter was signaled above, so it must still be woken */
+        _thread_wake_sleeping(waiter);
         goto done;
+    }
 
     args->waiter_tcs = td_to_tcs((td_t*)waiter);
     args->self_tcs = td_to_tcs((td_t*)self);
 
+    oe_atomic_increment(&_num_wake_ocalls);
+    oe_atomic_increment(&_num_wait_ocalls);
+
     if (oe_ocall(OE_OCALL_THREAD_WAKE_WAIT, (uint64_t)args, NULL) != OE_OK)
         goto done;
 
     ret = 0;
 
 done:
+    oe_atomic_exchange_u32(&td->wait_state, _WAIT_STATE_NONE);
     oe_host_free(args);
     return ret;
 }
@@ -218,6 +336,41 @@ static int _mutex_lock(oe_mutex_impl_t* m, oe_thread_data_t* self)
     return -1;
 }
 
+/*
+ * Spin while the mutex is held by a thread that is running in the enclave,
+ * retrying to acquire it whenever it is released. Stop spinning when the
+ * owner leaves the enclave or other threads are already queued, since the
+ * wait is then likely to outlast an OCALL. Return true if the mutex was
+ * acquired.
+ */
+static bool _mutex_spin(oe_mutex_impl_t* m, oe_thread_data_t* self)
+{
+    for (uint64_t i = 0; i <= _spin_count; i++)
+    {
+        oe_thread_data_t* owner = *(oe_thread_data_t* volatile*)&m->owner;
+
+        if (!owner || owner == self)
+        {
+            int ret;
+
+            oe_spin_lock(&m->lock);
+            ret = _mutex_lock(m, self);
+            oe_spin_unlock(&m->lock);
+
+            if (ret == 0)
+                return true;
+        }
+
+        if ((owner && _thread_is_outside(owner)) ||
+            *(oe_thread_data_t* volatile*)&m->queue.front)
+            break;
+
+        oe_cpu_relax();
+    }
+
+    return false;
+}
+
 oe_result_t oe_mutex_lock(oe_mutex_t* mutex)
 {
     oe_mutex_impl_t* m = (oe_mutex_impl_t*)mutex;
@@ -226,9 +379,15 @@ oe_result_t oe_mutex_lock(oe_mutex_t* mutex)
     if (!m)
         return OE_INVALID_PARAMETER;
 
+    /* Acquire the mutex without queueing if it is released soon */
+    if (_mutex_spin(m, self))
+        return OE_OK;
+
     /* Loop until SELF obtains mutex */
     for (;;)
     {
+        oe_thread_data_t* owner;
+
         oe_spin_lock(&m->lock);
         {
             /* Attempt to acquire lock */
@@ -244,11 +403,13 @@ oe_result_t oe_mutex_lock(oe_mutex_t* mutex)
                 /* Insert thread at back of waiters queue */
                 _queue_push_back(&m->queue, self);
             }
+
+            owner = m->owner;
         }
         oe_spin_unlock(&m->lock);
 
         /* Ask host to wait for an event on this thread */
-        _thread_wait(self);
+        _thread_wait(self, owner);
     }
 
     /* Unreachable! */
@@ -440,7 +601,7 @@ oe_result_t oe_cond_wait(oe_cond_t* condition, oe_mutex_t* mutex)
                 }
                 else
                 {
-                    _thread_wait(self);
+                    _thread_wait(self, NULL);
                 }
             }
             oe_spin_lock(&cond->lock);
@@ -562,12 +723,14 @@ oe_result_t oe_rwlock_rdlock(oe_rwlock_t* read_write_lock)
     // Multiple readers can concurrently operate.
     while (rw_lock->writer != NULL)
     {
+        oe_thread_data_t* writer = rw_lock->writer;
+
         // Add self to list of waiters, and go to wait state.
         if (!_queue_contains(&rw_lock->queue, self))
             _queue_push_back(&rw_lock->queue, self);
 
         oe_spin_unlock(&rw_lock->lock);
-        _thread_wait(self);
+        _thread_wait(self, writer);
 
         // Upon waking, re-acquire the lock.
         // Just like a condition variable.
@@ -676,13 +839,15 @@ oe_result_t oe_rwlock_wrlock(oe_rwlock_t* read_write_lock)
     // Wait for all readers and any other writer to finish.
     while (rw_lock->readers > 0 || rw_lock->writer != NULL)
     {
+        oe_thread_data_t* writer = rw_lock->writer;
+
         // Add self to list of waiters, and go to wait state.
         if (!_queue_contains(&rw_lock->queue, self))
             _queue_push_back(&rw_lock->queue, self);
 
         oe_spin_unlock(&rw_lock->lock);
 
-        _thread_wait(self);
+        _thread_wait(self, writer);
 
         // Upon waking, re-acquire the lock.
         // Just like a condition variable.
@@ -8,9 +8,12 @@
 #include <openenclave/corelibc/stdio.h>
 #include <openenclave/corelibc/string.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/report.h>
 #include <openenclave/internal/sgxtypes.h>
+#include <openenclave/internal/thread.h>
+#include <openenclave/internal/time.h>
 #include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
 #include "report.h"
@@ -18,6 +21,11 @@
 static log_level_t _active_log_level = OE_LOG_LEVEL_ERROR;
 static char _enclave_filename[MAX_FILENAME_LEN];
 static bool _debug_allowed_enclave = false;
+static oe_log_ring_t* _log_ring;
+
+/* Number of times the ring is drained for a record before it is sent with
+ * OE_OCALL_LOG instead */
+#define _LOG_RING_MAX_DRAINS 8
 
 const char* get_filename_from_path(const char* path, size_t path_len)
 {
@@ -110,18 +118,131 @@ oe_result_t _handle_oelog_init(uint64_t arg)
     }
 
     _debug_allowed_enclave = is_enclave_debug_allowed();
+
+    if (local.ring)
+    {
+        if (!oe_is_outside_enclave(local.ring, sizeof(oe_log_ring_t)))
+        {
+            result = OE_INVALID_PARAMETER;
+            goto done;
+        }
+
+        _log_ring = local.ring;
+    }
+
     result = OE_OK;
 done:
     return result;
 }
 
-oe_result_t oe_log(log_level_t level, const char* fmt, ...)
+/*
+**==============================================================================
+**
+** _write_log_ring()
+**
+**     Append a record to the log ring (see oe_log_ring_t). Return false if
+**     the ring is full. The offsets are read from host memory, so they are
+**     only used modulo the size of the ring: a host that corrupts them only
+**     loses log records.
+**
+**==============================================================================
+*/
+
+static void _copy_to_log_ring(uint32_t offset, const void* data, size_t size)
+{
+    size_t start = offset & (OE_LOG_RING_SIZE - 1);
+    size_t n = OE_LOG_RING_SIZE - start;
+
+    if (n > size)
+        n = size;
+
+    memcpy(&_log_ring->data[start], data, n);
+    memcpy(_log_ring->data, (const uint8_t*)data + n, size - n);
+}
+
+static bool _write_log_ring(oe_log_record_t* record)
+{
+    uint32_t head;
+    uint32_t size = record->size;
+    volatile uint32_t* commit;
+
+    /* Reserve size bytes */
+    do
+    {
+        uint32_t tail = _log_ring->tail;
+        uint32_t used;
+
+        head = _log_ring->head;
+        used = head - tail;
+
+        if ((head & 7) || used > OE_LOG_RING_SIZE ||
+            OE_LOG_RING_SIZE - used < size)
+            return false;
+    } while (!oe_atomic_compare_and_swap_u32(
+        &_log_ring->head, head, head + size));
+
+    commit =
+        (volatile uint32_t*)&_log_ring->data[head & (OE_LOG_RING_SIZE - 1)];
+
+    /* Tell the host how much to skip should this thread never finish */
+    oe_atomic_exchange_u32(commit, size | OE_LOG_RECORD_PENDING);
+
+    /* Copy everything but the size, which then marks the record complete */
+    _copy_to_log_ring(
+        head + sizeof(record->size),
+        (const uint8_t*)record + sizeof(record->size),
+        sizeof(oe_log_record_t) - sizeof(record->size) + record->message_size);
+
+    oe_atomic_exchange_u32(commit, size);
+
+    return true;
+}
+
+static oe_result_t _write_log_ocall(log_level_t level, const char* message)
 {
     oe_result_t result = OE_FAILURE;
     oe_log_args_t* args = NULL;
+
+    // Prepare a log record for sending to the host for logging
+    if (!(args = oe_host_malloc(sizeof(oe_log_args_t))))
+    {
+        result = OE_OUT_OF_MEMORY;
+        goto done;
+    }
+
+    args->level = level;
+
+    if (oe_snprintf(
+            args->message,
+            OE_LOG_MESSAGE_LEN_MAX,
+            "%s:%s",
+            _enclave_filename,
+            message) < 0)
+        goto done;
+
+    // send over to the host
+    if (oe_ocall(OE_OCALL_LOG, (uint64_t)args, NULL) != OE_OK)
+        goto done;
+
+    result = OE_OK;
+done:
+    if (args)
+    {
+        oe_host_free(args);
+    }
+    return result;
+}
+
+oe_result_t oe_log(log_level_t level, const char* fmt, ...)
+{
+    oe_result_t result = OE_FAILURE;
+    struct
+    {
+        oe_log_record_t header;
+        char message[OE_LOG_MESSAGE_LEN_MAX];
+    } record;
     oe_va_list ap;
     int n = 0;
-    int bytes_written = 0;
 
     // skip logging for non-debug-allowed enclaves
     if (!_debug_allowed_enclave)
@@ -143,41 +264,42 @@ oe_result_t oe_log(log_level_t level, const char* fmt, ...)
         goto done;
     }
 
-    // Prepare a log record for sending to the host for logging
-    if (!(args = oe_host_malloc(sizeof(oe_log_args_t))))
-    {
-        result = OE_OUT_OF_MEMORY;
-        goto done;
-    }
-
-    bytes_written = oe_snprintf(
-        args->message, OE_LOG_MESSAGE_LEN_MAX, "%s:", _enclave_filename);
-
-    if (bytes_written < 0)
-        goto done;
-
-    args->level = level;
     oe_va_start(ap, fmt);
-    n = oe_vsnprintf(
-        &args->message[bytes_written],
-        OE_LOG_MESSAGE_LEN_MAX - (size_t)bytes_written,
-        fmt,
-        ap);
+    n = oe_vsnprintf(record.message, sizeof(record.message), fmt, ap);
     oe_va_end(ap);
 
     if (n < 0)
         goto done;
 
-    // send over to the host
-    if (oe_ocall(OE_OCALL_LOG, (uint64_t)args, NULL) != OE_OK)
-        goto done;
-
-    result = OE_OK;
-done:
-    if (args)
+    if (_log_ring)
     {
-        oe_host_free(args);
+        // The host formats the record with the enclave name and the time
+        record.header.level = (uint32_t)level;
+        record.header.realtime_ns = oe_get_realtime_ns();
+        record.header.thread_id = (uint64_t)oe_thread_self();
+        record.header.message_size = (uint32_t)oe_strlen(record.message);
+        record.header.reserved = 0;
+        record.header.size =
+            (uint32_t)oe_round_up_to_multiple(
+                sizeof(oe_log_record_t) + record.header.message_size, 8);
+
+        // While the ring is full, have the host drain it
+        for (size_t i = 0; i <= _LOG_RING_MAX_DRAINS; i++)
+        {
+            if (_write_log_ring(&record.header))
+            {
+                result = OE_OK;
+                goto done;
+            }
+
+            if (i < _LOG_RING_MAX_DRAINS &&
+                oe_ocall(OE_OCALL_DRAIN_LOG, 0, NULL) != OE_OK)
+                break;
+        }
     }
+
+    result = _write_log_ocall(level, record.message);
+done:
     return result;
 }
 
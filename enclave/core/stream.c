@@ -0,0 +1,167 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/corelibc/stdlib.h>
+#include <openenclave/corelibc/string.h>
+#include <openenclave/edger8r/enclave.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/raise.h>
+
+/*
+**==============================================================================
+**
+** Stream parameters
+**
+**     The host passes the buffer of a parameter with the 'stream' EDL
+**     attribute as a bare pointer instead of serializing it into the input
+**     or output buffer. A reader copies it into enclave memory one window
+**     at a time, alternating between two windows so that the previous one
+**     stays valid while the next one is filled. A writer copies straight
+**     to the host buffer. Either way, every byte is copied exactly once and
+**     the enclave memory used is bounded by the two windows.
+**
+**==============================================================================
+*/
+
+#define OE_STREAM_WINDOW_SIZE (64 * 1024)
+
+oe_result_t oe_stream_reader_init(
+    oe_stream_reader_t* reader,
+    const void* data,
+    size_t size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!reader)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    memset(reader, 0, sizeof(oe_stream_reader_t));
+
+    if (!data)
+        size = 0;
+
+    if (size && !oe_is_outside_enclave(data, size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    reader->data = (const uint8_t*)data;
+    reader->size = size;
+    reader->window_size =
+        size < OE_STREAM_WINDOW_SIZE ? size : OE_STREAM_WINDOW_SIZE;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+void oe_stream_reader_free(oe_stream_reader_t* reader)
+{
+    if (reader)
+    {
+        oe_free(reader->windows[0]);
+        oe_free(reader->windows[1]);
+        memset(reader, 0, sizeof(oe_stream_reader_t));
+    }
+}
+
+oe_result_t oe_stream_read(
+    oe_stream_reader_t* reader,
+    const void** data,
+    size_t* size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t n;
+    uint8_t* window;
+
+    if (data)
+        *data = NULL;
+
+    if (size)
+        *size = 0;
+
+    if (!reader || !data || !size || reader->offset > reader->size)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* The whole buffer has been read */
+    if ((n = reader->size - reader->offset) == 0)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    if (n > reader->window_size)
+        n = reader->window_size;
+
+    /* Fill the window other than the one returned last */
+    reader->current ^= 1;
+
+    if (!(window = reader->windows[reader->current]))
+    {
+        if (!(window = (uint8_t*)oe_malloc(reader->window_size)))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        reader->windows[reader->current] = window;
+    }
+
+    memcpy(window, reader->data + reader->offset, n);
+    reader->offset += n;
+
+    *data = window;
+    *size = n;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_stream_writer_init(
+    oe_stream_writer_t* writer,
+    void* data,
+    size_t size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!writer)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    memset(writer, 0, sizeof(oe_stream_writer_t));
+
+    if (!data)
+        size = 0;
+
+    if (size && !oe_is_outside_enclave(data, size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    writer->data = (uint8_t*)data;
+    writer->size = size;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_stream_write(
+    oe_stream_writer_t* writer,
+    const void* data,
+    size_t size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!writer || (!data && size) || writer->offset > writer->size)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (size > writer->size - writer->offset)
+        OE_RAISE(OE_BUFFER_TOO_SMALL);
+
+    if (size)
+    {
+        memcpy(writer->data + writer->offset, data, size);
+        writer->offset += size;
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
@@ -3,6 +3,7 @@
 
 #include <openenclave/bits/types.h>
 #include <openenclave/corelibc/time.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/time.h>
 
@@ -20,19 +21,159 @@ done:
     return ret;
 }
 
-uint64_t oe_get_time(void)
+/*
+**==============================================================================
+**
+** Shared clock
+**
+**     The host passes a clock page (oe_shared_clock_t) in untrusted memory
+**     when the enclave is initialized and keeps it up to date. Reading it
+**     does not leave the enclave. The values are host-supplied just like the
+**     result of OE_OCALL_GET_TIME, so the monotonic time is clamped to never
+**     go backwards. The times only advance when the host refreshes the page,
+**     every OE_SHARED_CLOCK_UPDATE_INTERVAL milliseconds. They are not
+**     extrapolated with the TSC, since RDTSC faults in SGX1 enclaves.
+**
+**     The host thread that refreshes the page is started with
+**     OE_OCALL_START_SHARED_CLOCK on the first read. If it cannot be started,
+**     the page is never used, since its time would stand still.
+**
+**     Once the page is in use, all times come from it. The OE_OCALL_GET_TIME
+**     real time is only used when there is no page, and it is clamped
+**     separately so that the two clock domains are never compared.
+**
+**==============================================================================
+*/
+
+#define _NSEC_PER_MSEC 1000000UL
+
+static const oe_shared_clock_t* _shared_clock;
+
+/* Whether the host refreshes the page: one of the values below */
+static volatile uint32_t _shared_clock_state;
+
+#define _SHARED_CLOCK_UNKNOWN 0
+#define _SHARED_CLOCK_RUNNING 1
+#define _SHARED_CLOCK_UNAVAILABLE 2
+
+/* The largest monotonic time returned so far from the clock page */
+static volatile uint64_t _last_monotonic_ns;
+
+/* The largest time returned so far by oe_get_monotonic_ns() without a page */
+static volatile uint64_t _last_fallback_ns;
+
+void oe_set_shared_clock(const oe_shared_clock_t* clock)
 {
-    uint64_t ret = (uint64_t)-1;
+    _shared_clock = clock;
+}
 
-    if (oe_ocall(OE_OCALL_GET_TIME, 0, &ret) != OE_OK)
+/* Ask the host to start refreshing the clock page, the first time only */
+static bool _start_shared_clock(void)
+{
+    if (_shared_clock_state == _SHARED_CLOCK_UNKNOWN)
     {
-        ret = (uint32_t)-1;
-        goto done;
+        uint64_t ret = (uint64_t)-1;
+        uint32_t state = _SHARED_CLOCK_UNAVAILABLE;
+
+        if (oe_ocall(OE_OCALL_START_SHARED_CLOCK, 0, &ret) == OE_OK &&
+            ret == 0)
+            state = _SHARED_CLOCK_RUNNING;
+
+        /* Concurrent first readers all agree on the first answer */
+        oe_atomic_compare_and_swap_u32(
+            &_shared_clock_state, _SHARED_CLOCK_UNKNOWN, state);
     }
 
-done:
+    return _shared_clock_state == _SHARED_CLOCK_RUNNING;
+}
 
-    return ret;
+static bool _read_shared_clock(uint64_t* realtime_ns, uint64_t* monotonic_ns)
+{
+    const oe_shared_clock_t* clock = _shared_clock;
+
+    if (!clock || !_start_shared_clock())
+        return false;
+
+    /* The host holds the sequence odd only while it writes the times, so
+     * spin until it publishes a consistent snapshot */
+    for (;;)
+    {
+        uint64_t sequence = clock->sequence;
+
+        if (sequence != 0 && !(sequence & 1))
+        {
+            *realtime_ns = clock->realtime_ns;
+            *monotonic_ns = clock->monotonic_ns;
+
+            if (clock->sequence == sequence)
+                return true;
+        }
+
+        oe_cpu_relax();
+    }
+}
+
+static uint64_t _get_time_ocall_ns(void)
+{
+    uint64_t msec = (uint64_t)-1;
+
+    if (oe_ocall(OE_OCALL_GET_TIME, 0, &msec) != OE_OK ||
+        msec == (uint64_t)-1)
+        return (uint64_t)-1;
+
+    return msec * _NSEC_PER_MSEC;
+}
+
+/* Return the larger of ns and the largest time returned so far */
+static uint64_t _clamp_ns(volatile uint64_t* last_ns, uint64_t ns)
+{
+    uint64_t last;
+
+    do
+    {
+        last = *last_ns;
+
+        if (ns <= last)
+            return last;
+    } while (!oe_atomic_compare_and_swap_u64(last_ns, last, ns));
+
+    return ns;
+}
+
+uint64_t oe_get_realtime_ns(void)
+{
+    uint64_t realtime_ns;
+    uint64_t monotonic_ns;
+
+    if (_read_shared_clock(&realtime_ns, &monotonic_ns))
+        return realtime_ns;
+
+    return _get_time_ocall_ns();
+}
+
+uint64_t oe_get_monotonic_ns(void)
+{
+    uint64_t realtime_ns;
+    uint64_t monotonic_ns;
+
+    if (_read_shared_clock(&realtime_ns, &monotonic_ns))
+        return _clamp_ns(&_last_monotonic_ns, monotonic_ns);
+
+    /* Without the clock page, fall back to the (clamped) real time */
+    if ((realtime_ns = _get_time_ocall_ns()) == (uint64_t)-1)
+        return (uint64_t)-1;
+
+    return _clamp_ns(&_last_fallback_ns, realtime_ns);
+}
+
+uint64_t oe_get_time(void)
+{
+    uint64_t ns = oe_get_realtime_ns();
+
+    if (ns == (uint64_t)-1)
+        return (uint64_t)-1;
+
+    return ns / _NSEC_PER_MSEC;
 }
 
 /* OE core libc wrapper for time() function */
@@ -92,7 +92,7 @@ static oe_result_t _generate_key_pair(
     oe_public_key_t* public_key)
 {
     oe_result_t result = OE_UNEXPECTED;
-    mbedtls_ctr_drbg_context* drbg;
+    mbedtls_ctr_drbg_context* drbg = NULL;
     mbedtls_pk_context pk;
     mbedtls_ecp_group_id curve;
     int rc = 0;
@@ -125,7 +125,7 @@ static oe_result_t _generate_key_pair(
     }
 
     /* Get the drbg object */
-    if (!(drbg = oe_mbedtls_get_drbg()))
+    if (!(drbg = oe_mbedtls_acquire_drbg()))
         OE_RAISE(OE_FAILURE);
 
     /* Create key struct */
@@ -150,6 +150,9 @@ static oe_result_t _generate_key_pair(
 
 done:
 
+    if (drbg)
+        oe_mbedtls_release_drbg(drbg);
+
     mbedtls_pk_free(&pk);
 
     if (result != OE_OK)
@@ -330,7 +333,7 @@ oe_result_t oe_ec_generate_key_pair_from_private(
     int mbedtls_result;
     mbedtls_pk_context key;
     mbedtls_ecp_keypair* keypair;
-    mbedtls_ctr_drbg_context* drbg;
+    mbedtls_ctr_drbg_context* drbg = NULL;
 
     mbedtls_pk_init(&key);
 
@@ -360,7 +363,7 @@ oe_result_t oe_ec_generate_key_pair_from_private(
     if (mbedtls_result != 0)
         OE_RAISE_MSG(OE_FAILURE, "mbedtls error: 0x%x", mbedtls_result);
 
-    if (!(drbg = oe_mbedtls_get_drbg()))
+    if (!(drbg = oe_mbedtls_acquire_drbg()))
         OE_RAISE(OE_FAILURE);
 
     /*
@@ -396,6 +399,9 @@ oe_result_t oe_ec_generate_key_pair_from_private(
     result = OE_OK;
 
 done:
+    if (drbg)
+        oe_mbedtls_release_drbg(drbg);
+
     mbedtls_pk_free(&key);
     return result;
 }
@@ -3,7 +3,10 @@
 
 #include "random.h"
 #include <mbedtls/entropy.h>
+#include <mbedtls/entropy_poll.h>
+#include <openenclave/corelibc/stdlib.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/random.h>
 #include <openenclave/internal/thread.h>
@@ -11,23 +14,69 @@
 /*
 **==============================================================================
 **
-** Local definitions
+** DRBG instances
+**
+**     Random data comes from a set of CTR_DRBG instances rather than from a
+**     single instance shared by all threads, whose mutex parks contending
+**     threads on the host. A thread takes an instance for the duration of a
+**     request, starting its search at a slot derived from oe_thread_self(),
+**     which does not change for a TCS. So each TCS normally finds the same
+**     instance free and threads do not contend. When every instance is taken,
+**     the thread falls back to a shared instance guarded by its mutex.
+**
+**     Instances are created and seeded on first use from an entropy context
+**     of their own, which polls mbedtls_hardware_poll() (RDRAND on SGX). The
+**     slot number is the personalization string, so no two instances start
+**     from the same state even if the entropy source repeated. An instance
+**     reseeds from its entropy context every MBEDTLS_CTR_DRBG_RESEED_INTERVAL
+**     (10000) requests; prediction resistance is off, as before.
+**
+**     Fork safety: the instances live in enclave memory, which a forked host
+**     process cannot use, so the state of an instance is never duplicated.
+**
+**     Requests of at most OE_RANDOM_HARDWARE_MAX_SIZE bytes are served from
+**     mbedtls_hardware_poll() directly, without taking an instance.
 **
 **==============================================================================
 */
 
-static mbedtls_ctr_drbg_context _drbg;
-static mbedtls_entropy_context _entropy;
+#define OE_RANDOM_MAX_DRBGS 64
+
+#define OE_RANDOM_HARDWARE_MAX_SIZE 32
+
+/* The slot of the shared instance */
+#define OE_RANDOM_SHARED_SLOT ((uint32_t)-1)
+
+typedef struct _oe_drbg
+{
+    /* First member so that oe_mbedtls_release_drbg() can cast back */
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_entropy_context entropy;
+    uint32_t slot;
+} oe_drbg_t;
+
+static oe_drbg_t* _drbgs[OE_RANDOM_MAX_DRBGS];
+static volatile uint32_t _drbgs_in_use[OE_RANDOM_MAX_DRBGS];
+
+static oe_drbg_t _shared_drbg;
 
-static oe_result_t _seed_entropy_source()
+static oe_result_t _seed_drbg(oe_drbg_t* drbg, uint32_t slot)
 {
     oe_result_t result = OE_UNEXPECTED;
+    int rc;
 
-    mbedtls_ctr_drbg_init(&_drbg);
-    mbedtls_entropy_init(&_entropy);
+    mbedtls_ctr_drbg_init(&drbg->ctr_drbg);
+    mbedtls_entropy_init(&drbg->entropy);
+    drbg->slot = slot;
 
-    OE_CHECK((oe_result_t)mbedtls_ctr_drbg_seed(
-        &_drbg, mbedtls_entropy_func, &_entropy, NULL, 0));
+    rc = mbedtls_ctr_drbg_seed(
+        &drbg->ctr_drbg,
+        mbedtls_entropy_func,
+        &drbg->entropy,
+        (const unsigned char*)&slot,
+        sizeof(slot));
+    if (rc != 0)
+        OE_RAISE_MSG(OE_FAILURE, "rc = 0x%x\n", rc);
 
     result = OE_OK;
 
@@ -39,15 +88,72 @@ static oe_result_t _seed_result = OE_UNEXPECTED;
 static oe_once_t _seed_once = OE_ONCE_INIT;
 
 /* Wrapper to set file-scope _seed_result */
-static void _seed_entropy_source_once()
+static void _seed_shared_drbg_once()
 {
-    _seed_result = _seed_entropy_source();
+    _seed_result = _seed_drbg(&_shared_drbg, OE_RANDOM_SHARED_SLOT);
 }
 
-mbedtls_ctr_drbg_context* oe_mbedtls_get_drbg()
+static mbedtls_ctr_drbg_context* _get_shared_drbg(void)
 {
-    oe_once(&_seed_once, _seed_entropy_source_once);
-    return &_drbg;
+    oe_once(&_seed_once, _seed_shared_drbg_once);
+    return _seed_result == OE_OK ? &_shared_drbg.ctr_drbg : NULL;
+}
+
+static uint32_t _get_first_slot(void)
+{
+    /* Thread identifiers are page aligned, so mix the page number */
+    uint64_t x = ((uint64_t)oe_thread_self() >> 12) * 0x9E3779B97F4A7C15ULL;
+
+    return (uint32_t)(x >> 32) % OE_RANDOM_MAX_DRBGS;
+}
+
+mbedtls_ctr_drbg_context* oe_mbedtls_acquire_drbg()
+{
+    uint32_t first = _get_first_slot();
+
+    for (uint32_t i = 0; i < OE_RANDOM_MAX_DRBGS; i++)
+    {
+        uint32_t slot = (first + i) % OE_RANDOM_MAX_DRBGS;
+
+        if (!oe_atomic_compare_and_swap_u32(&_drbgs_in_use[slot], 0, 1))
+            continue;
+
+        /* Create and seed the instance of this slot on first use */
+        if (!_drbgs[slot])
+        {
+            oe_drbg_t* drbg;
+
+            if (!(drbg = (oe_drbg_t*)oe_malloc(sizeof(oe_drbg_t))))
+            {
+                oe_atomic_exchange_u32(&_drbgs_in_use[slot], 0);
+                break;
+            }
+
+            if (_seed_drbg(drbg, slot) != OE_OK)
+            {
+                mbedtls_ctr_drbg_free(&drbg->ctr_drbg);
+                mbedtls_entropy_free(&drbg->entropy);
+                oe_free(drbg);
+                oe_atomic_exchange_u32(&_drbgs_in_use[slot], 0);
+                break;
+            }
+
+            _drbgs[slot] = drbg;
+        }
+
+        return &_drbgs[slot]->ctr_drbg;
+    }
+
+    /* Every instance is in use or could not be created */
+    return _get_shared_drbg();
+}
+
+void oe_mbedtls_release_drbg(mbedtls_ctr_drbg_context* ctr_drbg)
+{
+    oe_drbg_t* drbg = (oe_drbg_t*)ctr_drbg;
+
+    if (drbg && drbg->slot < OE_RANDOM_MAX_DRBGS)
+        oe_atomic_exchange_u32(&_drbgs_in_use[drbg->slot], 0);
 }
 
 /*
@@ -69,21 +175,39 @@ oe_result_t oe_random(void* data, size_t size)
 oe_result_t oe_random_internal(void* data, size_t size)
 {
     oe_result_t result = OE_UNEXPECTED;
+    mbedtls_ctr_drbg_context* drbg = NULL;
     int rc;
 
-    /* Seed the entropy source on the first call */
+    if (!data && size)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Serve small requests, such as nonces, from the hardware directly */
+    if (size <= OE_RANDOM_HARDWARE_MAX_SIZE)
     {
-        oe_once(&_seed_once, _seed_entropy_source_once);
-        OE_CHECK(_seed_result);
+        size_t olen = 0;
+
+        if (mbedtls_hardware_poll(NULL, data, size, &olen) == 0 &&
+            olen == size)
+        {
+            result = OE_OK;
+            goto done;
+        }
     }
 
-    /* Generate random data (synchronize access to _drbg instance) */
-    rc = mbedtls_ctr_drbg_random(&_drbg, data, size);
+    if (!(drbg = oe_mbedtls_acquire_drbg()))
+        OE_RAISE(OE_FAILURE);
+
+    /* Generate random data (synchronized with other users of the shared
+     * instance, uncontended otherwise) */
+    rc = mbedtls_ctr_drbg_random(drbg, data, size);
     if (rc != 0)
         OE_RAISE_MSG(OE_FAILURE, "rc = 0x%x\n", rc);
 
     result = OE_OK;
 done:
 
+    if (drbg)
+        oe_mbedtls_release_drbg(drbg);
+
     return result;
 }
@@ -11,6 +11,9 @@
 #include "mbedtls_corelibc_undef.h"
 // clang-format on
 
-mbedtls_ctr_drbg_context* oe_mbedtls_get_drbg();
+/* Take a DRBG instance for the calling thread; release it when done */
+mbedtls_ctr_drbg_context* oe_mbedtls_acquire_drbg();
+
+void oe_mbedtls_release_drbg(mbedtls_ctr_drbg_context* ctr_drbg);
 
 #endif /* _CRYPTO_ENCLAVE_RANDOM_H */
@@ -158,7 +158,7 @@ static oe_result_t _generate_key_pair(
         OE_RAISE(OE_INVALID_PARAMETER);
 
     /* Get the random number generator */
-    if (!(drbg = oe_mbedtls_get_drbg()))
+    if (!(drbg = oe_mbedtls_acquire_drbg()))
         OE_RAISE(OE_FAILURE);
 
     /* Create key struct */
@@ -187,6 +187,9 @@ static oe_result_t _generate_key_pair(
 
 done:
 
+    if (drbg)
+        oe_mbedtls_release_drbg(drbg);
+
     mbedtls_pk_free(&pk);
 
     if (result != OE_OK)
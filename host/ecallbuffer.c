@@ -0,0 +1,89 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/edger8r/host.h>
+#include <openenclave/internal/defs.h>
+#include <stdlib.h>
+#include "hostthread.h"
+
+/*
+**==============================================================================
+**
+** ECALL marshaling buffers
+**
+**     The ECALL wrappers generated by oeedger8r serialize their parameters
+**     into a buffer obtained from oe_allocate_ecall_buffer(). Each thread
+**     keeps the buffer of its last ECALL and reuses it for the next one,
+**     growing it to the largest size requested so far, so that ECALLs do not
+**     allocate on the host. The buffer is freed when the thread exits.
+**
+**     An ECALL made while the buffer of the thread is in use, i.e. from an
+**     OCALL of an ECALL of the same thread, gets a buffer of its own.
+**
+**==============================================================================
+*/
+
+typedef struct _ecall_buffer
+{
+    uint64_t capacity;
+    uint64_t in_use;
+} ecall_buffer_t;
+
+/* The data follows the header, aligned like the memory from malloc() */
+OE_CHECK_SIZE(sizeof(ecall_buffer_t), 16);
+#define _DATA(BUFFER) ((uint8_t*)((BUFFER) + 1))
+
+static oe_once_type _ecall_buffer_once = OE_H_ONCE_INITIALIZER;
+static oe_thread_key _ecall_buffer_key;
+
+static void _create_ecall_buffer_key(void)
+{
+    oe_thread_key_create(&_ecall_buffer_key, free);
+}
+
+static ecall_buffer_t* _get_ecall_buffer(void)
+{
+    oe_once(&_ecall_buffer_once, _create_ecall_buffer_key);
+    return (ecall_buffer_t*)oe_thread_getspecific(_ecall_buffer_key);
+}
+
+void* oe_allocate_ecall_buffer(size_t size)
+{
+    ecall_buffer_t* buffer = _get_ecall_buffer();
+
+    if (buffer && buffer->in_use)
+        return malloc(size);
+
+    if (!buffer || buffer->capacity < size)
+    {
+        if (size > SIZE_MAX - sizeof(ecall_buffer_t))
+            return NULL;
+
+        oe_thread_setspecific(_ecall_buffer_key, NULL);
+        free(buffer);
+
+        if (!(buffer = (ecall_buffer_t*)malloc(sizeof(*buffer) + size)))
+            return NULL;
+
+        buffer->capacity = size;
+
+        if (oe_thread_setspecific(_ecall_buffer_key, buffer) != 0)
+        {
+            free(buffer);
+            return malloc(size);
+        }
+    }
+
+    buffer->in_use = 1;
+    return _DATA(buffer);
+}
+
+void oe_free_ecall_buffer(void* ptr)
+{
+    ecall_buffer_t* buffer = _get_ecall_buffer();
+
+    if (buffer && ptr == _DATA(buffer))
+        buffer->in_use = 0;
+    else
+        free(ptr);
+}
@@ -59,6 +59,33 @@ typedef DWORD oe_thread_key;
  */
 oe_thread oe_thread_self(void);
 
+/**
+ * Creates a new thread.
+ *
+ * This function creates a new thread that runs **func** with the given
+ * **arg**. The thread must be joined with oe_thread_join() to release its
+ * resources.
+ *
+ * @param thread Set to the identifier of the new thread on success.
+ * @param func The function that the new thread runs.
+ * @param arg The argument passed to **func**.
+ *
+ * @returns Returns zero on success.
+ */
+int oe_thread_create(oe_thread* thread, void* (*func)(void*), void* arg);
+
+/**
+ * Waits for a thread to exit.
+ *
+ * This function blocks until the thread created with oe_thread_create() has
+ * returned from its thread function.
+ *
+ * @param thread The identifier of the thread to wait for.
+ *
+ * @returns Returns zero on success.
+ */
+int oe_thread_join(oe_thread thread);
+
 /**
  * Checks two thread identifiers for equality.
  *
@@ -171,10 +198,12 @@ int oe_mutex_destroy(oe_mutex* mutex);
  * a key for accessing it.
  *
  * @param key Set this key to refer to the newly allocated TSD entry.
+ * @param destructor If not NULL, called with the value of the entry when a
+ * thread whose value is not NULL exits.
  *
  * @return Returns zero on success.
  */
-int oe_thread_key_create(oe_thread_key* key);
+int oe_thread_key_create(oe_thread_key* key, void (*destructor)(void* value));
 
 /**
  * Delete a key for accessing thread-specific data.
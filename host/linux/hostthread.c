@@ -24,6 +24,16 @@ int oe_thread_equal(oe_thread thread1, oe_thread thread2)
     return pthread_equal(thread1, thread2);
 }
 
+int oe_thread_create(oe_thread* thread, void* (*func)(void*), void* arg)
+{
+    return pthread_create(thread, NULL, func, arg);
+}
+
+int oe_thread_join(oe_thread thread)
+{
+    return pthread_join(thread, NULL);
+}
+
 /*
 **==============================================================================
 **
@@ -82,9 +92,9 @@ int oe_mutex_destroy(oe_mutex* Lock)
 **==============================================================================
 */
 
-int oe_thread_key_create(oe_thread_key* key)
+int oe_thread_key_create(oe_thread_key* key, void (*destructor)(void* value))
 {
-    return pthread_key_create(key, NULL);
+    return pthread_key_create(key, destructor);
 }
 
 int oe_thread_key_delete(oe_thread_key key)
@@ -2,23 +2,30 @@
 // Licensed under the MIT License.
 
 #include <errno.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/time.h>
 #include <time.h>
 #include "../ocalls.h"
 
 static const uint64_t _SEC_TO_MSEC = 1000UL;
+static const uint64_t _SEC_TO_NSEC = 1000000000UL;
 static const uint64_t _MSEC_TO_NSEC = 1000000UL;
 
-/* Return milliseconds elapsed since the Epoch. */
-static uint64_t _time()
+/* Return nanoseconds elapsed since the starting point of the given clock. */
+static uint64_t _time_ns(clockid_t clock_id)
 {
     struct timespec ts;
 
-    if (clock_gettime(CLOCK_REALTIME, &ts) != 0)
+    if (clock_gettime(clock_id, &ts) != 0)
         return 0;
 
-    return ((uint64_t)ts.tv_sec * _SEC_TO_MSEC) +
-           ((uint64_t)ts.tv_nsec / _MSEC_TO_NSEC);
+    return ((uint64_t)ts.tv_sec * _SEC_TO_NSEC) + (uint64_t)ts.tv_nsec;
+}
+
+/* Return milliseconds elapsed since the Epoch. */
+static uint64_t _time()
+{
+    return _time_ns(CLOCK_REALTIME) / _MSEC_TO_NSEC;
 }
 
 static void _sleep(uint64_t milliseconds)
@@ -42,6 +49,26 @@ void oe_handle_sleep(uint64_t arg_in)
     _sleep(milliseconds);
 }
 
+int oe_sleep(uint64_t milliseconds)
+{
+    _sleep(milliseconds);
+    return 0;
+}
+
+uint64_t oe_get_time(void)
+{
+    return _time();
+}
+
+void oe_update_shared_clock(oe_shared_clock_t* clock)
+{
+    /* Make the sequence odd while the times are inconsistent */
+    oe_atomic_increment(&clock->sequence);
+    clock->realtime_ns = _time_ns(CLOCK_REALTIME);
+    clock->monotonic_ns = _time_ns(CLOCK_MONOTONIC);
+    oe_atomic_increment(&clock->sequence);
+}
+
 void oe_handle_get_time(uint64_t arg_in, uint64_t* arg_out)
 {
     OE_UNUSED(arg_in);
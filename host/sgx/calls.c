@@ -21,6 +21,7 @@
 #include <openenclave/bits/safecrt.h>
 #include <openenclave/bits/safemath.h>
 #include <openenclave/host.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/registers.h>
@@ -49,22 +50,18 @@
 #define USE_TLS_FOR_THREADING_BINDING
 
 #if defined(USE_TLS_FOR_THREADING_BINDING)
-static oe_once_type _thread_binding_once;
-static oe_thread_key _thread_binding_key;
+/* A plain thread-local variable, which takes no call to read or write */
+#if defined(_WIN32)
+static __declspec(thread) ThreadBinding* _thread_binding;
+#else
+static __thread ThreadBinding* _thread_binding;
 #endif
-
-#if defined(USE_TLS_FOR_THREADING_BINDING)
-static void _create_thread_binding_key(void)
-{
-    oe_thread_key_create(&_thread_binding_key);
-}
 #endif
 
 static void _set_thread_binding(ThreadBinding* binding)
 {
 #if defined(USE_TLS_FOR_THREADING_BINDING)
-    oe_once(&_thread_binding_once, _create_thread_binding_key);
-    oe_thread_setspecific(_thread_binding_key, binding);
+    _thread_binding = binding;
 #else
     return oe_set_gs_register_base(binding);
 #endif
@@ -83,8 +80,7 @@ static void _set_thread_binding(ThreadBinding* binding)
 ThreadBinding* GetThreadBinding()
 {
 #if defined(USE_TLS_FOR_THREADING_BINDING)
-    oe_once(&_thread_binding_once, _create_thread_binding_key);
-    return (ThreadBinding*)oe_thread_getspecific(_thread_binding_key);
+    return _thread_binding;
 #else
     return (ThreadBinding*)oe_get_gs_register_base();
 #endif
@@ -342,14 +338,16 @@ done:
 /*
 **==============================================================================
 **
-** _handle_call_host_function()
+** oe_dispatch_call_host_function()
 **
-** Handle calls from the enclave.
+** Call the host function of an OCALL without storing the result in the
+** arguments. The host workers that service switchless OCALLs store it
+** themselves, as the last access to the arguments.
 **
 **==============================================================================
 */
 
-static oe_result_t _handle_call_host_function(
+oe_result_t oe_dispatch_call_host_function(
     uint64_t arg,
     oe_enclave_t* enclave)
 {
@@ -397,14 +395,35 @@ static oe_result_t _handle_call_host_function(
         args_ptr->output_buffer_size,
         &args_ptr->output_bytes_written);
 
-    // The ocall succeeded.
-    args_ptr->result = OE_OK;
     result = OE_OK;
 done:
 
     return result;
 }
 
+/*
+**==============================================================================
+**
+** oe_handle_call_host_function()
+**
+** Handle calls from the enclave.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_handle_call_host_function(
+    uint64_t arg,
+    oe_enclave_t* enclave)
+{
+    oe_result_t result = oe_dispatch_call_host_function(arg, enclave);
+
+    // The ocall succeeded.
+    if (result == OE_OK)
+        ((oe_call_host_function_args_t*)arg)->result = OE_OK;
+
+    return result;
+}
+
 /*
 **==============================================================================
 **
@@ -441,7 +460,7 @@ static oe_result_t _handle_ocall(
             break;
 
         case OE_OCALL_CALL_HOST_FUNCTION:
-            _handle_call_host_function(arg_in, enclave);
+            oe_handle_call_host_function(arg_in, enclave);
             break;
 
         case OE_OCALL_MALLOC:
@@ -476,6 +495,10 @@ static oe_result_t _handle_ocall(
             HandleGetQuote(arg_in);
             break;
 
+        case OE_OCALL_GET_QUOTE_V2:
+            HandleGetQuoteV2(arg_in);
+            break;
+
 #ifdef OE_USE_LIBSGX
         // Quote revocation is supported only on libsgx platforms.
         case OE_OCALL_GET_REVOCATION_INFO:
@@ -506,6 +529,26 @@ static oe_result_t _handle_ocall(
             oe_handle_log(enclave, arg_in);
             break;
 
+        case OE_OCALL_DRAIN_LOG:
+            oe_drain_log_ring(enclave);
+            break;
+
+        case OE_OCALL_WAKE_HOST_WORKER:
+            oe_handle_wake_host_worker(enclave, arg_in);
+            break;
+
+        case OE_OCALL_WAIT_ENCLAVE_WORKER:
+            oe_handle_wait_enclave_worker(enclave, arg_in);
+            break;
+
+        case OE_OCALL_START_SHARED_CLOCK:
+            oe_handle_start_shared_clock(enclave, arg_out);
+            break;
+
+        case OE_OCALL_GROW_OCALL_ARENA:
+            oe_handle_grow_ocall_arena(enclave, tcs, arg_in, arg_out);
+            break;
+
         default:
         {
             /* No function found with the number */
@@ -572,14 +615,7 @@ int __oe_dispatch_ocall(
              * is what we are trying to do. So loop through the bindings
              * to figure out the correct one for the given tcs.
              */
-            for (size_t i = 0; i < OE_COUNTOF(enclave->bindings); ++i)
-            {
-                if (enclave->bindings[i].tcs == (uint64_t)tcs)
-                {
-                    binding = &enclave->bindings[i];
-                    break;
-                }
-            }
+            binding = oe_find_thread_binding(enclave, (uint64_t)tcs);
 
             /**
              * Restore FS and GS registers when making an OCALL.
@@ -615,6 +651,63 @@ int __oe_dispatch_ocall(
     return 1;
 }
 
+/*
+**==============================================================================
+**
+** _claim_free_binding()
+** _free_binding()
+**
+**     Lock-free allocation of thread bindings from enclave->free_bindings.
+**
+**==============================================================================
+*/
+
+static size_t _lowest_set_bit(uint64_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return index;
+#else
+    return (size_t)__builtin_ctzll(x);
+#endif
+}
+
+static ThreadBinding* _claim_free_binding(oe_enclave_t* enclave)
+{
+    size_t num_words = (enclave->num_bindings + 63) / 64;
+
+    for (size_t i = 0; i < num_words; i++)
+    {
+        volatile uint64_t* word = &enclave->free_bindings[i];
+        uint64_t value;
+
+        while ((value = *word) != 0)
+        {
+            size_t bit = _lowest_set_bit(value);
+
+            if (oe_atomic_compare_and_swap_u64(
+                    word, value, value & ~(1ULL << bit)))
+                return &enclave->bindings[i * 64 + bit];
+        }
+    }
+
+    return NULL;
+}
+
+static void _free_binding(oe_enclave_t* enclave, ThreadBinding* binding)
+{
+    size_t index = (size_t)(binding - enclave->bindings);
+    volatile uint64_t* word = &enclave->free_bindings[index / 64];
+    uint64_t value;
+
+    do
+    {
+        value = *word;
+    } while (!oe_atomic_compare_and_swap_u64(
+        word, value, value | (1ULL << (index % 64))));
+}
+
 /*
 **==============================================================================
 **
@@ -624,9 +717,16 @@ int __oe_dispatch_ocall(
 **         - the calling host thread
 **         - an enclave thread context
 **
-**     If such a binding already exists, the binding's count in incremented.
-**     Else, the calling host thread is bound to the first available enclave
-**     thread context.
+**     If such a binding already exists (found through the binding cached in
+**     thread-specific data), the binding's count in incremented. Else, the
+**     calling host thread is bound to the first available enclave thread
+**     context. Neither path takes the enclave lock.
+**
+**     A thread that is handling an OCALL of another enclave (A -> B -> A) has
+**     that enclave's binding cached, so the bindings of this enclave are
+**     searched for one the thread already owns before claiming a new one.
+**     A thread without a cached binding is not in any enclave call, so the
+**     search is skipped for the common, non-nested ECALL.
 **
 **     Returns the address of the thread control structure (TCS) corresponding
 **     to the enclave thread context.
@@ -636,50 +736,49 @@ int __oe_dispatch_ocall(
 
 static void* _assign_tcs(oe_enclave_t* enclave)
 {
-    void* tcs = NULL;
-    size_t i;
     oe_thread thread = oe_thread_self();
+    ThreadBinding* binding = GetThreadBinding();
 
-    oe_mutex_lock(&enclave->lock);
+    /* Fast path: this thread is already bound to a TCS of this enclave, which
+     * happens for nested calls made while handling an OCALL */
+    if (binding && binding >= enclave->bindings &&
+        binding < enclave->bindings + enclave->num_bindings &&
+        (binding->flags & _OE_THREAD_BUSY) && binding->thread == thread)
     {
-        /* First attempt to find a busy td_t owned by this thread */
-        for (i = 0; i < enclave->num_bindings; i++)
+        binding->count++;
+        return (void*)binding->tcs;
+    }
+
+    if (binding)
+    {
+        for (size_t i = 0; i < enclave->num_bindings; i++)
         {
-            ThreadBinding* binding = &enclave->bindings[i];
+            ThreadBinding* owned = &enclave->bindings[i];
 
-            if ((binding->flags & _OE_THREAD_BUSY) && binding->thread == thread)
+            if ((owned->flags & _OE_THREAD_BUSY) && owned->thread == thread)
             {
-                binding->count++;
-                tcs = (void*)binding->tcs;
-                break;
-            }
-        }
+                owned->count++;
 
-        /* If binding not found above, look for an available ThreadBinding */
-        if (!tcs)
-        {
-            for (i = 0; i < enclave->num_bindings; i++)
-            {
-                ThreadBinding* binding = &enclave->bindings[i];
-
-                if (!(binding->flags & _OE_THREAD_BUSY))
-                {
-                    binding->flags |= _OE_THREAD_BUSY;
-                    binding->thread = thread;
-                    binding->count = 1;
-                    tcs = (void*)binding->tcs;
-
-                    /* Set into TSD so asynchronous exceptions can get it */
-                    _set_thread_binding(binding);
-                    assert(GetThreadBinding() == binding);
-                    break;
-                }
+                /* The OCALL handler of the other enclave restores its own
+                 * binding when this call returns */
+                _set_thread_binding(owned);
+                return (void*)owned->tcs;
             }
         }
     }
-    oe_mutex_unlock(&enclave->lock);
 
-    return tcs;
+    if (!(binding = _claim_free_binding(enclave)))
+        return NULL;
+
+    binding->thread = thread;
+    binding->count = 1;
+    binding->flags |= _OE_THREAD_BUSY;
+
+    /* Set into TSD so asynchronous exceptions can get it */
+    _set_thread_binding(binding);
+    assert(GetThreadBinding() == binding);
+
+    return (void*)binding->tcs;
 }
 
 /*
@@ -695,32 +794,22 @@ static void* _assign_tcs(oe_enclave_t* enclave)
 
 static void _release_tcs(oe_enclave_t* enclave, void* tcs)
 {
-    size_t i;
+    ThreadBinding* binding = oe_find_thread_binding(enclave, (uint64_t)tcs);
 
-    oe_mutex_lock(&enclave->lock);
-    {
-        for (i = 0; i < enclave->num_bindings; i++)
-        {
-            ThreadBinding* binding = &enclave->bindings[i];
+    if (!binding || !(binding->flags & _OE_THREAD_BUSY))
+        return;
 
-            if ((binding->flags & _OE_THREAD_BUSY) &&
-                (void*)binding->tcs == tcs)
-            {
-                binding->count--;
-
-                if (binding->count == 0)
-                {
-                    binding->flags &= (~_OE_THREAD_BUSY);
-                    binding->thread = 0;
-                    memset(&binding->event, 0, sizeof(binding->event));
-                    _set_thread_binding(NULL);
-                    assert(GetThreadBinding() == NULL);
-                }
-                break;
-            }
-        }
+    if (--binding->count == 0)
+    {
+        binding->flags &= (~_OE_THREAD_BUSY);
+        binding->thread = 0;
+        memset(&binding->event, 0, sizeof(binding->event));
+        _set_thread_binding(NULL);
+        assert(GetThreadBinding() == NULL);
+
+        /* Publish the binding only once it has been reset */
+        _free_binding(enclave, binding);
     }
-    oe_mutex_unlock(&enclave->lock);
 }
 
 /*
@@ -887,23 +976,25 @@ done:
 /*
 **==============================================================================
 **
-** oe_call_enclave_function()
+** _call_enclave_function()
 **
-** Call the enclave function specified by the given function-id.
+** Call the enclave function specified by the given function-id, either with a
+** regular ECALL or, if switchless is true, by posting it to an enclave worker.
 ** Note: Currently only SGX style marshaling is supported. input_buffer contains
 ** the marshaling args structure.
 **
 **==============================================================================
 */
 
-oe_result_t oe_call_enclave_function(
+static oe_result_t _call_enclave_function(
     oe_enclave_t* enclave,
     uint32_t function_id,
     const void* input_buffer,
     size_t input_buffer_size,
     void* output_buffer,
     size_t output_buffer_size,
-    size_t* output_bytes_written)
+    size_t* output_bytes_written,
+    bool switchless)
 {
     oe_result_t result = OE_UNEXPECTED;
     oe_call_enclave_function_args_t args;
@@ -923,10 +1014,14 @@ oe_result_t oe_call_enclave_function(
         args.result = OE_UNEXPECTED;
     }
 
-    /* Perform the ECALL */
+    /* Fall back to a regular ECALL if no enclave worker is available */
+    if (!switchless || oe_post_switchless_ecall(enclave, &args) ==
+                           OE_CONTEXT_SWITCHLESS_ECALL_MISSED)
     {
         uint64_t arg_out = 0;
 
+        args.result = OE_UNEXPECTED;
+
         OE_CHECK(oe_ecall(
             enclave,
             OE_ECALL_CALL_ENCLAVE_FUNCTION,
@@ -945,6 +1040,138 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** oe_call_enclave_function()
+**
+** Call the enclave function specified by the given function-id.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_enclave_function(
+    oe_enclave_t* enclave,
+    uint32_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    size_t* output_bytes_written)
+{
+    return _call_enclave_function(
+        enclave,
+        function_id,
+        input_buffer,
+        input_buffer_size,
+        output_buffer,
+        output_buffer_size,
+        output_bytes_written,
+        false);
+}
+
+/*
+**==============================================================================
+**
+** oe_switchless_call_enclave_function()
+**
+** Call the enclave function specified by the given function-id without
+** entering the enclave, falling back to a regular ECALL when no enclave worker
+** is available.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_switchless_call_enclave_function(
+    oe_enclave_t* enclave,
+    uint32_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    size_t* output_bytes_written)
+{
+    return _call_enclave_function(
+        enclave,
+        function_id,
+        input_buffer,
+        input_buffer_size,
+        output_buffer,
+        output_buffer_size,
+        output_bytes_written,
+        true);
+}
+
+/*
+**==============================================================================
+**
+** oe_call_enclave_function_batch()
+**
+** Call the enclave functions of a batch in one ECALL. The enclave reads the
+** calls from the array of the caller and stores the result of each call in
+** it, so oe_enclave_function_call_t must have the layout of
+** oe_call_enclave_function_args_t.
+**
+**==============================================================================
+*/
+
+OE_STATIC_ASSERT(
+    sizeof(oe_enclave_function_call_t) ==
+    sizeof(oe_call_enclave_function_args_t));
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_enclave_function_call_t, input_buffer) ==
+    OE_OFFSETOF(oe_call_enclave_function_args_t, input_buffer));
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_enclave_function_call_t, output_buffer) ==
+    OE_OFFSETOF(oe_call_enclave_function_args_t, output_buffer));
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_enclave_function_call_t, output_bytes_written) ==
+    OE_OFFSETOF(oe_call_enclave_function_args_t, output_bytes_written));
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_enclave_function_call_t, result) ==
+    OE_OFFSETOF(oe_call_enclave_function_args_t, result));
+
+oe_result_t oe_call_enclave_function_batch(
+    oe_enclave_t* enclave,
+    oe_enclave_function_call_t* calls,
+    size_t num_calls)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_enclave_function_batch_args_t args;
+    uint64_t arg_out = 0;
+
+    /* Reject invalid parameters */
+    if (!enclave || (!calls && num_calls))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (num_calls == 0)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    for (size_t i = 0; i < num_calls; i++)
+    {
+        calls[i].output_bytes_written = 0;
+        calls[i].result = OE_UNEXPECTED;
+    }
+
+    args.calls = (oe_call_enclave_function_args_t*)calls;
+    args.num_calls = num_calls;
+
+    OE_CHECK(oe_ecall(
+        enclave,
+        OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH,
+        (uint64_t)&args,
+        &arg_out));
+    OE_CHECK((oe_result_t)arg_out);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 /*
 ** These two functions are needed to notify the debugger. They should not be
 ** optimized out even though they don't do anything in here.
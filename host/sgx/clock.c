@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/time.h>
+#include <stdlib.h>
+#include "enclave.h"
+
+/*
+**==============================================================================
+**
+** Shared clock
+**
+**     Each enclave gets a page of host memory that a host thread refreshes
+**     with the current time every OE_SHARED_CLOCK_UPDATE_INTERVAL
+**     milliseconds. The page is passed to the enclave with
+**     OE_ECALL_INIT_ENCLAVE, after which time queries in the enclave do not
+**     need an OCALL. The thread is only started when the enclave first reads
+**     the clock (OE_OCALL_START_SHARED_CLOCK), so enclaves that never ask for
+**     the time do not pay for its wakeups.
+**
+**==============================================================================
+*/
+
+static void* _shared_clock_thread(void* arg)
+{
+    oe_enclave_t* enclave = (oe_enclave_t*)arg;
+
+    while (!enclave->shared_clock_stopping)
+    {
+        oe_sleep(OE_SHARED_CLOCK_UPDATE_INTERVAL);
+        oe_update_shared_clock(enclave->shared_clock);
+    }
+
+    return NULL;
+}
+
+oe_result_t oe_start_shared_clock(oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_shared_clock_t* clock;
+
+    if (!enclave || enclave->shared_clock)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(clock = (oe_shared_clock_t*)calloc(1, OE_PAGE_SIZE)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Publish the time once so the page is valid before the first read */
+    oe_update_shared_clock(clock);
+
+    enclave->shared_clock = clock;
+    enclave->shared_clock_started = false;
+    enclave->shared_clock_stopping = 0;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+void oe_handle_start_shared_clock(oe_enclave_t* enclave, uint64_t* arg_out)
+{
+    int ret = -1;
+
+    oe_mutex_lock(&enclave->lock);
+
+    if (enclave->shared_clock && !enclave->shared_clock_started)
+    {
+        /* The page may be stale by now, so refresh it before the enclave
+         * reads it. Once started, only the thread writes to it. */
+        oe_update_shared_clock(enclave->shared_clock);
+
+        if (oe_thread_create(
+                &enclave->shared_clock_thread, _shared_clock_thread, enclave) ==
+            0)
+            enclave->shared_clock_started = true;
+    }
+
+    if (enclave->shared_clock_started)
+        ret = 0;
+
+    oe_mutex_unlock(&enclave->lock);
+
+    if (arg_out)
+        *arg_out = (uint64_t)ret;
+}
+
+void oe_stop_shared_clock(oe_enclave_t* enclave)
+{
+    if (!enclave || !enclave->shared_clock)
+        return;
+
+    if (enclave->shared_clock_started)
+    {
+        enclave->shared_clock_stopping = 1;
+        oe_thread_join(enclave->shared_clock_thread);
+        enclave->shared_clock_started = false;
+    }
+
+    free(enclave->shared_clock);
+    enclave->shared_clock = NULL;
+}
@@ -51,7 +51,9 @@ static char* get_fullpath(const char* path)
 #include "cpuid.h"
 #include "enclave.h"
 #include "exception.h"
+#include "imagecache.h"
 #include "sgxload.h"
+#include "sgxmeasure.h"
 
 static oe_once_type _enclave_init_once;
 
@@ -81,36 +83,21 @@ static oe_result_t _add_filled_pages(
     uint32_t filler,
     bool extend)
 {
-    oe_page_t page;
     oe_result_t result = OE_UNEXPECTED;
-    size_t i;
 
     /* Reject invalid parameters */
     if (!context || !enclave_addr || !vaddr)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    /* Fill or clear the page */
-    if (filler)
-    {
-        size_t n = OE_PAGE_SIZE / sizeof(uint32_t);
-        uint32_t* p = (uint32_t*)&page;
-
-        while (n--)
-            *p++ = filler;
-    }
-    else
-        memset(&page, 0, sizeof(page));
-
-    /* Add the pages */
-    for (i = 0; i < npages; i++)
+    /* Add the pages as a single run */
+    if (npages)
     {
         uint64_t addr = enclave_addr + *vaddr;
-        uint64_t src = (uint64_t)&page;
         uint64_t flags = SGX_SECINFO_REG | SGX_SECINFO_R | SGX_SECINFO_W;
 
-        OE_CHECK(oe_sgx_load_enclave_data(
-            context, enclave_addr, addr, src, flags, extend));
-        (*vaddr) += OE_PAGE_SIZE;
+        OE_CHECK(oe_sgx_load_enclave_filled_pages(
+            context, enclave_addr, addr, npages, filler, flags, extend));
+        (*vaddr) += npages * OE_PAGE_SIZE;
     }
 
     result = OE_OK;
@@ -127,7 +114,12 @@ static oe_result_t _add_stack_pages(
 {
     const bool extend = true;
     return _add_filled_pages(
-        context, enclave_addr, vaddr, npages, 0xcccccccc, extend);
+        context,
+        enclave_addr,
+        vaddr,
+        npages,
+        OE_SGX_STACK_PAGE_FILLER,
+        extend);
 }
 
 static oe_result_t _add_heap_pages(
@@ -164,11 +156,11 @@ static oe_result_t _add_control_pages(
      *     page6 - extra segment space for thread-specific data.
      */
 
-    /* Save the address of new TCS page into enclave object */
+    /* Save the address of new TCS page into enclave object. The bindings
+     * array is sized for the enclave's TCS count by _oe_add_data_pages() */
     {
-        if (enclave->num_bindings == OE_SGX_MAX_TCS)
-            OE_RAISE_MSG(
-                OE_FAILURE, "OE_SGX_MAX_TCS (%d) hit\n", OE_SGX_MAX_TCS);
+        if (!enclave->bindings)
+            OE_RAISE(OE_UNEXPECTED);
 
         enclave->bindings[enclave->num_bindings++].tcs = enclave_addr + *vaddr;
     }
@@ -303,20 +295,14 @@ static oe_result_t _add_ecall_pages(
         OE_RAISE(OE_INVALID_PARAMETER);
 
     {
-        const oe_page_t* pages = (const oe_page_t*)ecall_data;
-        size_t npages = ecall_size / sizeof(oe_page_t);
-
-        for (size_t i = 0; i < npages; i++)
-        {
-            uint64_t addr = enclave_addr + *vaddr;
-            uint64_t src = (uint64_t)&pages[i];
-            uint64_t flags = SGX_SECINFO_REG | SGX_SECINFO_R;
-            bool extend = true;
+        uint64_t addr = enclave_addr + *vaddr;
+        uint64_t src = (uint64_t)ecall_data;
+        uint64_t flags = SGX_SECINFO_REG | SGX_SECINFO_R;
+        bool extend = true;
 
-            OE_CHECK(oe_sgx_load_enclave_data(
-                context, enclave_addr, addr, src, flags, extend));
-            (*vaddr) += sizeof(oe_page_t);
-        }
+        OE_CHECK(oe_sgx_load_enclave_data_pages(
+            context, enclave_addr, addr, src, ecall_size, flags, extend));
+        (*vaddr) += ecall_size;
     }
 
     result = OE_OK;
@@ -401,6 +387,9 @@ static oe_result_t _oe_add_data_pages(
     OE_CHECK(_add_heap_pages(
         context, enclave->addr, vaddr, size_settings->num_heap_pages));
 
+    /* Allocate one thread binding per TCS */
+    OE_CHECK(oe_allocate_thread_bindings(enclave, size_settings->num_tcs));
+
     for (i = 0; i < size_settings->num_tcs; i++)
     {
         /* Add guard page */
@@ -424,6 +413,58 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** _parse_enclave_settings()
+**
+**     Validate the settings passed to oe_create_enclave() and extract the
+**     number of host and enclave workers for switchless calls.
+**
+**==============================================================================
+*/
+
+static oe_result_t _parse_enclave_settings(
+    const oe_enclave_setting_t* settings,
+    uint32_t num_settings,
+    size_t* num_host_workers,
+    size_t* num_enclave_workers)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    *num_host_workers = 0;
+    *num_enclave_workers = 0;
+
+    if (!settings && num_settings > 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (uint32_t i = 0; i < num_settings; i++)
+    {
+        switch (settings[i].setting_type)
+        {
+            case OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS:
+            {
+                const oe_enclave_setting_context_switchless_t* setting =
+                    settings[i].u.context_switchless_setting;
+
+                if (!setting)
+                    OE_RAISE(OE_INVALID_PARAMETER);
+
+                *num_host_workers = setting->max_host_workers;
+                *num_enclave_workers = setting->max_enclave_workers;
+                break;
+            }
+            default:
+                OE_RAISE(OE_INVALID_PARAMETER);
+        }
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 /*
 **==============================================================================
 **
@@ -435,6 +476,22 @@ done:
 **==============================================================================
 */
 
+/* Release the OCALL arenas of every TCS, including any grown ones */
+static void _free_ocall_arenas(oe_enclave_t* enclave)
+{
+    if (enclave->grown_ocall_arenas)
+    {
+        for (size_t i = 0; i < enclave->num_bindings; i++)
+            free(enclave->grown_ocall_arenas[i]);
+
+        free(enclave->grown_ocall_arenas);
+        enclave->grown_ocall_arenas = NULL;
+    }
+
+    free(enclave->ocall_arenas);
+    enclave->ocall_arenas = NULL;
+}
+
 static oe_result_t _initialize_enclave(oe_enclave_t* enclave)
 {
     oe_result_t result = OE_UNEXPECTED;
@@ -456,6 +513,24 @@ static oe_result_t _initialize_enclave(oe_enclave_t* enclave)
     // Pass the enclave handle to the enclave.
     args.enclave = enclave;
 
+    // Map an arena for OCALL buffers for each TCS so that the enclave does
+    // not need OCALLs to allocate them.
+    if (!(enclave->ocall_arenas =
+              calloc(enclave->num_bindings, OE_OCALL_ARENA_SIZE)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (!(enclave->grown_ocall_arenas =
+              calloc(enclave->num_bindings, sizeof(void*))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    args.ocall_arenas = enclave->ocall_arenas;
+    args.ocall_arena_size = OE_OCALL_ARENA_SIZE;
+    args.num_ocall_arenas = enclave->num_bindings;
+
+    // Pass the clock page so that the enclave can read the time without
+    // OCALLs.
+    args.shared_clock = enclave->shared_clock;
+
     {
         uint64_t arg_out = 0;
         OE_CHECK(oe_ecall(
@@ -560,71 +635,61 @@ done:
     return result;
 }
 
-oe_result_t oe_sgx_build_enclave(
-    oe_sgx_load_context_t* context,
+/*
+**==============================================================================
+**
+** _prepare_image()
+**
+**     Load the image file at path and derive from it everything that does
+**     not depend on where the enclave is created: the properties, the ECALL
+**     table (stored in enclave->ecalls) and pages, the layout of the enclave
+**     and the patched image. The results go to the fields of entry other
+**     than its key, so that they can be kept in the image cache.
+**
+**==============================================================================
+*/
+
+static oe_result_t _prepare_image(
     const char* path,
     const oe_sgx_enclave_properties_t* properties,
-    oe_enclave_t* enclave)
+    oe_enclave_t* enclave,
+    oe_image_cache_entry_t* entry)
 {
     oe_result_t result = OE_UNEXPECTED;
-    size_t enclave_end = 0;
-    size_t enclave_size = 0;
-    uint64_t enclave_addr = 0;
-    oe_enclave_image_t oeimage;
-    void* ecall_data = NULL;
-    size_t ecall_size;
-    size_t image_size;
-    uint64_t vaddr = 0;
-    oe_sgx_enclave_properties_t props;
-
-    memset(&oeimage, 0, sizeof(oeimage));
-
-    /* Clear and initialize enclave structure */
-    {
-        if (enclave)
-            memset(enclave, 0, sizeof(oe_enclave_t));
-
-        enclave->debug = oe_sgx_is_debug_load_context(context);
-        enclave->simulate = oe_sgx_is_simulation_load_context(context);
-    }
-
-    /* Initialize the lock */
-    if (oe_mutex_init(&enclave->lock))
-        OE_RAISE(OE_FAILURE);
-
-    /* Reject invalid parameters */
-    if (!context || !path || !enclave)
-        OE_RAISE(OE_INVALID_PARAMETER);
+    oe_enclave_image_t* oeimage = &entry->image;
+    oe_sgx_enclave_properties_t* props = &entry->props;
 
     /* Load the elf object */
-    if (oe_load_enclave_image(path, &oeimage) != OE_OK)
+    if (oe_load_enclave_image(path, oeimage) != OE_OK)
         OE_RAISE(OE_FAILURE);
 
     // If the **properties** parameter is non-null, use those properties.
     // Else use the properties stored in the .oeinfo section.
     if (properties)
     {
-        props = *properties;
+        *props = *properties;
 
         /* Update image to the properties passed in */
-        memcpy(oeimage.image_base + oeimage.oeinfo_rva, &props, sizeof(props));
+        memcpy(
+            oeimage->image_base + oeimage->oeinfo_rva, props, sizeof(*props));
     }
     else
     {
         /* Copy the properties from the image */
-        memcpy(&props, oeimage.image_base + oeimage.oeinfo_rva, sizeof(props));
+        memcpy(
+            props, oeimage->image_base + oeimage->oeinfo_rva, sizeof(*props));
     }
 
     /* Validate the enclave prop_override structure */
-    OE_CHECK(oe_sgx_validate_enclave_properties(&props, NULL));
+    OE_CHECK(oe_sgx_validate_enclave_properties(props, NULL));
 
     /* Consolidate enclave-debug-flag with create-debug-flag */
-    if (props.config.attributes & OE_SGX_FLAGS_DEBUG)
+    if (props->config.attributes & OE_SGX_FLAGS_DEBUG)
     {
         if (!enclave->debug)
         {
             /* Upgrade to non-debug mode */
-            props.config.attributes &= ~OE_SGX_FLAGS_DEBUG;
+            props->config.attributes &= ~OE_SGX_FLAGS_DEBUG;
         }
     }
     else
@@ -642,43 +707,119 @@ oe_result_t oe_sgx_build_enclave(
     }
 
     /* Calculate the size of image */
-    OE_CHECK(oeimage.calculate_size(&oeimage, &image_size));
+    OE_CHECK(oeimage->calculate_size(oeimage, &entry->image_size));
 
     /* Build an array of all the ECALL functions in the .ecalls section */
-    OE_CHECK(oeimage.build_ecall_array(&oeimage, enclave));
+    OE_CHECK(oeimage->build_ecall_array(oeimage, enclave));
+    entry->ecalls = enclave->ecalls;
+    entry->num_ecalls = enclave->num_ecalls;
 
     /* Build ECALL pages for enclave (list of addresses) */
-    OE_CHECK(_build_ecall_data(enclave, &ecall_data, &ecall_size));
+    OE_CHECK(
+        _build_ecall_data(enclave, &entry->ecall_data, &entry->ecall_size));
 
     /* Calculate the size of this enclave in memory */
     OE_CHECK(_calculate_enclave_size(
-        image_size, ecall_size, &props, &enclave_end, &enclave_size));
+        entry->image_size,
+        entry->ecall_size,
+        props,
+        &entry->enclave_end,
+        &entry->enclave_size));
+
+    /* Patch image */
+    OE_CHECK(oeimage->patch(oeimage, entry->ecall_size, entry->enclave_end));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_sgx_build_enclave(
+    oe_sgx_load_context_t* context,
+    const char* path,
+    const oe_sgx_enclave_properties_t* properties,
+    oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    uint64_t enclave_addr = 0;
+    uint64_t vaddr = 0;
+    oe_image_cache_key_t key;
+    oe_image_cache_entry_t prepared;
+    oe_image_cache_entry_t* entry = &prepared;
+
+    memset(&key, 0, sizeof(key));
+    memset(&prepared, 0, sizeof(prepared));
+
+    /* Clear and initialize enclave structure */
+    {
+        if (enclave)
+            memset(enclave, 0, sizeof(oe_enclave_t));
+
+        enclave->debug = oe_sgx_is_debug_load_context(context);
+        enclave->simulate = oe_sgx_is_simulation_load_context(context);
+    }
+
+    /* Initialize the lock */
+    if (oe_mutex_init(&enclave->lock))
+        OE_RAISE(OE_FAILURE);
+
+    /* Reject invalid parameters */
+    if (!context || !path || !enclave)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* Reuse what was derived from the image file for an earlier enclave if
+     * possible (oesign measures each image once and does not cache) */
+    if (context->type == OE_SGX_LOAD_TYPE_CREATE &&
+        oe_image_cache_make_key(
+            path, properties, context->attributes, &key) == OE_OK)
+    {
+        oe_image_cache_entry_t* cached;
+
+        if ((cached = oe_image_cache_acquire(&key)))
+        {
+            entry = cached;
+
+            /* Share the ECALL table of the entry */
+            enclave->ecalls = entry->ecalls;
+            enclave->num_ecalls = entry->num_ecalls;
+            enclave->image_cache_entry = entry;
+
+            /* Do not measure the pages again */
+            if (entry->has_mrenclave)
+                context->mrenclave = &entry->mrenclave;
+        }
+    }
+
+    if (entry == &prepared)
+        OE_CHECK(_prepare_image(path, properties, enclave, &prepared));
 
     /* Perform the ECREATE operation */
-    OE_CHECK(oe_sgx_create_enclave(context, enclave_size, &enclave_addr));
+    OE_CHECK(
+        oe_sgx_create_enclave(context, entry->enclave_size, &enclave_addr));
 
     /* Save the enclave base address, size, and text address */
     enclave->addr = enclave_addr;
-    enclave->size = enclave_size;
-    enclave->text = enclave_addr + oeimage.text_rva;
-
-    /* Patch image */
-    OE_CHECK(oeimage.patch(&oeimage, ecall_size, enclave_end));
+    enclave->size = entry->enclave_size;
+    enclave->text = enclave_addr + entry->image.text_rva;
 
     /* Add image to enclave */
-    OE_CHECK(oeimage.add_pages(&oeimage, context, enclave, &vaddr));
+    OE_CHECK(entry->image.add_pages(&entry->image, context, enclave, &vaddr));
 
     /* Add ecall pages */
     OE_CHECK(_add_ecall_pages(
-        context, enclave->addr, ecall_data, ecall_size, &vaddr));
+        context, enclave->addr, entry->ecall_data, entry->ecall_size, &vaddr));
 
     /* Add data pages */
     OE_CHECK(_oe_add_data_pages(
-        context, enclave, &props, oeimage.entry_rva, &vaddr));
+        context, enclave, &entry->props, entry->image.entry_rva, &vaddr));
+
+    /* All thread bindings start out free */
+    oe_initialize_free_bindings(enclave);
 
     /* Ask the platform to initialize the enclave and finalize the hash */
     OE_CHECK(oe_sgx_initialize_enclave(
-        context, enclave_addr, &props, &enclave->hash));
+        context, enclave_addr, &entry->props, &enclave->hash));
 
     /* Save full path of this enclave. When a debugger attaches to the host
      * process, it needs the fullpath so that it can load the image binary and
@@ -686,6 +827,29 @@ oe_result_t oe_sgx_build_enclave(
     if (!(enclave->path = get_fullpath(path)))
         OE_RAISE(OE_OUT_OF_MEMORY);
 
+    /* Cache what was derived from the image file for later enclaves */
+    if (entry == &prepared && key.path)
+    {
+        oe_image_cache_entry_t* cached;
+
+        prepared.key = key;
+
+        /* In simulation mode, the pages are measured in software */
+        if (enclave->simulate)
+        {
+            prepared.has_mrenclave = true;
+            prepared.mrenclave = enclave->hash;
+        }
+
+        if ((cached = oe_image_cache_insert(&prepared)))
+        {
+            /* The entry owns the image, the ECALL table and the key now */
+            entry = cached;
+            enclave->image_cache_entry = entry;
+            memset(&key, 0, sizeof(key));
+        }
+    }
+
     /* Set the magic number only if we have actually created an enclave */
     if (context->type == OE_SGX_LOAD_TYPE_CREATE)
         enclave->magic = ENCLAVE_MAGIC;
@@ -694,17 +858,30 @@ oe_result_t oe_sgx_build_enclave(
 
 done:
 
-    if (ecall_data)
-        free(ecall_data);
+    if (entry == &prepared)
+    {
+        free(prepared.ecall_data);
+        oe_unload_enclave_image(&prepared.image);
+    }
 
-    oe_unload_enclave_image(&oeimage);
+    oe_image_cache_free_key(&key);
+
+    /* The context may outlive the entry */
+    if (context)
+        context->mrenclave = NULL;
 
     return result;
 }
 
 void oe_free_enclave_ecalls(oe_enclave_t* enclave)
 {
-    if (enclave->ecalls)
+    /* The ECALL table of a cached image belongs to the cache */
+    if (enclave->image_cache_entry)
+    {
+        oe_image_cache_release(enclave->image_cache_entry);
+        enclave->image_cache_entry = NULL;
+    }
+    else if (enclave->ecalls)
     {
         for (size_t i = 0; i < enclave->num_ecalls; i++)
             free(enclave->ecalls[i].name);
@@ -741,6 +918,8 @@ oe_result_t oe_create_enclave(
     oe_result_t result = OE_UNEXPECTED;
     oe_enclave_t* enclave = NULL;
     oe_sgx_load_context_t context;
+    size_t num_host_workers = 0;
+    size_t num_enclave_workers = 0;
 
     _initialize_enclave_host();
 
@@ -751,13 +930,26 @@ oe_result_t oe_create_enclave(
     if (!enclave_path || !enclave_out ||
         ((enclave_type != OE_ENCLAVE_TYPE_SGX) &&
          (enclave_type != OE_ENCLAVE_TYPE_AUTO)) ||
-        (flags & OE_ENCLAVE_FLAG_RESERVED) || config || config_size > 0)
+        (flags & OE_ENCLAVE_FLAG_RESERVED))
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    OE_CHECK(_parse_enclave_settings(
+        (const oe_enclave_setting_t*)config,
+        config_size,
+        &num_host_workers,
+        &num_enclave_workers));
+
     /* Allocate and zero-fill the enclave structure */
     if (!(enclave = (oe_enclave_t*)calloc(1, sizeof(oe_enclave_t))))
         OE_RAISE(OE_OUT_OF_MEMORY);
 
+    /* Initialize the context parameter and any driver handles */
+    OE_CHECK(oe_sgx_initialize_load_context(
+        &context, OE_SGX_LOAD_TYPE_CREATE, flags));
+
+    /* Build the enclave */
+    OE_CHECK(oe_sgx_build_enclave(&context, enclave_path, NULL, enclave));
+
 #if defined(_WIN32)
 
     /* Create Windows events for each TCS binding. Enclaves use
@@ -782,13 +974,6 @@ oe_result_t oe_create_enclave(
 
 #endif
 
-    /* Initialize the context parameter and any driver handles */
-    OE_CHECK(oe_sgx_initialize_load_context(
-        &context, OE_SGX_LOAD_TYPE_CREATE, flags));
-
-    /* Build the enclave */
-    OE_CHECK(oe_sgx_build_enclave(&context, enclave_path, NULL, enclave));
-
     /* Push the new created enclave to the global list. */
     if (oe_push_enclave_instance(enclave) != 0)
     {
@@ -807,12 +992,19 @@ oe_result_t oe_create_enclave(
     enclave->ocalls = (const oe_ocall_func_t*)ocall_table;
     enclave->num_ocalls = ocall_table_size;
 
+    /* Publish the clock page before the enclave can read it */
+    OE_CHECK(oe_start_shared_clock(enclave));
+
     /* Invoke enclave initialization. */
     OE_CHECK(_initialize_enclave(enclave));
 
     /* Setup logging configuration */
     oe_log_enclave_init(enclave);
 
+    /* Start the workers that service switchless OCALLs and ECALLs */
+    OE_CHECK(oe_start_switchless_manager(
+        enclave, num_host_workers, num_enclave_workers));
+
     *enclave_out = enclave;
     result = OE_OK;
 
@@ -820,7 +1012,12 @@ done:
 
     if (result != OE_OK && enclave)
     {
+        oe_log_enclave_terminate(enclave);
+        oe_stop_shared_clock(enclave);
         oe_free_enclave_ecalls(enclave);
+        _free_ocall_arenas(enclave);
+        oe_free_thread_bindings(enclave);
+        oe_symbolizer_free(enclave->symbolizer);
         free(enclave);
     }
 
@@ -837,9 +1034,21 @@ oe_result_t oe_terminate_enclave(oe_enclave_t* enclave)
     if (!enclave || enclave->magic != ENCLAVE_MAGIC)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    /* Enclave workers must leave the enclave before it is destroyed */
+    oe_stop_switchless_enclave_workers(enclave);
+
     /* Call the enclave destructor */
     OE_CHECK(oe_ecall(enclave, OE_ECALL_DESTRUCTOR, 0, NULL));
 
+    /* Stop the host workers once the enclave can no longer make OCALLs */
+    oe_stop_switchless_manager(enclave);
+
+    /* Log the records left in the log ring */
+    oe_log_enclave_terminate(enclave);
+
+    /* The enclave no longer reads the clock page */
+    oe_stop_shared_clock(enclave);
+
 #if defined(__linux__)
 
     /* Notify GDB that this enclave is terminated */
@@ -879,6 +1088,15 @@ oe_result_t oe_terminate_enclave(oe_enclave_t* enclave)
 
         /* Free the path name of the enclave image file */
         free(enclave->path);
+
+        /* Release the symbolizer used for backtraces */
+        oe_symbolizer_free(enclave->symbolizer);
+
+        /* Release the OCALL arenas */
+        _free_ocall_arenas(enclave);
+
+        /* Release the thread bindings */
+        oe_free_thread_bindings(enclave);
     }
     /* Release and destroy the mutex object */
     oe_mutex_unlock(&enclave->lock);
@@ -16,6 +16,12 @@
 #include "../fopen.h"
 #include "../strings.h"
 
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #define GOTO(LABEL)                                            \
     do                                                         \
     {                                                          \
@@ -258,6 +264,39 @@ static int _reset_buffer(
     return 0;
 }
 
+static void _free_data(elf64_t* elf)
+{
+#if defined(__linux__)
+    if (elf->mapped_size)
+    {
+        munmap(elf->data, elf->mapped_size);
+        close(elf->fd);
+        return;
+    }
+#endif
+
+    free(elf->data);
+}
+
+/* Move the data of a mapped file to the heap, so that it can be resized */
+static int _copy_mapped_data(elf64_t* elf)
+{
+    void* data;
+
+    if (!elf->mapped_size)
+        return 0;
+
+    if (!(data = malloc(elf->size)))
+        return -1;
+
+    memcpy(data, elf->data, elf->size);
+    _free_data(elf);
+    elf->data = data;
+    elf->mapped_size = 0;
+
+    return 0;
+}
+
 int elf64_load(const char* path, elf64_t* elf)
 {
     int rc = -1;
@@ -275,6 +314,40 @@ int elf64_load(const char* path, elf64_t* elf)
     if (!path || !elf)
         goto done;
 
+#if defined(__linux__)
+
+    /* Open input file */
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        goto done;
+
+    if (fstat(fd, &statbuf) != 0)
+        goto done;
+
+    /* Reject non-regular and empty files */
+    if (!S_ISREG(statbuf.st_mode) || statbuf.st_size == 0)
+        goto done;
+
+    /* Store the size of this file */
+    elf->size = (size_t)statbuf.st_size;
+
+    /* Map the file copy-on-write: pages are only read from the file when
+     * they are accessed, and only copied when they are written (for example
+     * when oesign updates the enclave properties). The descriptor is kept
+     * so that the loader can map the segments of the file as well. */
+    elf->data =
+        mmap(NULL, elf->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (elf->data == MAP_FAILED)
+    {
+        elf->data = NULL;
+        goto done;
+    }
+
+    elf->mapped_size = elf->size;
+    elf->fd = fd;
+    fd = -1;
+
+#else /* !defined(__linux__) */
+
     /* Open input file */
     if (oe_fopen(&is, path, "rb") != 0)
         goto done;
@@ -307,6 +380,8 @@ int elf64_load(const char* path, elf64_t* elf)
     if (fread(elf->data, 1, elf->size, is) != elf->size)
         goto done;
 
+#endif /* !defined(__linux__) */
+
     /* Validate the ELF file. */
     if (!_is_valid_elf64(elf))
         goto done;
@@ -321,10 +396,18 @@ done:
     if (is)
         fclose(is);
 
+#if defined(__linux__)
+    if (fd >= 0)
+        close(fd);
+#endif
+
     if (rc != 0)
     {
-        free(elf->data);
-        memset(elf, 0, sizeof(elf64_t));
+        if (elf)
+        {
+            _free_data(elf);
+            memset(elf, 0, sizeof(elf64_t));
+        }
     }
 
     if (rc)
@@ -340,7 +423,7 @@ int elf64_unload(elf64_t* elf)
     if (!_is_valid_elf64(elf))
         goto done;
 
-    free(elf->data);
+    _free_data(elf);
 
     rc = 0;
 
@@ -510,16 +593,16 @@ done:
     return rc;
 }
 
-int elf64_get_dynamic_symbol_table(
+static int _get_symbol_table(
     const elf64_t* elf,
+    const char* section_name,
+    elf64_word_t sh_type,
     const elf64_sym_t** symtab,
     size_t* size)
 {
     int rc = -1;
     size_t index;
     const elf64_shdr_t* sh;
-    const char* SECTIONNAME = ".dynsym";
-    const elf64_word_t SH_TYPE = SHT_DYNSYM;
 
     if (!_is_valid_elf64(elf) || !symtab || !size)
         goto done;
@@ -528,7 +611,7 @@ int elf64_get_dynamic_symbol_table(
     *size = 0;
 
     /* Find the symbol table section header */
-    if ((index = _find_shdr(elf, SECTIONNAME)) == (size_t)-1)
+    if ((index = _find_shdr(elf, section_name)) == (size_t)-1)
         goto done;
 
     if (index == 0 || index >= _get_header(elf)->e_shnum)
@@ -539,7 +622,7 @@ int elf64_get_dynamic_symbol_table(
         goto done;
 
     /* If this is not a symbol table */
-    if (sh->sh_type != SH_TYPE)
+    if (sh->sh_type != sh_type)
         goto done;
 
     /* Sanity check */
@@ -558,6 +641,22 @@ done:
     return rc;
 }
 
+int elf64_get_dynamic_symbol_table(
+    const elf64_t* elf,
+    const elf64_sym_t** symtab,
+    size_t* size)
+{
+    return _get_symbol_table(elf, ".dynsym", SHT_DYNSYM, symtab, size);
+}
+
+int elf64_get_symbol_table(
+    const elf64_t* elf,
+    const elf64_sym_t** symtab,
+    size_t* size)
+{
+    return _get_symbol_table(elf, ".symtab", SHT_SYMTAB, symtab, size);
+}
+
 const char* elf64_get_string_from_dynstr(
     const elf64_t* elf,
     elf64_word_t offset)
@@ -1594,7 +1693,10 @@ int elf64_add_section(
         sh.sh_offset = shdr->sh_offset;
     }
 
-    /* Initialize the memory buffer */
+    /* Initialize the memory buffer (which takes over the file image) */
+    if (_copy_mapped_data(elf) != 0)
+        GOTO(done);
+
     if (mem_dynamic(&mem, elf->data, elf->size, elf->size) != 0)
         GOTO(done);
 
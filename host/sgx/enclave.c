@@ -4,31 +4,107 @@
 #include "enclave.h"
 #include <assert.h>
 #include <openenclave/host.h>
+#include <openenclave/internal/raise.h>
+#include <stdlib.h>
 
-/* Get the event object from the enclave for the given TCS */
-EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs)
+/*
+**==============================================================================
+**
+** oe_find_thread_binding()
+**
+**     The TCSs are added at a fixed stride by oe_sgx_build_enclave(), so the
+**     binding index can be computed from the TCS address, which keeps the
+**     lookup constant-time however many TCSs the enclave has. The bindings
+**     array does not change after the enclave is built, so no lock is needed.
+**
+**==============================================================================
+*/
+
+ThreadBinding* oe_find_thread_binding(oe_enclave_t* enclave, uint64_t tcs)
 {
-    EnclaveEvent* event = NULL;
+    size_t num_bindings;
+    uint64_t first;
+    uint64_t stride;
 
-    if (!enclave)
+    if (!enclave || !(num_bindings = enclave->num_bindings))
         return NULL;
 
-    oe_mutex_lock(&enclave->lock);
+    first = enclave->bindings[0].tcs;
+
+    if (tcs < first)
+        return NULL;
+
+    if (num_bindings == 1)
+        return tcs == first ? &enclave->bindings[0] : NULL;
+
+    stride = enclave->bindings[1].tcs - first;
+
+    if (stride && (tcs - first) % stride == 0)
+    {
+        uint64_t index = (tcs - first) / stride;
+
+        if (index < num_bindings && enclave->bindings[index].tcs == tcs)
+            return &enclave->bindings[index];
+    }
+
+    /* Fall back to a scan if the TCSs are not evenly spaced */
+    for (size_t i = 0; i < num_bindings; i++)
     {
-        size_t i;
-
-        for (i = 0; i < enclave->num_bindings; i++)
-        {
-            ThreadBinding* binding = &enclave->bindings[i];
-
-            if (binding->tcs == tcs)
-            {
-                event = &binding->event;
-                break;
-            }
-        }
+        if (enclave->bindings[i].tcs == tcs)
+            return &enclave->bindings[i];
     }
-    oe_mutex_unlock(&enclave->lock);
 
-    return event;
+    return NULL;
+}
+
+oe_result_t oe_allocate_thread_bindings(oe_enclave_t* enclave, size_t num_tcs)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!enclave || !num_tcs || enclave->bindings)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(enclave->bindings =
+              (ThreadBinding*)calloc(num_tcs, sizeof(ThreadBinding))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (!(enclave->free_bindings = (volatile uint64_t*)calloc(
+              (num_tcs + 63) / 64, sizeof(uint64_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    enclave->num_bindings = 0;
+    result = OE_OK;
+
+done:
+
+    if (result != OE_OK && enclave)
+        oe_free_thread_bindings(enclave);
+
+    return result;
+}
+
+void oe_free_thread_bindings(oe_enclave_t* enclave)
+{
+    free(enclave->bindings);
+    free((void*)enclave->free_bindings);
+    enclave->bindings = NULL;
+    enclave->free_bindings = NULL;
+    enclave->num_bindings = 0;
+}
+
+void oe_initialize_free_bindings(oe_enclave_t* enclave)
+{
+    for (size_t i = 0; i < (enclave->num_bindings + 63) / 64; i++)
+        enclave->free_bindings[i] = 0;
+
+    for (size_t i = 0; i < enclave->num_bindings; i++)
+        enclave->free_bindings[i / 64] |= (1ULL << (i % 64));
+}
+
+/* Get the event object from the enclave for the given TCS */
+EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs)
+{
+    ThreadBinding* binding = oe_find_thread_binding(enclave, tcs);
+
+    return binding ? &binding->event : NULL;
 }
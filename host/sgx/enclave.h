@@ -9,9 +9,13 @@
 #include <openenclave/host.h>
 #include <openenclave/internal/load.h>
 #include <openenclave/internal/sgxcreate.h>
+#include <openenclave/internal/switchless.h>
+#include <openenclave/internal/time.h>
+#include <openenclave/internal/trace.h>
 #include <stdbool.h>
 #include "../hostthread.h"
 #include "asmdefs.h"
+#include "symbolizer.h"
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -58,6 +62,10 @@ typedef struct _ecall_name_addr
 **     context more than once. The ThreadBinding.count field indicates how
 **     many bindings are in effect.
 **
+**     Free bindings are tracked in the oe_enclave_t.free_bindings bitmap and
+**     claimed with compare-and-swap, so assigning a TCS takes no lock. Once
+**     claimed, a binding is only modified by the thread it is assigned to.
+**
 **==============================================================================
 */
 
@@ -85,6 +93,12 @@ typedef struct _thread_binding
 
 OE_STATIC_ASSERT(OE_OFFSETOF(ThreadBinding, tcs) == ThreadBinding_tcs);
 
+#if defined(__linux__)
+/* Must match THREAD_BINDING_SIZE in
+ * debugger/pythonExtension/gdb_sgx_plugin.py */
+OE_STATIC_ASSERT(sizeof(ThreadBinding) == 0x38);
+#endif
+
 /* Whether this binding is busy */
 #define _OE_THREAD_BUSY 0X1UL
 
@@ -115,8 +129,9 @@ struct _oe_enclave
     /* Size of enclave in bytes */
     uint64_t size;
 
-    /* Array of thread bindings */
-    ThreadBinding bindings[OE_SGX_MAX_TCS];
+    /* Array of thread bindings, one per TCS (allocated when the TCSs are
+     * added by oe_sgx_build_enclave()) */
+    ThreadBinding* bindings;
     size_t num_bindings;
     oe_mutex lock;
 
@@ -136,6 +151,48 @@ struct _oe_enclave
 
     /* Simulation mode */
     bool simulate;
+
+    /* Manager and host worker threads for switchless calls */
+    oe_switchless_call_manager_t* switchless_manager;
+    oe_thread* switchless_host_worker_threads;
+    oe_thread* switchless_enclave_worker_threads;
+
+    /* Untrusted arenas for OCALL buffers, one per TCS */
+    void* ocall_arenas;
+
+    /* Larger arenas that replaced them (OE_OCALL_GROW_OCALL_ARENA), one slot
+     * per TCS */
+    void** grown_ocall_arenas;
+
+    /* Bitmap of bindings that are not assigned to a thread (bit set), with
+     * one word for every 64 bindings */
+    volatile uint64_t* free_bindings;
+
+    /* Clock page shared with the enclave and the thread that refreshes it,
+     * which is started on the enclave's first read of the clock */
+    oe_shared_clock_t* shared_clock;
+    oe_thread shared_clock_thread;
+    bool shared_clock_started;
+    volatile uint32_t shared_clock_stopping;
+
+    /* Ring of log records of a debug enclave and the thread that drains it */
+    oe_log_ring_t* log_ring;
+    oe_thread log_ring_thread;
+    volatile uint32_t log_ring_stopping;
+
+    /* Tail at which draining last found an incomplete record, and since
+     * when (see oe_get_time()), or zero */
+    uint32_t log_ring_stall_tail;
+    uint64_t log_ring_stall_time;
+
+    /* Function names of the enclave image for backtraces, built on first
+     * use (see ocalls.c), and whether building them failed */
+    oe_symbolizer_t* symbolizer;
+    bool symbolizer_failed;
+
+    /* Entry of the image cache whose ECALL table this enclave shares, if
+     * any (see imagecache.c) */
+    struct _oe_image_cache_entry* image_cache_entry;
 };
 
 // Static asserts for consistency with
@@ -149,7 +206,9 @@ OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_t, addr) == 2 * sizeof(void*));
 // The fields up to binding correspond to 'ENCLAVE_HEADER'
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_t, bindings) == 0x28);
 
-OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_t, debug) == 0x798);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_t, num_bindings) == 0x30);
+
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_t, debug) == 0xA0);
 OE_STATIC_ASSERT(
     OE_OFFSETOF(oe_enclave_t, debug) + 1 ==
     OE_OFFSETOF(oe_enclave_t, simulate));
@@ -158,7 +217,42 @@ OE_STATIC_ASSERT(
 /* Get the event for the given TCS */
 EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs);
 
+/* Get the binding for the given TCS without taking the enclave lock */
+ThreadBinding* oe_find_thread_binding(oe_enclave_t* enclave, uint64_t tcs);
+
+/* Allocate the bindings and the free-binding bitmap for num_tcs TCSs */
+oe_result_t oe_allocate_thread_bindings(oe_enclave_t* enclave, size_t num_tcs);
+
+/* Release the arrays allocated by oe_allocate_thread_bindings() */
+void oe_free_thread_bindings(oe_enclave_t* enclave);
+
+/* Mark all bindings as free once the TCSs have been added */
+void oe_initialize_free_bindings(oe_enclave_t* enclave);
+
 /* Free enclave ecall allocation */
 void oe_free_enclave_ecalls(oe_enclave_t* enclave);
 
+/* Start the worker threads that service switchless OCALLs and ECALLs */
+oe_result_t oe_start_switchless_manager(
+    oe_enclave_t* enclave,
+    size_t num_host_workers,
+    size_t num_enclave_workers);
+
+/* Stop the enclave worker threads that service switchless ECALLs */
+void oe_stop_switchless_enclave_workers(oe_enclave_t* enclave);
+
+/* Stop all worker threads that service switchless calls */
+void oe_stop_switchless_manager(oe_enclave_t* enclave);
+
+/* Allocate and publish the enclave's shared clock page */
+oe_result_t oe_start_shared_clock(oe_enclave_t* enclave);
+
+/* Stop the shared clock thread and release the page */
+void oe_stop_shared_clock(oe_enclave_t* enclave);
+
+/* Post a switchless ECALL to an idle enclave worker */
+oe_result_t oe_post_switchless_ecall(
+    oe_enclave_t* enclave,
+    oe_call_enclave_function_args_t* args);
+
 #endif /* _OE_HOST_ENCLAVE_H */
@@ -0,0 +1,529 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <Windows.h>
+#endif
+
+#include <openenclave/host.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/time.h>
+#include "../hostthread.h"
+#include "../strings.h"
+
+/*
+**==============================================================================
+**
+** Enclave pools
+**
+**     A pool keeps enclaves that were created from the same image ready for
+**     use. The enclaves not in use are kept in a ring: acquiring takes the
+**     first one and releasing appends one, both in constant time.
+**
+**     Up to OE_ENCLAVE_POOL_MAX_THREADS background threads (one per
+**     enclave to keep ready) do everything else: they create enclaves while
+**     fewer than min_enclaves are ready, terminate the enclaves found to be
+**     unhealthy, and every OE_ENCLAVE_POOL_CHECK_INTERVAL milliseconds check
+**     the health of the ready enclaves. An enclave is healthy if
+**     oe_get_enclave_status() returns OE_OK in it, which takes a single
+**     OE_ECALL_GET_ENCLAVE_STATUS ECALL. After a failed creation, the threads
+**     wait for the same interval before creating enclaves again.
+**
+**     A health check takes one enclave at a time off the ring. That enclave
+**     still counts as ready: the threads do not replace it, and acquiring
+**     waits for its check to end rather than failing or creating an enclave
+**     when it is the only one left.
+**
+**     The threads sleep on the event field of the pool, which is incremented
+**     whenever there is work for them.
+**
+**==============================================================================
+*/
+
+#define OE_ENCLAVE_POOL_MAX_THREADS 4
+
+#define OE_ENCLAVE_POOL_CHECK_INTERVAL 1000
+
+struct _oe_enclave_pool
+{
+    oe_create_enclave_func_t create_enclave;
+    char* path;
+    oe_enclave_type_t type;
+    uint32_t flags;
+    const void* config;
+    uint32_t config_size;
+    size_t min_enclaves;
+    size_t max_enclaves;
+
+    /* Guards all fields below */
+    oe_mutex lock;
+
+    /* Ring of the enclaves that are ready for use (max_enclaves slots) */
+    oe_enclave_t** ready;
+    size_t first_ready;
+    size_t num_ready;
+
+    /* Ready enclave taken off the ring for a health check, or NULL */
+    oe_enclave_t* checking;
+
+    /* Unhealthy enclaves waiting to be terminated (max_enclaves slots) */
+    oe_enclave_t** retired;
+    size_t num_retired;
+
+    /* Enclaves of the pool, including those in use, retired or being
+     * created, and those being created by the background threads */
+    size_t num_enclaves;
+    size_t num_creating;
+
+    /* Times (see oe_get_time()) of the next health check and of the next
+     * creation attempt after a failure */
+    uint64_t next_check;
+    uint64_t next_creation;
+
+    volatile uint32_t event;
+    volatile uint32_t stopping;
+
+    oe_thread threads[OE_ENCLAVE_POOL_MAX_THREADS];
+    size_t num_threads;
+};
+
+static void _wait(oe_enclave_pool_t* pool, uint32_t event)
+{
+#if defined(__linux__)
+    struct timespec timeout = {OE_ENCLAVE_POOL_CHECK_INTERVAL / 1000, 0};
+
+    syscall(
+        __NR_futex,
+        (uint32_t*)&pool->event,
+        FUTEX_WAIT_PRIVATE,
+        event,
+        &timeout,
+        NULL,
+        0);
+#elif defined(_WIN32)
+    WaitOnAddress(
+        &pool->event, &event, sizeof(event), OE_ENCLAVE_POOL_CHECK_INTERVAL);
+#endif
+}
+
+/* Called with the lock held */
+static void _wake(oe_enclave_pool_t* pool)
+{
+    pool->event++;
+
+#if defined(__linux__)
+    syscall(
+        __NR_futex,
+        (uint32_t*)&pool->event,
+        FUTEX_WAKE_PRIVATE,
+        OE_ENCLAVE_POOL_MAX_THREADS,
+        NULL,
+        NULL,
+        0);
+#elif defined(_WIN32)
+    WakeByAddressAll((void*)&pool->event);
+#endif
+}
+
+static oe_enclave_t* _pop_ready(oe_enclave_pool_t* pool)
+{
+    oe_enclave_t* enclave;
+
+    if (pool->num_ready == 0)
+        return NULL;
+
+    enclave = pool->ready[pool->first_ready];
+    pool->first_ready = (pool->first_ready + 1) % pool->max_enclaves;
+    pool->num_ready--;
+
+    return enclave;
+}
+
+static void _push_ready(oe_enclave_pool_t* pool, oe_enclave_t* enclave)
+{
+    size_t last = (pool->first_ready + pool->num_ready) % pool->max_enclaves;
+
+    pool->ready[last] = enclave;
+    pool->num_ready++;
+}
+
+/* Number of ready enclaves, including the one being checked */
+static size_t _num_ready(const oe_enclave_pool_t* pool)
+{
+    return pool->num_ready + (pool->checking ? 1 : 0);
+}
+
+static bool _is_healthy(oe_enclave_t* enclave)
+{
+    uint64_t status = (uint64_t)OE_UNEXPECTED;
+
+    /* A crashed enclave returns its status without running the ECALL */
+    if (oe_ecall(enclave, OE_ECALL_GET_ENCLAVE_STATUS, 0, &status) != OE_OK)
+        return false;
+
+    return (oe_result_t)status == OE_OK;
+}
+
+static oe_result_t _create_enclave(
+    oe_enclave_pool_t* pool,
+    oe_enclave_t** enclave)
+{
+    return pool->create_enclave(
+        pool->path,
+        pool->type,
+        pool->flags,
+        pool->config,
+        pool->config_size,
+        enclave);
+}
+
+/* Check each ready enclave once. Called with the lock held, by one thread
+ * at a time (the one that advanced next_check) */
+static void _check_ready_enclaves(oe_enclave_pool_t* pool)
+{
+    for (size_t n = pool->num_ready; n > 0 && !pool->stopping; n--)
+    {
+        oe_enclave_t* enclave;
+        bool healthy;
+
+        if (!(enclave = _pop_ready(pool)))
+            break;
+
+        pool->checking = enclave;
+
+        oe_mutex_unlock(&pool->lock);
+        healthy = _is_healthy(enclave);
+        oe_mutex_lock(&pool->lock);
+
+        pool->checking = NULL;
+
+        if (healthy)
+            _push_ready(pool, enclave);
+        else
+            pool->retired[pool->num_retired++] = enclave;
+
+        /* Let acquirers waiting for this enclave retry */
+        _wake(pool);
+    }
+}
+
+static void* _pool_thread(void* arg)
+{
+    oe_enclave_pool_t* pool = (oe_enclave_pool_t*)arg;
+
+    oe_mutex_lock(&pool->lock);
+
+    while (!pool->stopping)
+    {
+        uint64_t now = oe_get_time();
+        oe_enclave_t* enclave = NULL;
+
+        /* Terminate the retired enclaves first */
+        if (pool->num_retired)
+        {
+            enclave = pool->retired[--pool->num_retired];
+
+            oe_mutex_unlock(&pool->lock);
+            oe_terminate_enclave(enclave);
+            oe_mutex_lock(&pool->lock);
+
+            pool->num_enclaves--;
+            continue;
+        }
+
+        /* Create an enclave if too few are ready */
+        if (_num_ready(pool) + pool->num_creating < pool->min_enclaves &&
+            pool->num_enclaves < pool->max_enclaves &&
+            now >= pool->next_creation)
+        {
+            oe_result_t result;
+
+            pool->num_enclaves++;
+            pool->num_creating++;
+
+            oe_mutex_unlock(&pool->lock);
+            result = _create_enclave(pool, &enclave);
+            oe_mutex_lock(&pool->lock);
+
+            pool->num_creating--;
+
+            if (result == OE_OK)
+            {
+                _push_ready(pool, enclave);
+            }
+            else
+            {
+                pool->num_enclaves--;
+                pool->next_creation =
+                    oe_get_time() + OE_ENCLAVE_POOL_CHECK_INTERVAL;
+            }
+
+            continue;
+        }
+
+        /* Check the health of the ready enclaves, unless a check that ran
+         * past the interval is still going on */
+        if (now >= pool->next_check && !pool->checking)
+        {
+            pool->next_check = now + OE_ENCLAVE_POOL_CHECK_INTERVAL;
+            _check_ready_enclaves(pool);
+            continue;
+        }
+
+        /* Sleep until there is work or the next check is due */
+        {
+            uint32_t event = pool->event;
+
+            oe_mutex_unlock(&pool->lock);
+            _wait(pool, event);
+            oe_mutex_lock(&pool->lock);
+        }
+    }
+
+    oe_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+static void _stop_threads(oe_enclave_pool_t* pool)
+{
+    oe_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    _wake(pool);
+    oe_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->num_threads; i++)
+        oe_thread_join(pool->threads[i]);
+
+    pool->num_threads = 0;
+}
+
+static void _free_pool(oe_enclave_pool_t* pool)
+{
+    oe_enclave_t* enclave;
+
+    while ((enclave = _pop_ready(pool)))
+        oe_terminate_enclave(enclave);
+
+    while (pool->num_retired)
+        oe_terminate_enclave(pool->retired[--pool->num_retired]);
+
+    oe_mutex_destroy(&pool->lock);
+    free(pool->ready);
+    free(pool->retired);
+    free(pool->path);
+    free(pool);
+}
+
+oe_result_t oe_create_enclave_pool(
+    oe_create_enclave_func_t create_enclave,
+    const char* path,
+    oe_enclave_type_t type,
+    uint32_t flags,
+    const void* config,
+    uint32_t config_size,
+    size_t min_enclaves,
+    size_t max_enclaves,
+    oe_enclave_pool_t** pool_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_enclave_pool_t* pool = NULL;
+    size_t num_threads;
+
+    if (pool_out)
+        *pool_out = NULL;
+
+    if (!create_enclave || !path || !pool_out || max_enclaves == 0 ||
+        min_enclaves > max_enclaves)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(pool = (oe_enclave_pool_t*)calloc(1, sizeof(oe_enclave_pool_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (oe_mutex_init(&pool->lock) != 0)
+    {
+        free(pool);
+        pool = NULL;
+        OE_RAISE(OE_FAILURE);
+    }
+
+    pool->create_enclave = create_enclave;
+    pool->type = type;
+    pool->flags = flags;
+    pool->config = config;
+    pool->config_size = config_size;
+    pool->min_enclaves = min_enclaves;
+    pool->max_enclaves = max_enclaves;
+    pool->next_check = oe_get_time() + OE_ENCLAVE_POOL_CHECK_INTERVAL;
+
+    if (!(pool->path = oe_strdup(path)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (!(pool->ready = (oe_enclave_t**)calloc(
+              max_enclaves, sizeof(oe_enclave_t*))) ||
+        !(pool->retired = (oe_enclave_t**)calloc(
+              max_enclaves, sizeof(oe_enclave_t*))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* At least one thread checks the health of the enclaves */
+    num_threads = min_enclaves;
+
+    if (num_threads == 0)
+        num_threads = 1;
+    else if (num_threads > OE_ENCLAVE_POOL_MAX_THREADS)
+        num_threads = OE_ENCLAVE_POOL_MAX_THREADS;
+
+    for (size_t i = 0; i < num_threads; i++)
+    {
+        if (oe_thread_create(&pool->threads[i], _pool_thread, pool) != 0)
+            OE_RAISE_MSG(OE_FAILURE, "failed to create a pool thread", NULL);
+
+        pool->num_threads++;
+    }
+
+    *pool_out = pool;
+    pool = NULL;
+    result = OE_OK;
+
+done:
+
+    if (pool)
+    {
+        _stop_threads(pool);
+        _free_pool(pool);
+    }
+
+    return result;
+}
+
+oe_result_t oe_enclave_pool_acquire(
+    oe_enclave_pool_t* pool,
+    oe_enclave_t** enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    bool create = false;
+
+    if (enclave)
+        *enclave = NULL;
+
+    if (!pool || !enclave)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_mutex_lock(&pool->lock);
+    {
+        /* Wait for the enclave under a health check if it is the only ready
+         * one, since it is most likely healthy */
+        while (!pool->num_ready && pool->checking)
+        {
+            uint32_t event = pool->event;
+
+            oe_mutex_unlock(&pool->lock);
+            _wait(pool, event);
+            oe_mutex_lock(&pool->lock);
+        }
+
+        if ((*enclave = _pop_ready(pool)))
+        {
+            /* Have the threads replace the enclave */
+            if (_num_ready(pool) + pool->num_creating < pool->min_enclaves)
+                _wake(pool);
+        }
+        else if (pool->num_enclaves < pool->max_enclaves)
+        {
+            pool->num_enclaves++;
+            create = true;
+        }
+    }
+    oe_mutex_unlock(&pool->lock);
+
+    /* Create an enclave only if none is ready */
+    if (create)
+    {
+        if ((result = _create_enclave(pool, enclave)) != OE_OK)
+        {
+            oe_mutex_lock(&pool->lock);
+            pool->num_enclaves--;
+            oe_mutex_unlock(&pool->lock);
+            OE_RAISE(result);
+        }
+    }
+    else if (!*enclave)
+    {
+        OE_RAISE_NO_TRACE(OE_BUSY);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_enclave_pool_release(
+    oe_enclave_pool_t* pool,
+    oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    bool healthy;
+
+    if (!pool || !enclave)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    healthy = _is_healthy(enclave);
+
+    oe_mutex_lock(&pool->lock);
+    {
+        /* The pool cannot hold more enclaves than it created */
+        if (_num_ready(pool) + pool->num_retired == pool->max_enclaves)
+        {
+            oe_mutex_unlock(&pool->lock);
+            OE_RAISE(OE_INVALID_PARAMETER);
+        }
+
+        if (healthy)
+        {
+            _push_ready(pool, enclave);
+        }
+        else
+        {
+            pool->retired[pool->num_retired++] = enclave;
+            _wake(pool);
+        }
+    }
+    oe_mutex_unlock(&pool->lock);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_terminate_enclave_pool(oe_enclave_pool_t* pool)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t num_in_use;
+
+    if (!pool)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_mutex_lock(&pool->lock);
+    num_in_use = pool->num_enclaves - _num_ready(pool) - pool->num_retired -
+                 pool->num_creating;
+    oe_mutex_unlock(&pool->lock);
+
+    if (num_in_use)
+        OE_RAISE_MSG(OE_BUSY, "%zu enclaves are in use", num_in_use);
+
+    _stop_threads(pool);
+    _free_pool(pool);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
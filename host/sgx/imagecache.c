@@ -0,0 +1,258 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "imagecache.h"
+#include <openenclave/internal/raise.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "../hostthread.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+/*
+**==============================================================================
+**
+** Image cache
+**
+**     Hosts often create many enclaves from the same image file. For each
+**     of them, oe_sgx_build_enclave() used to read and parse the file, build
+**     the ECALL table (copying the name of every ECALL), lay out and patch
+**     the image and, in simulation mode, hash every page to get MRENCLAVE.
+**     None of this depends on where the enclave is created, so the results
+**     are kept in a process-wide cache and later enclaves only add pages.
+**
+**     An entry is keyed by the full path of the file, its device, inode,
+**     size and modification time, the load attributes and the properties
+**     passed in, so that a file replaced on disk is loaded again. Enclaves
+**     share the ECALL table of their entry, which is therefore only freed
+**     once no enclave uses it. Up to OE_IMAGE_CACHE_MAX_ENTRIES entries are
+**     kept; when the cache is full, the least recently used entry that no
+**     enclave uses is evicted, and if there is none nothing is cached.
+**
+**==============================================================================
+*/
+
+#define OE_IMAGE_CACHE_MAX_ENTRIES 16
+
+static oe_mutex _lock = OE_H_MUTEX_INITIALIZER;
+static oe_image_cache_entry_t* _entries;
+static size_t _num_entries;
+static uint64_t _clock;
+
+static char* _get_fullpath(const char* path)
+{
+#if defined(_WIN32)
+    char* fullpath = (char*)calloc(1, MAX_PATH);
+
+    if (fullpath && GetFullPathName(path, MAX_PATH, fullpath, NULL) == 0)
+    {
+        free(fullpath);
+        fullpath = NULL;
+    }
+
+    return fullpath;
+#else
+    return realpath(path, NULL);
+#endif
+}
+
+static bool _equal_keys(
+    const oe_image_cache_key_t* key1,
+    const oe_image_cache_key_t* key2)
+{
+    if (key1->dev != key2->dev || key1->ino != key2->ino ||
+        key1->size != key2->size || key1->mtime_sec != key2->mtime_sec ||
+        key1->mtime_nsec != key2->mtime_nsec ||
+        key1->attributes != key2->attributes ||
+        key1->has_properties != key2->has_properties)
+        return false;
+
+    if (key1->has_properties &&
+        memcmp(
+            &key1->properties,
+            &key2->properties,
+            sizeof(key1->properties)) != 0)
+        return false;
+
+    return strcmp(key1->path, key2->path) == 0;
+}
+
+static void _free_entry(oe_image_cache_entry_t* entry)
+{
+    for (size_t i = 0; i < entry->num_ecalls; i++)
+        free(entry->ecalls[i].name);
+
+    free(entry->ecalls);
+    free(entry->ecall_data);
+    oe_unload_enclave_image(&entry->image);
+    oe_image_cache_free_key(&entry->key);
+    free(entry);
+}
+
+oe_result_t oe_image_cache_make_key(
+    const char* path,
+    const oe_sgx_enclave_properties_t* properties,
+    uint64_t attributes,
+    oe_image_cache_key_t* key)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    struct stat st;
+
+    if (key)
+        memset(key, 0, sizeof(*key));
+
+    if (!path || !key)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(key->path = _get_fullpath(path)) || stat(key->path, &st) != 0)
+        OE_RAISE_NO_TRACE(OE_NOT_FOUND);
+
+    key->dev = (uint64_t)st.st_dev;
+    key->ino = (uint64_t)st.st_ino;
+    key->size = (uint64_t)st.st_size;
+    key->mtime_sec = (uint64_t)st.st_mtime;
+#if defined(__linux__)
+    key->mtime_nsec = (uint64_t)st.st_mtim.tv_nsec;
+#endif
+    key->attributes = attributes;
+
+    if (properties)
+    {
+        key->has_properties = true;
+        key->properties = *properties;
+    }
+
+    result = OE_OK;
+
+done:
+
+    if (result != OE_OK)
+        oe_image_cache_free_key(key);
+
+    return result;
+}
+
+void oe_image_cache_free_key(oe_image_cache_key_t* key)
+{
+    if (key)
+    {
+        free(key->path);
+        memset(key, 0, sizeof(*key));
+    }
+}
+
+oe_image_cache_entry_t* oe_image_cache_acquire(const oe_image_cache_key_t* key)
+{
+    oe_image_cache_entry_t* entry;
+
+    if (!key || !key->path)
+        return NULL;
+
+    oe_mutex_lock(&_lock);
+    {
+        for (entry = _entries; entry; entry = entry->next)
+        {
+            if (_equal_keys(&entry->key, key))
+            {
+                entry->refs++;
+                entry->last_use = ++_clock;
+                break;
+            }
+        }
+    }
+    oe_mutex_unlock(&_lock);
+
+    return entry;
+}
+
+oe_image_cache_entry_t* oe_image_cache_insert(
+    const oe_image_cache_entry_t* entry)
+{
+    oe_image_cache_entry_t* result = NULL;
+    oe_image_cache_entry_t* p;
+
+    if (!entry || !entry->key.path)
+        return NULL;
+
+    oe_mutex_lock(&_lock);
+    {
+        oe_image_cache_entry_t** victim = NULL;
+
+        /* Another thread may have cached the same image meanwhile */
+        for (p = _entries; p; p = p->next)
+        {
+            if (_equal_keys(&p->key, &entry->key))
+                goto done;
+        }
+
+        /* Make room by evicting the least recently used unused entry */
+        if (_num_entries == OE_IMAGE_CACHE_MAX_ENTRIES)
+        {
+            for (oe_image_cache_entry_t** pp = &_entries; *pp;
+                 pp = &(*pp)->next)
+            {
+                if ((*pp)->refs == 0 &&
+                    (!victim || (*pp)->last_use < (*victim)->last_use))
+                    victim = pp;
+            }
+
+            if (!victim)
+                goto done;
+
+            p = *victim;
+            *victim = p->next;
+            _num_entries--;
+            _free_entry(p);
+        }
+
+        if (!(result = (oe_image_cache_entry_t*)malloc(sizeof(*result))))
+            goto done;
+
+        *result = *entry;
+        result->refs = 1;
+        result->last_use = ++_clock;
+        result->next = _entries;
+        _entries = result;
+        _num_entries++;
+    }
+done:
+    oe_mutex_unlock(&_lock);
+
+    return result;
+}
+
+void oe_image_cache_release(oe_image_cache_entry_t* entry)
+{
+    if (entry)
+    {
+        oe_mutex_lock(&_lock);
+        entry->refs--;
+        oe_mutex_unlock(&_lock);
+    }
+}
+
+void oe_image_cache_clear(void)
+{
+    oe_mutex_lock(&_lock);
+    {
+        oe_image_cache_entry_t** pp = &_entries;
+
+        while (*pp)
+        {
+            oe_image_cache_entry_t* p = *pp;
+
+            if (p->refs == 0)
+            {
+                *pp = p->next;
+                _num_entries--;
+                _free_entry(p);
+            }
+            else
+                pp = &p->next;
+        }
+    }
+    oe_mutex_unlock(&_lock);
+}
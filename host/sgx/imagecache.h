@@ -0,0 +1,97 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_IMAGECACHE_H
+#define _OE_HOST_IMAGECACHE_H
+
+#include <openenclave/bits/properties.h>
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+#include <openenclave/internal/load.h>
+#include <openenclave/internal/sha.h>
+#include "enclave.h"
+
+OE_EXTERNC_BEGIN
+
+/* Identifies an enclave image file and how it is built into an enclave */
+typedef struct _oe_image_cache_key
+{
+    /* Full path of the image file */
+    char* path;
+
+    /* Identity of the file when the key was made */
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    uint64_t mtime_sec;
+    uint64_t mtime_nsec;
+
+    /* OE_FLAG bits of the load context (debug, simulation) */
+    uint64_t attributes;
+
+    /* Properties passed to oe_sgx_build_enclave(), if any */
+    bool has_properties;
+    oe_sgx_enclave_properties_t properties;
+} oe_image_cache_key_t;
+
+typedef struct _oe_image_cache_entry oe_image_cache_entry_t;
+
+/* What oe_sgx_build_enclave() derives from an image file before it adds the
+ * pages of an enclave. All fields are read-only once the entry is cached. */
+struct _oe_image_cache_entry
+{
+    oe_image_cache_key_t key;
+
+    /* The image, loaded and patched for the layout below */
+    oe_enclave_image_t image;
+    size_t image_size;
+
+    /* The properties the enclave is built with */
+    oe_sgx_enclave_properties_t props;
+
+    /* The ECALL table and the ECALL pages built from it */
+    ECallNameAddr* ecalls;
+    size_t num_ecalls;
+    void* ecall_data;
+    size_t ecall_size;
+
+    /* Layout of the enclave */
+    size_t enclave_end;
+    size_t enclave_size;
+
+    /* MRENCLAVE of the enclave (simulation mode only) */
+    bool has_mrenclave;
+    OE_SHA256 mrenclave;
+
+    /* Number of enclaves that use the entry and when it was last used */
+    uint64_t refs;
+    uint64_t last_use;
+    oe_image_cache_entry_t* next;
+};
+
+/* Make the key of the image file at path (fails if the file is missing) */
+oe_result_t oe_image_cache_make_key(
+    const char* path,
+    const oe_sgx_enclave_properties_t* properties,
+    uint64_t attributes,
+    oe_image_cache_key_t* key);
+
+void oe_image_cache_free_key(oe_image_cache_key_t* key);
+
+/* Return the entry for key with a reference taken, or NULL if none */
+oe_image_cache_entry_t* oe_image_cache_acquire(const oe_image_cache_key_t* key);
+
+/* Cache entry, which takes ownership of everything it points to, and return
+ * it with a reference taken. On failure, return NULL and leave entry alone */
+oe_image_cache_entry_t* oe_image_cache_insert(
+    const oe_image_cache_entry_t* entry);
+
+/* Drop a reference taken by oe_image_cache_acquire/oe_image_cache_insert */
+void oe_image_cache_release(oe_image_cache_entry_t* entry);
+
+/* Free the entries that no enclave uses */
+void oe_image_cache_clear(void);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_IMAGECACHE_H */
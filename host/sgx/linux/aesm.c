@@ -9,10 +9,12 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
+#include <errno.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <unistd.h>
+#include "../../hostthread.h"
 
 /*
 **==============================================================================
@@ -23,6 +25,12 @@
 **
 **     $ services aesmd status
 **
+** Connections obtained with aesm_acquire() are returned to a pool by
+** aesm_release() and reused by later requests, since AESM serves any number
+** of requests on a connection. A request that fails on a reused connection,
+** which AESM may have closed in the meantime, is retried once on a new one.
+** Each connection keeps its request and response buffers between requests.
+**
 ** References:
 **
 **     See messages.proto from the Intel SGX SDK for the interface.
@@ -34,6 +42,9 @@
 
 #define AESM_SOCKET "/var/run/aesmd/aesm.socket"
 
+/* Maximum number of idle connections kept in the pool */
+#define AESM_POOL_MAX_IDLE 8
+
 typedef enum _wire_type
 {
     WIRE_TYPE_VARINT = 0,
@@ -52,9 +63,29 @@ typedef enum _message_type
 struct _aesm
 {
     uint32_t magic;
+
+    /* The connection, or -1 if the last request broke it */
     int sock;
+
+    /* Number of requests served on this sock */
+    uint64_t num_requests;
+
+    /* Buffers reused by every request on this connection */
+    mem_t request;
+    mem_t response;
+    mem_t envelope;
+
+    /* Next idle connection in the pool */
+    aesm_t* next;
 };
 
+static char _socket_path[sizeof(((struct sockaddr_un*)0)->sun_path)] =
+    AESM_SOCKET;
+
+static oe_mutex _pool_lock = OE_H_MUTEX_INITIALIZER;
+static aesm_t* _pool;
+static size_t _pool_size;
+
 static int _aesm_valid(const aesm_t* aesm)
 {
     return aesm != NULL && aesm->magic == AESM_MAGIC;
@@ -289,31 +320,53 @@ done:
 
 static int _read(int sock, void* data, size_t size)
 {
-    ssize_t n;
+    uint8_t* p = (uint8_t*)data;
 
-    if ((n = read(sock, data, size)) != (ssize_t)size)
-        return -1;
+    while (size > 0)
+    {
+        ssize_t n = read(sock, p, size);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return -1;
+
+        p += n;
+        size -= (size_t)n;
+    }
 
     return 0;
 }
 
 static int _write(int sock, const void* data, size_t size)
 {
-    ssize_t n;
+    const uint8_t* p = (const uint8_t*)data;
 
-    if ((n = write(sock, data, size)) != (ssize_t)size)
-        return -1;
+    while (size > 0)
+    {
+        /* Do not raise SIGPIPE if AESM has closed the connection */
+        ssize_t n = send(sock, p, size, MSG_NOSIGNAL);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n <= 0)
+            return -1;
+
+        p += n;
+        size -= (size_t)n;
+    }
 
     return 0;
 }
 
-static oe_result_t _write_request(
-    aesm_t* aesm,
-    message_type_t message_type,
-    const mem_t* message)
+static oe_result_t _write_request(aesm_t* aesm, message_type_t message_type)
 {
     oe_result_t result = OE_UNEXPECTED;
-    mem_t envelope = MEM_DYNAMIC_INIT;
+    const mem_t* message = &aesm->request;
+    mem_t* envelope = &aesm->envelope;
+    uint32_t size = 0;
 
     OE_TRACE_INFO("=== _write_request:\n");
     if (get_current_logging_level() >= OE_LOG_LEVEL_INFO)
@@ -321,43 +374,38 @@ static oe_result_t _write_request(
         oe_hex_dump(mem_ptr(message), mem_size(message));
     }
 
+    /* Reserve space for the envelope size, so that both are sent at once */
+    mem_clear(envelope);
+    if (mem_cat(envelope, &size, sizeof(uint32_t)) != 0)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
     /* Wrap message in envelope */
     OE_CHECK(_pack_bytes(
-        &envelope,
+        envelope,
         (uint8_t)message_type,
         mem_ptr(message),
         (uint32_t)mem_size(message)));
 
-    /* Send the envelope to the AESM service */
-    {
-        uint32_t size = (uint32_t)mem_size(&envelope);
-
-        /* Send message size */
-        if (_write(aesm->sock, &size, sizeof(uint32_t)) != 0)
-            OE_RAISE(OE_FAILURE);
+    size = (uint32_t)(mem_size(envelope) - sizeof(uint32_t));
+    OE_CHECK(oe_memcpy_s(
+        mem_mutable_ptr(envelope), mem_size(envelope), &size, sizeof(size)));
 
-        /* Send message data */
-        if (_write(aesm->sock, mem_ptr(&envelope), mem_size(&envelope)) != 0)
-            OE_RAISE(OE_FAILURE);
-    }
+    /* Send the envelope to the AESM service */
+    if (_write(aesm->sock, mem_ptr(envelope), mem_size(envelope)) != 0)
+        OE_RAISE(OE_FAILURE);
 
     result = OE_OK;
 
 done:
-
-    mem_free(&envelope);
-
     return result;
 }
 
-static oe_result_t _read_response(
-    aesm_t* aesm,
-    message_type_t message_type,
-    mem_t* message)
+static oe_result_t _read_response(aesm_t* aesm, message_type_t message_type)
 {
     oe_result_t result = OE_UNEXPECTED;
     uint32_t size;
-    mem_t envelope = MEM_DYNAMIC_INIT;
+    mem_t* message = &aesm->response;
+    mem_t* envelope = &aesm->envelope;
 
     mem_clear(message);
 
@@ -368,11 +416,11 @@ static oe_result_t _read_response(
             OE_RAISE(OE_FAILURE);
 
         /* Expand the buffer */
-        if (mem_resize(&envelope, size) != 0)
+        if (mem_resize(envelope, size) != 0)
             OE_RAISE(OE_FAILURE);
 
         /* Read the message */
-        if (_read(aesm->sock, mem_mutable_ptr(&envelope), size) != 0)
+        if (_read(aesm->sock, mem_mutable_ptr(envelope), size) != 0)
             OE_RAISE(OE_FAILURE);
     }
 
@@ -384,7 +432,7 @@ static oe_result_t _read_response(
         uint32_t size;
 
         /* Get the tag of this payload */
-        if ((pos = (size_t)_unpack_tag(&envelope, pos, &tag)) ==
+        if ((pos = (size_t)_unpack_tag(envelope, pos, &tag)) ==
             OE_ERROR_UNPACK)
             OE_RAISE(OE_FAILURE);
 
@@ -397,18 +445,19 @@ static oe_result_t _read_response(
             OE_RAISE(OE_FAILURE);
 
         /* Get the size of this payload */
-        if ((pos = (size_t)_unpack_variant_uint32(&envelope, pos, &size)) ==
+        if ((pos = (size_t)_unpack_variant_uint32(envelope, pos, &size)) ==
             OE_ERROR_UNPACK)
             OE_RAISE(OE_FAILURE);
 
         /* Check the size (must equal unread bytes in envelope) */
-        if (size != mem_size(&envelope) - (size_t)pos)
+        if (size != mem_size(envelope) - (size_t)pos)
             OE_RAISE(OE_FAILURE);
 
-        uint8_t* temp = (uint8_t*)mem_ptr(&envelope) + pos;
+        uint8_t* temp = (uint8_t*)mem_ptr(envelope) + pos;
 
         /* Read the message from the envelope */
-        mem_cat(message, (const void*)temp, (size_t)size);
+        if (mem_cat(message, (const void*)temp, (size_t)size) != 0)
+            OE_RAISE(OE_OUT_OF_MEMORY);
     }
 
     OE_TRACE_INFO("=== _read_response():\n");
@@ -420,38 +469,88 @@ static oe_result_t _read_response(
     result = OE_OK;
 
 done:
-
-    mem_free(&envelope);
-
     return result;
 }
 
-aesm_t* aesm_connect()
+static int _connect_socket(void)
 {
     int sock = -1;
     struct sockaddr_un addr;
-    aesm_t* aesm = NULL;
 
     /* Create a socket for connecting to the AESM service */
     if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
-        goto done;
+        return -1;
 
     /* Initialize the address */
     memset(&addr, 0, sizeof(struct sockaddr_un));
     addr.sun_family = AF_UNIX;
     oe_strncpy_s(
-        addr.sun_path, sizeof(addr.sun_path), AESM_SOCKET, strlen(AESM_SOCKET));
+        addr.sun_path,
+        sizeof(addr.sun_path),
+        _socket_path,
+        strlen(_socket_path));
 
     /* Connect to the AESM service */
     if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
     {
         close(sock);
-        goto done;
+        return -1;
     }
 
+    return sock;
+}
+
+/* Send aesm->request and receive aesm->response */
+static oe_result_t _transact(aesm_t* aesm, message_type_t message_type)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    for (uint32_t attempt = 0;; attempt++)
+    {
+        if (aesm->sock < 0)
+        {
+            if ((aesm->sock = _connect_socket()) < 0)
+                OE_RAISE(OE_SERVICE_UNAVAILABLE);
+
+            aesm->num_requests = 0;
+        }
+
+        result = _write_request(aesm, message_type);
+
+        if (result == OE_OK)
+            result = _read_response(aesm, message_type);
+
+        if (result == OE_OK)
+            break;
+
+        /* The state of the connection is unknown after a failure */
+        close(aesm->sock);
+        aesm->sock = -1;
+
+        /* AESM may have closed a connection that sat in the pool, so retry
+         * once on a new connection. Failing on a new connection is final. */
+        if (aesm->num_requests == 0 || attempt > 0)
+            OE_RAISE(result);
+    }
+
+    aesm->num_requests++;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+aesm_t* aesm_connect()
+{
+    int sock = -1;
+    aesm_t* aesm = NULL;
+
+    if ((sock = _connect_socket()) < 0)
+        goto done;
+
     /* Allocate and initialize the AESM struct */
     {
-        if (!(aesm = (aesm_t*)malloc(sizeof(aesm_t))))
+        if (!(aesm = (aesm_t*)calloc(1, sizeof(aesm_t))))
         {
             close(sock);
             goto done;
@@ -459,6 +558,9 @@ aesm_t* aesm_connect()
 
         aesm->magic = AESM_MAGIC;
         aesm->sock = sock;
+        mem_dynamic(&aesm->request, NULL, 0, 0);
+        mem_dynamic(&aesm->response, NULL, 0, 0);
+        mem_dynamic(&aesm->envelope, NULL, 0, 0);
     }
 
 done:
@@ -473,12 +575,102 @@ void aesm_disconnect(aesm_t* aesm)
 {
     if (_aesm_valid(aesm))
     {
-        close(aesm->sock);
+        if (aesm->sock >= 0)
+            close(aesm->sock);
+
+        mem_free(&aesm->request);
+        mem_free(&aesm->response);
+        mem_free(&aesm->envelope);
         memset(aesm, 0xDD, sizeof(aesm_t));
         free(aesm);
     }
 }
 
+aesm_t* aesm_acquire(void)
+{
+    aesm_t* aesm = NULL;
+
+    oe_mutex_lock(&_pool_lock);
+    {
+        if ((aesm = _pool))
+        {
+            _pool = aesm->next;
+            _pool_size--;
+            aesm->next = NULL;
+        }
+    }
+    oe_mutex_unlock(&_pool_lock);
+
+    if (!aesm)
+        aesm = aesm_connect();
+
+    return aesm;
+}
+
+void aesm_release(aesm_t* aesm)
+{
+    if (!_aesm_valid(aesm))
+        return;
+
+    /* Keep the connection unless a request broke it */
+    if (aesm->sock >= 0)
+    {
+        oe_mutex_lock(&_pool_lock);
+        {
+            if (_pool_size < AESM_POOL_MAX_IDLE)
+            {
+                aesm->next = _pool;
+                _pool = aesm;
+                _pool_size++;
+                aesm = NULL;
+            }
+        }
+        oe_mutex_unlock(&_pool_lock);
+    }
+
+    if (aesm)
+        aesm_disconnect(aesm);
+}
+
+void aesm_clear_pool(void)
+{
+    aesm_t* pool;
+
+    oe_mutex_lock(&_pool_lock);
+    {
+        pool = _pool;
+        _pool = NULL;
+        _pool_size = 0;
+    }
+    oe_mutex_unlock(&_pool_lock);
+
+    while (pool)
+    {
+        aesm_t* next = pool->next;
+        aesm_disconnect(pool);
+        pool = next;
+    }
+}
+
+oe_result_t aesm_set_socket_path(const char* path)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!path)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(oe_strncpy_s(
+        _socket_path, sizeof(_socket_path), path, strlen(path)));
+
+    /* Drop the connections to the previous path */
+    aesm_clear_pool();
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 oe_result_t aesm_get_launch_token(
     aesm_t* aesm,
     uint8_t mrenclave[OE_SHA256_SIZE],
@@ -488,8 +680,8 @@ oe_result_t aesm_get_launch_token(
 {
     oe_result_t result = OE_UNEXPECTED;
     uint64_t timeout = 15000;
-    mem_t request = MEM_DYNAMIC_INIT;
-    mem_t response = MEM_DYNAMIC_INIT;
+    mem_t* request = NULL;
+    mem_t* response = NULL;
 
     if (launch_token)
         memset(launch_token, 0, sizeof(sgx_launch_token_t));
@@ -498,27 +690,28 @@ oe_result_t aesm_get_launch_token(
     if (!_aesm_valid(aesm) || !mrenclave || !modulus || !attributes)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    request = &aesm->request;
+    response = &aesm->response;
+    mem_clear(request);
+
     /* Build the PAYLOAD */
     {
         /* Pack MRENCLAVE */
-        OE_CHECK(_pack_bytes(&request, 1, mrenclave, OE_SHA256_SIZE));
+        OE_CHECK(_pack_bytes(request, 1, mrenclave, OE_SHA256_SIZE));
 
         /* Pack MODULUS */
-        OE_CHECK(_pack_bytes(&request, 2, modulus, OE_KEY_SIZE));
+        OE_CHECK(_pack_bytes(request, 2, modulus, OE_KEY_SIZE));
 
         /* Pack ATTRIBUTES */
         OE_CHECK(
-            _pack_bytes(&request, 3, attributes, sizeof(sgx_attributes_t)));
+            _pack_bytes(request, 3, attributes, sizeof(sgx_attributes_t)));
 
         /* Pack TIMEOUT */
-        OE_CHECK(_pack_var_int(&request, 9, timeout));
+        OE_CHECK(_pack_var_int(request, 9, timeout));
     }
 
-    /* Send the request to the AESM service */
-    OE_CHECK(_write_request(aesm, MESSAGE_TYPE_GET_LAUNCH_TOKEN, &request));
-
-    /* Receive the response from AESM service */
-    OE_CHECK(_read_response(aesm, MESSAGE_TYPE_GET_LAUNCH_TOKEN, &response));
+    /* Send the request and receive the response from the AESM service */
+    OE_CHECK(_transact(aesm, MESSAGE_TYPE_GET_LAUNCH_TOKEN));
 
     /* Unpack the response */
     {
@@ -527,7 +720,7 @@ oe_result_t aesm_get_launch_token(
         /* Unpack the error code */
         {
             uint32_t errcode;
-            OE_CHECK(_unpack_var_int(&response, &pos, 1, &errcode));
+            OE_CHECK(_unpack_var_int(response, &pos, 1, &errcode));
 
             if (errcode != 0)
                 OE_RAISE_MSG(OE_FAILURE, "errcode=0x%x", errcode);
@@ -535,15 +728,12 @@ oe_result_t aesm_get_launch_token(
 
         /* Unpack the launch token */
         OE_CHECK(_unpack_length_delimited(
-            &response, &pos, 2, launch_token, sizeof(sgx_launch_token_t)));
+            response, &pos, 2, launch_token, sizeof(sgx_launch_token_t)));
     }
 
     result = OE_OK;
 
 done:
-    mem_free(&request);
-    mem_free(&response);
-
     return result;
 }
 
@@ -554,8 +744,8 @@ oe_result_t aesm_init_quote(
 {
     oe_result_t result = OE_UNEXPECTED;
     uint64_t timeout = 15000;
-    mem_t request = MEM_DYNAMIC_INIT;
-    mem_t response = MEM_DYNAMIC_INIT;
+    mem_t* request = NULL;
+    mem_t* response = NULL;
 
     if (target_info)
         memset(target_info, 0, sizeof(sgx_target_info_t));
@@ -564,17 +754,18 @@ oe_result_t aesm_init_quote(
     if (!_aesm_valid(aesm) || !target_info || !epid_group_id)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    request = &aesm->request;
+    response = &aesm->response;
+    mem_clear(request);
+
     /* Build the PAYLOAD */
     {
         /* Pack TIMEOUT */
-        OE_CHECK(_pack_var_int(&request, 9, timeout));
+        OE_CHECK(_pack_var_int(request, 9, timeout));
     }
 
-    /* Send the request to the AESM service */
-    OE_CHECK(_write_request(aesm, MESSAGE_TYPE_INIT_QUOTE, &request));
-
-    /* Receive the response from AESM service */
-    OE_CHECK(_read_response(aesm, MESSAGE_TYPE_INIT_QUOTE, &response));
+    /* Send the request and receive the response from the AESM service */
+    OE_CHECK(_transact(aesm, MESSAGE_TYPE_INIT_QUOTE));
 
     /* Unpack the response */
     {
@@ -583,7 +774,7 @@ oe_result_t aesm_init_quote(
         /* Unpack the error code */
         {
             uint32_t errcode;
-            OE_CHECK(_unpack_var_int(&response, &pos, 1, &errcode));
+            OE_CHECK(_unpack_var_int(response, &pos, 1, &errcode));
 
             if (errcode != 0)
                 OE_RAISE_MSG(OE_FAILURE, "errcode=0x%x", errcode);
@@ -591,19 +782,16 @@ oe_result_t aesm_init_quote(
 
         /* Unpack target_info */
         OE_CHECK(_unpack_length_delimited(
-            &response, &pos, 2, target_info, sizeof(sgx_target_info_t)));
+            response, &pos, 2, target_info, sizeof(sgx_target_info_t)));
 
         /* Unpack epid_group_id */
         OE_CHECK(_unpack_length_delimited(
-            &response, &pos, 3, epid_group_id, sizeof(sgx_epid_group_id_t)));
+            response, &pos, 3, epid_group_id, sizeof(sgx_epid_group_id_t)));
     }
 
     result = OE_OK;
 
 done:
-    mem_free(&request);
-    mem_free(&response);
-
     return result;
 }
 
@@ -620,8 +808,8 @@ oe_result_t aesm_get_quote(
     size_t quote_size)
 {
     uint64_t timeout = 15000;
-    mem_t request = MEM_DYNAMIC_INIT;
-    mem_t response = MEM_DYNAMIC_INIT;
+    mem_t* request = NULL;
+    mem_t* response = NULL;
     oe_result_t result = OE_UNEXPECTED;
 
     /* Zero initialize the quote */
@@ -632,47 +820,48 @@ oe_result_t aesm_get_quote(
     if (!_aesm_valid(aesm) || !report || !spid || !quote || !quote_size)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    request = &aesm->request;
+    response = &aesm->response;
+    mem_clear(request);
+
     /* Build the PAYLOAD */
     {
         /* Pack REPORT */
-        OE_CHECK(_pack_bytes(&request, 1, report, sizeof(sgx_report_t)));
+        OE_CHECK(_pack_bytes(request, 1, report, sizeof(sgx_report_t)));
 
         /* Pack QUOTE-TYPE */
-        OE_CHECK(_pack_var_int(&request, 2, quote_type));
+        OE_CHECK(_pack_var_int(request, 2, quote_type));
 
         /* Pack SPID */
-        OE_CHECK(_pack_bytes(&request, 3, spid, sizeof(sgx_spid_t)));
+        OE_CHECK(_pack_bytes(request, 3, spid, sizeof(sgx_spid_t)));
 
         /* Pack NONCE */
         if (nonce)
-            OE_CHECK(_pack_bytes(&request, 4, nonce, sizeof(sgx_nonce_t)));
+            OE_CHECK(_pack_bytes(request, 4, nonce, sizeof(sgx_nonce_t)));
 
         /* Pack SIGNATURE-REVOCATION-LIST */
         if (signature_revocation_list_size)
         {
             OE_CHECK(_pack_bytes(
-                &request,
+                request,
                 5,
                 signature_revocation_list,
                 signature_revocation_list_size));
         }
 
         /* Pack QUOTE-SIZE */
-        OE_CHECK(_pack_var_int(&request, 6, quote_size));
+        OE_CHECK(_pack_var_int(request, 6, quote_size));
 
         /* Pack boolean indicating whether REPORT-OUT is present */
         if (report_out)
-            OE_CHECK(_pack_var_int(&request, 7, 1));
+            OE_CHECK(_pack_var_int(request, 7, 1));
 
         /* Pack TIMEOUT */
-        OE_CHECK(_pack_var_int(&request, 9, timeout));
+        OE_CHECK(_pack_var_int(request, 9, timeout));
     }
 
-    /* Send the request to the AESM service */
-    OE_CHECK(_write_request(aesm, MESSAGE_TYPE_GET_QUOTE, &request));
-
-    /* Receive the response from AESM service */
-    OE_CHECK(_read_response(aesm, MESSAGE_TYPE_GET_QUOTE, &response));
+    /* Send the request and receive the response from the AESM service */
+    OE_CHECK(_transact(aesm, MESSAGE_TYPE_GET_QUOTE));
 
     /* Unpack the response */
     {
@@ -681,7 +870,7 @@ oe_result_t aesm_get_quote(
         /* Unpack the error code */
         {
             uint32_t errcode;
-            OE_CHECK(_unpack_var_int(&response, &pos, 1, &errcode));
+            OE_CHECK(_unpack_var_int(response, &pos, 1, &errcode));
 
             if (errcode != 0)
                 OE_RAISE_MSG(OE_FAILURE, "errcode=0x%x", errcode);
@@ -689,13 +878,13 @@ oe_result_t aesm_get_quote(
 
         /* Unpack quote */
         OE_CHECK(
-            _unpack_length_delimited(&response, &pos, 2, quote, quote_size));
+            _unpack_length_delimited(response, &pos, 2, quote, quote_size));
 
         /* Unpack optional report_out */
         if (report_out)
         {
             OE_CHECK(_unpack_length_delimited(
-                &response, &pos, 3, report_out, sizeof(sgx_report_t)));
+                response, &pos, 3, report_out, sizeof(sgx_report_t)));
         }
     }
 
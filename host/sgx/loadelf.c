@@ -24,16 +24,110 @@
 #include "enclave.h"
 #include "sgxload.h"
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/* Allocate the zero-filled, page-aligned memory of an image. On Linux, the
+ * memory is an anonymous mapping, so pages take no memory until written. */
+static char* _alloc_image(size_t size)
+{
+#if defined(__linux__)
+    void* base = mmap(
+        NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    return base == MAP_FAILED ? NULL : (char*)base;
+#else
+    char* base = (char*)oe_memalign(OE_PAGE_SIZE, size);
+
+    if (base)
+        memset(base, 0, size);
+
+    return base;
+#endif
+}
+
+static void _free_image(char* base, size_t size)
+{
+#if defined(__linux__)
+    munmap(base, size);
+#else
+    OE_UNUSED(size);
+    oe_memalign_free(base);
+#endif
+}
+
+/* Copy the file data of a segment into the image. On Linux, when the file
+ * is mapped and the segment lies at the same offset within a page in the
+ * file and in the image (as linkers lay segments out), the pages of the
+ * segment are mapped copy-on-write from the file instead. They are then only
+ * read when added to the enclave, and only the pages written by _patch() or
+ * below take memory of their own. */
+static oe_result_t _load_segment(
+    const elf64_t* elf,
+    char* image_base,
+    size_t image_size,
+    const oe_elf_segment_t* seg,
+    const void* segdata)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    uint64_t end;
+
+    if (oe_safe_add_u64(seg->offset, seg->filesz, &end) != OE_OK ||
+        end > elf->size)
+        OE_RAISE(OE_OUT_OF_BOUNDS);
+
+    if (oe_safe_add_u64(seg->vaddr, seg->filesz, &end) != OE_OK ||
+        end > image_size)
+        OE_RAISE(OE_OUT_OF_BOUNDS);
+
+#if defined(__linux__)
+    if (elf->mapped_size && seg->filesz &&
+        (seg->offset & (OE_PAGE_SIZE - 1)) == (seg->vaddr & (OE_PAGE_SIZE - 1)))
+    {
+        uint64_t start = oe_round_down_to_page_size(seg->vaddr);
+        uint64_t size = oe_round_up_to_page_size(end) - start;
+        void* addr = mmap(
+            image_base + start,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_FIXED,
+            elf->fd,
+            (off_t)oe_round_down_to_page_size(seg->offset));
+
+        if (addr == MAP_FAILED)
+            OE_RAISE_MSG(OE_FAILURE, "mmap() failed: errno=%d", errno);
+
+        /* Clear the bytes of the file that share the first and last pages
+         * with the segment, as the memory outside segments must be zero */
+        if (seg->vaddr > start)
+            memset(image_base + start, 0, seg->vaddr - start);
+
+        if (start + size > end)
+            memset(image_base + end, 0, start + size - end);
+
+        result = OE_OK;
+        goto done;
+    }
+#endif
+
+    memcpy(image_base + seg->vaddr, segdata, seg->filesz);
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 static oe_result_t _oe_free_elf_image(oe_enclave_image_t* image)
 {
     if (image->u.elf.elf.data)
     {
-        free(image->u.elf.elf.data);
+        elf64_unload(&image->u.elf.elf);
     }
 
     if (image->image_base)
     {
-        oe_memalign_free(image->image_base);
+        _free_image(image->image_base, image->image_size);
     }
 
     if (image->u.elf.segments)
@@ -250,16 +344,13 @@ static oe_result_t _oe_load_elf_image(
         OE_RAISE(OE_OUT_OF_MEMORY);
     }
 
-    /* Allocate image on a page boundary */
-    image->image_base = (char*)oe_memalign(OE_PAGE_SIZE, image->image_size);
+    /* Allocate the zero-filled image on a page boundary */
+    image->image_base = _alloc_image(image->image_size);
     if (!image->image_base)
     {
         OE_RAISE(OE_OUT_OF_MEMORY);
     }
 
-    /* Clear the image memory */
-    memset(image->image_base, 0, image->image_size);
-
     /* Add all loadable program segments to SEGMENTS array */
     for (i = 0, num_segments = 0; i < eh->e_phnum; i++)
     {
@@ -352,7 +443,12 @@ static oe_result_t _oe_load_elf_image(
         if (segdata)
         {
             /* copy the segment to image */
-            memcpy(image->image_base + seg->vaddr, segdata, seg->filesz);
+            OE_CHECK(_load_segment(
+                &image->u.elf.elf,
+                image->image_base,
+                image->image_size,
+                seg,
+                segdata));
         }
 
         num_segments++;
@@ -498,20 +594,14 @@ static oe_result_t _add_relocation_pages(
 
     if (reloc_data && reloc_size)
     {
-        const oe_page_t* pages = (const oe_page_t*)reloc_data;
-        size_t npages = reloc_size / sizeof(oe_page_t);
-
-        for (size_t i = 0; i < npages; i++)
-        {
-            uint64_t addr = enclave_addr + *vaddr;
-            uint64_t src = (uint64_t)&pages[i];
-            uint64_t flags = SGX_SECINFO_REG | SGX_SECINFO_R;
-            bool extend = true;
-
-            OE_CHECK(oe_sgx_load_enclave_data(
-                context, enclave_addr, addr, src, flags, extend));
-            (*vaddr) += sizeof(oe_page_t);
-        }
+        uint64_t addr = enclave_addr + *vaddr;
+        uint64_t src = (uint64_t)reloc_data;
+        uint64_t flags = SGX_SECINFO_REG | SGX_SECINFO_R;
+        bool extend = true;
+
+        OE_CHECK(oe_sgx_load_enclave_data_pages(
+            context, enclave_addr, addr, src, reloc_size, flags, extend));
+        (*vaddr) += reloc_size;
     }
 
     result = OE_OK;
@@ -549,13 +639,15 @@ static oe_result_t _add_segment_pages(
 
     flags |= SGX_SECINFO_REG;
 
-    for (; page_rva < segment_end; page_rva += OE_PAGE_SIZE)
+    /* Add all pages of the segment as a single run */
+    if (page_rva < segment_end)
     {
-        OE_CHECK(oe_sgx_load_enclave_data(
+        OE_CHECK(oe_sgx_load_enclave_data_pages(
             context,
             enclave_addr,
             enclave_addr + page_rva,
             (uint64_t)image + page_rva,
+            oe_round_up_to_page_size(segment_end) - page_rva,
             flags,
             true));
     }
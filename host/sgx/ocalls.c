@@ -29,6 +29,7 @@
 #include "ocalls.h"
 #include "quote.h"
 #include "sgxquoteprovider.h"
+#include "symbolizer.h"
 
 void HandleMalloc(uint64_t arg_in, uint64_t* arg_out)
 {
@@ -135,6 +136,39 @@ void HandleGetQuote(uint64_t arg_in)
         sgx_get_quote(&args->sgx_report, args->quote, &args->quote_size);
 }
 
+void HandleGetQuoteV2(uint64_t arg_in)
+{
+    oe_get_quote_v2_args_t* args = (oe_get_quote_v2_args_t*)arg_in;
+    uint8_t* quote = NULL;
+    size_t quote_size = 0;
+
+    if (!args)
+        return;
+
+    args->quote = NULL;
+    args->quote_size = 0;
+
+    if ((args->result = sgx_get_quote_size(&quote_size)) != OE_OK)
+        return;
+
+    if (!(quote = (uint8_t*)malloc(quote_size)))
+    {
+        args->result = OE_OUT_OF_MEMORY;
+        return;
+    }
+
+    args->result = sgx_get_quote(&args->sgx_report, quote, &quote_size);
+
+    if (args->result == OE_OK)
+    {
+        // Freed by the enclave with oe_host_free().
+        args->quote = quote;
+        args->quote_size = quote_size;
+    }
+    else
+        free(quote);
+}
+
 #ifdef OE_USE_LIBSGX
 
 void HandleGetQuoteRevocationInfo(uint64_t arg_in)
@@ -168,6 +202,29 @@ void HandleGetQETargetInfo(uint64_t arg_in)
     args->result = sgx_get_qetarget_info(&args->target_info);
 }
 
+#if defined(__linux__)
+
+/* Get the symbolizer of the enclave, building it on first use. Return NULL
+ * if the image could not be read, without trying again on later calls. */
+static const oe_symbolizer_t* _get_symbolizer(oe_enclave_t* enclave)
+{
+    const oe_symbolizer_t* symbolizer;
+
+    oe_mutex_lock(&enclave->lock);
+    {
+        if (!enclave->symbolizer && !enclave->symbolizer_failed &&
+            oe_symbolizer_create(enclave->path, &enclave->symbolizer) != OE_OK)
+            enclave->symbolizer_failed = true;
+
+        symbolizer = enclave->symbolizer;
+    }
+    oe_mutex_unlock(&enclave->lock);
+
+    return symbolizer;
+}
+
+#endif /* defined(__linux__) */
+
 static char** _backtrace_symbols(
     oe_enclave_t* enclave,
     void* const* buffer,
@@ -177,21 +234,32 @@ static char** _backtrace_symbols(
 
 #if defined(__linux__)
 
-    elf64_t elf = ELF64_INIT;
-    bool elf_loaded = false;
+    const oe_symbolizer_t* symbolizer;
+    uint64_t vaddrs[OE_BACKTRACE_MAX];
+    const char* names[OE_BACKTRACE_MAX];
     size_t malloc_size = 0;
     const char unknown[] = "<unknown>";
     char* ptr = NULL;
 
-    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !buffer || !size)
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !buffer || size <= 0 ||
+        size > OE_BACKTRACE_MAX)
         goto done;
 
-    /* Open the enclave ELF64 image */
+    /* Look up the names of all the frames, which are all unknown without a
+     * symbolizer */
+    symbolizer = _get_symbolizer(enclave);
+
     {
-        if (elf64_load(enclave->path, &elf) != 0)
-            goto done;
+        for (int i = 0; i < size; i++)
+            vaddrs[i] = (uint64_t)buffer[i] - enclave->addr;
 
-        elf_loaded = true;
+        oe_symbolizer_lookup_batch(symbolizer, vaddrs, (size_t)size, names);
+
+        for (int i = 0; i < size; i++)
+        {
+            if (!names[i])
+                names[i] = unknown;
+        }
     }
 
     /* Determine total memory requirements */
@@ -204,14 +272,8 @@ static char** _backtrace_symbols(
         /* Calculate space for each string */
         for (int i = 0; i < size; i++)
         {
-            const uint64_t vaddr = (uint64_t)buffer[i] - enclave->addr;
-            const char* name = elf64_get_function_name(&elf, vaddr);
-
-            if (!name)
-                name = unknown;
-
-            if (oe_safe_add_sizet(malloc_size, strlen(name), &malloc_size) !=
-                OE_OK)
+            if (oe_safe_add_sizet(
+                    malloc_size, strlen(names[i]), &malloc_size) != OE_OK)
                 goto done;
 
             if (oe_safe_add_sizet(malloc_size, sizeof(char), &malloc_size) !=
@@ -233,23 +295,14 @@ static char** _backtrace_symbols(
     /* Copy strings into return buffer */
     for (int i = 0; i < size; i++)
     {
-        const uint64_t vaddr = (uint64_t)buffer[i] - enclave->addr;
-        const char* name = elf64_get_function_name(&elf, vaddr);
-
-        if (!name)
-            name = unknown;
-
-        size_t name_size = strlen(name) + sizeof(char);
-        oe_memcpy_s(ptr, name_size, name, name_size);
+        size_t name_size = strlen(names[i]) + sizeof(char);
+        oe_memcpy_s(ptr, name_size, names[i], name_size);
         ret[i] = ptr;
         ptr += name_size;
     }
 
 done:
 
-    if (elf_loaded)
-        elf64_unload(&elf);
-
 #endif /* defined(__linux__) */
 
     return ret;
@@ -268,9 +321,40 @@ void oe_handle_backtrace_symbols(oe_enclave_t* enclave, uint64_t arg)
 void oe_handle_log(oe_enclave_t* enclave, uint64_t arg)
 {
     oe_log_args_t* args = (oe_log_args_t*)arg;
-    OE_UNUSED(enclave);
     if (args)
     {
+        /* Keep the order of the records the enclave wrote to its ring */
+        oe_drain_log_ring(enclave);
         log_message(true, args);
     }
 }
+
+void oe_handle_grow_ocall_arena(
+    oe_enclave_t* enclave,
+    void* tcs,
+    uint64_t arg_in,
+    uint64_t* arg_out)
+{
+    size_t index;
+    void* arena;
+
+    if (!arg_out || !arg_in || arg_in > OE_OCALL_ARENA_MAX_SIZE ||
+        !enclave->grown_ocall_arenas)
+        return;
+
+    for (index = 0; index < enclave->num_bindings; index++)
+    {
+        if (enclave->bindings[index].tcs == (uint64_t)tcs)
+            break;
+    }
+
+    if (index == enclave->num_bindings || !(arena = malloc(arg_in)))
+        return;
+
+    /* Only the thread on this TCS uses the slot, and the enclave asks for a
+     * new arena only when nothing is left in the old one */
+    free(enclave->grown_ocall_arenas[index]);
+    enclave->grown_ocall_arenas[index] = arena;
+
+    *arg_out = (uint64_t)arena;
+}
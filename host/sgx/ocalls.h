@@ -15,6 +15,7 @@ void HandleThreadWake(oe_enclave_t* enclave, uint64_t arg);
 void HandleThreadWakeWait(oe_enclave_t* enclave, uint64_t arg_in);
 
 void HandleGetQuote(uint64_t arg_in);
+void HandleGetQuoteV2(uint64_t arg_in);
 void HandleGetQETargetInfo(uint64_t arg_in);
 void HandleGetQuoteRevocationInfo(uint64_t arg_in);
 void HandleGetQuoteEnclaveIdentityInfo(uint64_t arg_in);
@@ -22,4 +23,17 @@ void HandleGetQuoteEnclaveIdentityInfo(uint64_t arg_in);
 void oe_handle_backtrace_symbols(oe_enclave_t* enclave, uint64_t arg);
 void oe_handle_log(oe_enclave_t* enclave, uint64_t arg);
 
+oe_result_t oe_handle_call_host_function(uint64_t arg, oe_enclave_t* enclave);
+oe_result_t oe_dispatch_call_host_function(
+    uint64_t arg,
+    oe_enclave_t* enclave);
+void oe_handle_wake_host_worker(oe_enclave_t* enclave, uint64_t arg_in);
+void oe_handle_wait_enclave_worker(oe_enclave_t* enclave, uint64_t arg_in);
+void oe_handle_start_shared_clock(oe_enclave_t* enclave, uint64_t* arg_out);
+void oe_handle_grow_ocall_arena(
+    oe_enclave_t* enclave,
+    void* tcs,
+    uint64_t arg_in,
+    uint64_t* arg_out);
+
 #endif /* _OE_HOST_SGX_OCALLS_H */
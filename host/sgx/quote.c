@@ -26,7 +26,7 @@ static oe_result_t _sgx_init_quote_with_aesm(sgx_target_info_t* target_info)
 
     aesm_t* aesm = NULL;
 
-    if (!(aesm = aesm_connect()))
+    if (!(aesm = aesm_acquire()))
         OE_RAISE(OE_FAILURE);
 
     OE_CHECK(aesm_init_quote(aesm, target_info, &epid_group_id));
@@ -36,7 +36,7 @@ static oe_result_t _sgx_init_quote_with_aesm(sgx_target_info_t* target_info)
 done:
 
     if (aesm)
-        aesm_disconnect(aesm);
+        aesm_release(aesm);
 
     return result;
 }
@@ -114,7 +114,7 @@ static oe_result_t _sgx_get_quote_from_aesm(
     if (!report || !quote || !quote_size)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    if (!(aesm = aesm_connect()))
+    if (!(aesm = aesm_acquire()))
         OE_RAISE(OE_SERVICE_UNAVAILABLE);
 
     OE_CHECK(aesm_get_quote(
@@ -134,7 +134,7 @@ static oe_result_t _sgx_get_quote_from_aesm(
 done:
 
     if (aesm)
-        aesm_disconnect(aesm);
+        aesm_release(aesm);
 
     return result;
 }
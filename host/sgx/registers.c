@@ -3,6 +3,7 @@
 
 #if defined(__linux__)
 #include <asm/prctl.h>
+#include <sys/auxv.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 #elif defined(_WIN32)
@@ -10,14 +11,52 @@
 #endif
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 #include <openenclave/internal/registers.h>
 
+/*
+**==============================================================================
+**
+** FSGSBASE
+**
+**     Simulation mode switches the FS and GS bases on every ECALL and OCALL.
+**     When the kernel has enabled the FSGSBASE instructions (Linux 5.9 and
+**     later, advertised by HWCAP2_FSGSBASE), the bases are read and written
+**     with RDFSBASE/WRFSBASE/RDGSBASE/WRGSBASE instead of an arch_prctl()
+**     system call each. The kernel preserves the bases written this way
+**     across context switches.
+**
+**     Support is detected by a constructor, before any thread can have
+**     switched its FS base to an enclave (which would break the libc calls
+**     made by the detection).
+**
+**==============================================================================
+*/
+
+#if defined(__linux__)
+
+#ifndef HWCAP2_FSGSBASE
+#define HWCAP2_FSGSBASE (1 << 1)
+#endif
+
+static bool _have_fsgsbase;
+
+__attribute__((constructor)) static void _detect_fsgsbase(void)
+{
+    _have_fsgsbase = (getauxval(AT_HWCAP2) & HWCAP2_FSGSBASE) != 0;
+}
+
+#endif /* defined(__linux__) */
+
 void oe_set_gs_register_base(const void* ptr)
 {
 #if defined(__linux__)
-    syscall(__NR_arch_prctl, ARCH_SET_GS, ptr);
+    if (_have_fsgsbase)
+        asm volatile("wrgsbase %0" : : "r"(ptr) : "memory");
+    else
+        syscall(__NR_arch_prctl, ARCH_SET_GS, ptr);
 #elif defined(_WIN32)
     _writegsbase_u64((uint64_t)ptr);
 #endif
@@ -27,7 +66,10 @@ void* oe_get_gs_register_base()
 {
 #if defined(__linux__)
     void* ptr = NULL;
-    syscall(__NR_arch_prctl, ARCH_GET_GS, &ptr);
+    if (_have_fsgsbase)
+        asm volatile("rdgsbase %0" : "=r"(ptr));
+    else
+        syscall(__NR_arch_prctl, ARCH_GET_GS, &ptr);
     return ptr;
 #elif defined(_WIN32)
     return (void*)_readgsbase_u64();
@@ -37,7 +79,10 @@ void* oe_get_gs_register_base()
 void oe_set_fs_register_base(const void* ptr)
 {
 #if defined(__linux__)
-    syscall(__NR_arch_prctl, ARCH_SET_FS, ptr);
+    if (_have_fsgsbase)
+        asm volatile("wrfsbase %0" : : "r"(ptr) : "memory");
+    else
+        syscall(__NR_arch_prctl, ARCH_SET_FS, ptr);
 #elif defined(_WIN32)
     _writefsbase_u64((uint64_t)ptr);
 #endif
@@ -47,7 +92,10 @@ void* oe_get_fs_register_base()
 {
 #if defined(__linux__)
     void* ptr = NULL;
-    syscall(__NR_arch_prctl, ARCH_GET_FS, &ptr);
+    if (_have_fsgsbase)
+        asm volatile("rdfsbase %0" : "=r"(ptr));
+    else
+        syscall(__NR_arch_prctl, ARCH_GET_FS, &ptr);
     return ptr;
 #elif defined(_WIN32)
     return (void*)_readfsbase_u64();
@@ -375,7 +375,7 @@ static oe_result_t _get_launch_token(
     memset(launch_token, 0, sizeof(sgx_launch_token_t));
 
     /* Obtain a launch token from the AESM service */
-    if (!(aesm = aesm_connect()))
+    if (!(aesm = aesm_acquire()))
         OE_RAISE(OE_FAILURE);
 
     OE_CHECK(aesm_get_launch_token(
@@ -390,7 +390,7 @@ static oe_result_t _get_launch_token(
 done:
 
     if (aesm)
-        aesm_disconnect(aesm);
+        aesm_release(aesm);
 
     return result;
 }
@@ -674,17 +674,43 @@ static void _dump_load_enclave_data(
 
 #endif /* defined(OE_TRACE_MEASURE) */
 
-oe_result_t oe_sgx_load_enclave_data(
+/*
+**==============================================================================
+**
+** _load_enclave_pages()
+**
+**     Add a run of npages pages with identical flags starting at addr. The
+**     source of each page is src_stride bytes past the previous one, or src
+**     itself for every page when src_stride is zero, in which case src is a
+**     page filled with filler. The run is measured with one call and, where
+**     the platform allows it, added with one call:
+**
+**         (*) simulation - one copy and one mprotect/VirtualProtect per run;
+**             filler pages of zeros are not copied at all since the enclave
+**             memory was freshly mapped (and hence zero-filled)
+**         (*) libsgx/Windows - one enclave_load_data/LoadEnclaveData per run
+**             of distinct pages
+**         (*) Linux SGX driver - one ioctl per page (the driver adds a single
+**             page per request)
+**
+**==============================================================================
+*/
+
+static oe_result_t _load_enclave_pages(
     oe_sgx_load_context_t* context,
     uint64_t base,
     uint64_t addr,
     uint64_t src,
+    size_t npages,
+    size_t src_stride,
+    uint32_t filler,
     uint64_t flags,
     bool extend)
 {
     oe_result_t result = OE_UNEXPECTED;
+    uint64_t size;
 
-    if (!context || !base || !addr || !src || !flags)
+    if (!context || !base || !addr || !src || !flags || !npages)
         OE_RAISE(OE_INVALID_PARAMETER);
 
     if (context->state != OE_SGX_LOAD_STATE_ENCLAVE_CREATED)
@@ -694,15 +720,48 @@ oe_result_t oe_sgx_load_enclave_data(
     if (addr % OE_PAGE_SIZE)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    if (src_stride != 0 && src_stride != OE_PAGE_SIZE)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(oe_safe_mul_u64(npages, OE_PAGE_SIZE, &size));
+
+    if (addr + size < addr)
+        OE_RAISE(OE_INTEGER_OVERFLOW);
+
 #if defined(OE_TRACE_MEASURE)
 
-    _dump_load_enclave_data(addr - base, flags, src, extend);
+    for (size_t i = 0; i < npages; i++)
+    {
+        _dump_load_enclave_data(
+            addr + i * OE_PAGE_SIZE - base,
+            flags,
+            src + i * src_stride,
+            extend);
+    }
 
 #endif /* defined(OE_TRACE_MEASURE) */
 
-    /* Measure this operation */
-    OE_CHECK(oe_sgx_measure_load_enclave_data(
-        &context->hash_context, base, addr, src, flags, extend));
+    /* Measure this operation, unless the measurement is already known */
+    if (context->mrenclave)
+    {
+        /* The pages are the same as when the measurement was taken */
+    }
+    else if (src_stride)
+    {
+        OE_CHECK(oe_sgx_measure_load_enclave_pages(
+            &context->hash_context, base, addr, src, npages, flags, extend));
+    }
+    else
+    {
+        OE_CHECK(oe_sgx_measure_load_enclave_filled_pages(
+            &context->hash_context,
+            base,
+            addr,
+            npages,
+            filler,
+            flags,
+            extend));
+    }
 
     if (context->type == OE_SGX_LOAD_TYPE_MEASURE)
     {
@@ -713,16 +772,30 @@ oe_result_t oe_sgx_load_enclave_data(
     else if (oe_sgx_is_simulation_load_context(context))
     {
         /* Simulate enclave add page */
-        /* Verify that page is within enclave boundaries */
+        /* Verify that the pages are within enclave boundaries */
         if ((void*)addr < context->sim.addr ||
-            (uint8_t*)addr >
-                (uint8_t*)context->sim.addr + context->sim.size - OE_PAGE_SIZE)
+            (uint8_t*)addr + size >
+                (uint8_t*)context->sim.addr + context->sim.size)
             OE_RAISE_MSG(
                 OE_FAILURE, "Page is NOT within enclave boundaries", NULL);
 
         /* Copy page contents onto memory-mapped region */
-        OE_CHECK(oe_memcpy_s(
-            (uint8_t*)addr, OE_PAGE_SIZE, (uint8_t*)src, OE_PAGE_SIZE));
+        if (src_stride)
+        {
+            OE_CHECK(
+                oe_memcpy_s((uint8_t*)addr, size, (uint8_t*)src, (size_t)size));
+        }
+        else if (filler != OE_SGX_ZERO_PAGE_FILLER)
+        {
+            for (size_t i = 0; i < npages; i++)
+            {
+                OE_CHECK(oe_memcpy_s(
+                    (uint8_t*)addr + i * OE_PAGE_SIZE,
+                    OE_PAGE_SIZE,
+                    (uint8_t*)src,
+                    OE_PAGE_SIZE));
+            }
+        }
 
         /* Set page access permissions */
         {
@@ -733,81 +806,107 @@ oe_result_t oe_sgx_load_enclave_data(
                     OE_FAILURE, "Unexpected page protections: %#x", prot);
 
 #if defined(__linux__)
-            if (mprotect((void*)addr, OE_PAGE_SIZE, prot) != 0)
+            if (mprotect((void*)addr, size, prot) != 0)
                 OE_RAISE_MSG(
                     OE_FAILURE,
-                    "mprotect failed (addr=%#x, prot=%#x)",
+                    "mprotect failed (addr=%#x, size=%#x, prot=%#x)",
                     addr,
+                    size,
                     prot);
 #elif defined(_WIN32)
             DWORD old;
-            if (!VirtualProtect((LPVOID)addr, OE_PAGE_SIZE, prot, &old))
+            if (!VirtualProtect((LPVOID)addr, size, prot, &old))
                 OE_RAISE_MSG(
                     OE_FAILURE,
-                    "VirtualProtect failed (addr=%#x, prot=%#x)",
+                    "VirtualProtect failed (addr=%#x, size=%#x, prot=%#x)",
                     addr,
+                    size,
                     prot);
 #endif
         }
     }
     else
     {
+        /* Distinct source pages go in one request, filler pages in one
+         * request per page */
+        const size_t nrequests = src_stride ? 1 : npages;
+        const uint64_t request_size = src_stride ? size : OE_PAGE_SIZE;
+
 #if defined(OE_USE_LIBSGX)
 
         int protect = _make_memory_protect_param(flags, false /*not simulate*/);
         if (!extend)
             protect |= ENCLAVE_PAGE_UNVALIDATED;
 
-        uint32_t enclave_error;
-        if (enclave_load_data(
-                (void*)addr,
-                OE_PAGE_SIZE,
-                (const void*)src,
-                (uint32_t)protect,
-                &enclave_error) != OE_PAGE_SIZE)
-            OE_RAISE_MSG(
-                OE_PLATFORM_ERROR,
-                "enclave_load_data failed (addr=%#x, prot=%#x, err=%#x)",
-                addr,
-                protect,
-                enclave_error);
+        for (size_t i = 0; i < nrequests; i++)
+        {
+            uint64_t request_addr = addr + i * request_size;
+            uint32_t enclave_error;
+
+            if (enclave_load_data(
+                    (void*)request_addr,
+                    request_size,
+                    (const void*)src,
+                    (uint32_t)protect,
+                    &enclave_error) != request_size)
+                OE_RAISE_MSG(
+                    OE_PLATFORM_ERROR,
+                    "enclave_load_data failed (addr=%#x, prot=%#x, err=%#x)",
+                    request_addr,
+                    protect,
+                    enclave_error);
+        }
 
 #elif defined(__linux__)
 
-        /* Ask the Linux SGX driver to add a page to the enclave
+        OE_UNUSED(nrequests);
+        OE_UNUSED(request_size);
+
+        /* Ask the Linux SGX driver to add each page to the enclave
            sgxioctl internally traces any driver returned error */
-        if (sgx_ioctl_enclave_add_page(
-                context->dev, addr, src, flags, extend) != 0)
-            OE_RAISE(OE_IOCTL_FAILED);
+        for (size_t i = 0; i < npages; i++)
+        {
+            if (sgx_ioctl_enclave_add_page(
+                    context->dev,
+                    addr + i * OE_PAGE_SIZE,
+                    src + i * src_stride,
+                    flags,
+                    extend) != 0)
+                OE_RAISE(OE_IOCTL_FAILED);
+        }
 
 #elif defined(_WIN32)
 
-        /* Ask the OS to add a page to the enclave */
-        SIZE_T num_bytes = 0;
-        DWORD enclave_error;
-
+        /* Ask the OS to add the pages to the enclave */
         DWORD protect =
             _make_memory_protect_param(flags, false /*not simulate*/);
         if (!extend)
             protect |= PAGE_ENCLAVE_UNVALIDATED;
 
-        if (!LoadEnclaveData(
-                GetCurrentProcess(),
-                (LPVOID)addr,
-                (LPCVOID)src,
-                OE_PAGE_SIZE,
-                protect,
-                NULL,
-                0,
-                &num_bytes,
-                &enclave_error))
+        for (size_t i = 0; i < nrequests; i++)
         {
-            OE_RAISE_MSG(
-                OE_PLATFORM_ERROR,
-                "LoadEnclaveData failed (addr=%#x, prot=%#x, err=%#x)",
-                addr,
-                protect,
-                enclave_error);
+            uint64_t request_addr = addr + i * request_size;
+            SIZE_T num_bytes = 0;
+            DWORD enclave_error;
+
+            if (!LoadEnclaveData(
+                    GetCurrentProcess(),
+                    (LPVOID)request_addr,
+                    (LPCVOID)src,
+                    request_size,
+                    protect,
+                    NULL,
+                    0,
+                    &num_bytes,
+                    &enclave_error))
+            {
+                OE_RAISE_MSG(
+                    OE_PLATFORM_ERROR,
+                    "LoadEnclaveData failed (addr=%#x, prot=%#x, err=%#x)",
+                    request_addr,
+                    protect,
+                    enclave_error);
+            }
         }
 
 #endif
@@ -819,6 +918,91 @@ done:
     return result;
 }
 
+oe_result_t oe_sgx_load_enclave_data(
+    oe_sgx_load_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    uint64_t flags,
+    bool extend)
+{
+    return _load_enclave_pages(
+        context, base, addr, src, 1, OE_PAGE_SIZE, 0, flags, extend);
+}
+
+oe_result_t oe_sgx_load_enclave_data_pages(
+    oe_sgx_load_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    size_t size,
+    uint64_t flags,
+    bool extend)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    /* SIZE must be a non-zero multiple of the page size */
+    if (!size || size % OE_PAGE_SIZE)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(_load_enclave_pages(
+        context,
+        base,
+        addr,
+        src,
+        size / OE_PAGE_SIZE,
+        OE_PAGE_SIZE,
+        0,
+        flags,
+        extend));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_sgx_load_enclave_filled_pages(
+    oe_sgx_load_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    size_t npages,
+    uint32_t filler,
+    uint64_t flags,
+    bool extend)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_page_t page;
+
+    /* Fill or clear the page */
+    if (filler)
+    {
+        size_t n = OE_PAGE_SIZE / sizeof(uint32_t);
+        uint32_t* p = (uint32_t*)&page;
+
+        while (n--)
+            *p++ = filler;
+    }
+    else
+        memset(&page, 0, sizeof(page));
+
+    OE_CHECK(_load_enclave_pages(
+        context,
+        base,
+        addr,
+        (uint64_t)&page,
+        npages,
+        0,
+        filler,
+        flags,
+        extend));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 oe_result_t oe_sgx_initialize_enclave(
     oe_sgx_load_context_t* context,
     uint64_t addr,
@@ -836,10 +1020,20 @@ oe_result_t oe_sgx_initialize_enclave(
     if (context->state != OE_SGX_LOAD_STATE_ENCLAVE_CREATED)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    /* Measure this operation */
+    /* Measure this operation (this also releases the hash context) */
     OE_CHECK(
         oe_sgx_measure_initialize_enclave(&context->hash_context, mrenclave));
 
+    /* The pages were not measured if the measurement is already known */
+    if (context->mrenclave)
+    {
+        OE_CHECK(oe_memcpy_s(
+            mrenclave,
+            sizeof(OE_SHA256),
+            context->mrenclave,
+            sizeof(OE_SHA256)));
+    }
+
     /* EINIT has no further action in measurement/simulation mode */
     if (context->type == OE_SGX_LOAD_TYPE_CREATE &&
         !oe_sgx_is_simulation_load_context(context))
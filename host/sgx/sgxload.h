@@ -37,6 +37,26 @@ oe_result_t oe_sgx_load_enclave_data(
     uint64_t flags,
     bool extend);
 
+/* Add SIZE bytes of pages with the same flags from contiguous memory at SRC */
+oe_result_t oe_sgx_load_enclave_data_pages(
+    oe_sgx_load_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    size_t size,
+    uint64_t flags,
+    bool extend);
+
+/* Add NPAGES pages with the same flags, each filled with FILLER */
+oe_result_t oe_sgx_load_enclave_filled_pages(
+    oe_sgx_load_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    size_t npages,
+    uint32_t filler,
+    uint64_t flags,
+    bool extend);
+
 oe_result_t oe_sgx_initialize_enclave(
     oe_sgx_load_context_t* context,
     uint64_t addr,
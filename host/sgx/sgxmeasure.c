@@ -3,9 +3,12 @@
 
 #include "sgxmeasure.h"
 #include <openenclave/host.h>
+#include <openenclave/internal/defs.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/sgxtypes.h>
 #include <openenclave/internal/trace.h>
+#include <string.h>
+#include "../hostthread.h"
 
 static void _measure_zeros(oe_sha256_context_t* context, size_t size)
 {
@@ -26,28 +29,6 @@ static void _measure_zeros(oe_sha256_context_t* context, size_t size)
     }
 }
 
-static void _measure_eextend(
-    oe_sha256_context_t* context,
-    uint64_t vaddr,
-    uint64_t flags,
-    const void* page)
-{
-    uint64_t pgoff = 0;
-    const uint64_t CHUNK_SIZE = 256;
-    OE_UNUSED(flags);
-
-    /* Write this page one chunk at a time */
-    for (pgoff = 0; pgoff < OE_PAGE_SIZE; pgoff += CHUNK_SIZE)
-    {
-        const uint64_t moffset = vaddr + pgoff;
-
-        oe_sha256_update(context, "EEXTEND", 8);
-        oe_sha256_update(context, &moffset, sizeof(moffset));
-        _measure_zeros(context, 48);
-        oe_sha256_update(context, (const uint8_t*)page + pgoff, CHUNK_SIZE);
-    }
-}
-
 oe_result_t oe_sgx_measure_create_enclave(
     oe_sha256_context_t* context,
     sgx_secs_t* secs)
@@ -79,22 +60,234 @@ oe_result_t oe_sgx_measure_load_enclave_data(
     uint64_t src,
     uint64_t flags,
     bool extend)
+{
+    return oe_sgx_measure_load_enclave_pages(
+        context, base, addr, src, 1, flags, extend);
+}
+
+/*
+**==============================================================================
+**
+** Measurement of page runs
+**
+**     The EADD (64 bytes) and EEXTEND (64 + 256 bytes) records of each page
+**     are laid out in a buffer and hashed with a single update, rather than
+**     with four updates per record. Unextended pages (the heap) contribute
+**     one EADD record each, so many of them are batched into one update.
+**
+**     The EEXTEND records of filler pages differ only in their offsets. The
+**     records of the known fillers (OE_SGX_ZERO_PAGE_FILLER for TCS, SSA and
+**     thread data pages, and OE_SGX_STACK_PAGE_FILLER for stacks) are built
+**     once per process and reused for every page of every enclave, patching
+**     only the offsets.
+**
+**==============================================================================
+*/
+
+#define _RECORD_SIZE 64
+#define _EEXTEND_CHUNK_SIZE 256
+#define _EEXTEND_RECORD_SIZE (_RECORD_SIZE + _EEXTEND_CHUNK_SIZE)
+#define _EEXTEND_RECORDS_PER_PAGE (OE_PAGE_SIZE / _EEXTEND_CHUNK_SIZE)
+#define _EEXTEND_RECORDS_SIZE (_EEXTEND_RECORDS_PER_PAGE * _EEXTEND_RECORD_SIZE)
+#define _PAGE_RECORDS_SIZE (_RECORD_SIZE + _EEXTEND_RECORDS_SIZE)
+#define _EADD_RECORDS_PER_UPDATE (_PAGE_RECORDS_SIZE / _RECORD_SIZE)
+
+typedef struct _filler_records
+{
+    uint32_t filler;
+    uint8_t records[_EEXTEND_RECORDS_SIZE];
+} filler_records_t;
+
+static filler_records_t _filler_records[] = {
+    {OE_SGX_ZERO_PAGE_FILLER, {0}},
+    {OE_SGX_STACK_PAGE_FILLER, {0}},
+};
+
+static oe_once_type _filler_records_once = OE_H_ONCE_INITIALIZER;
+
+static void _set_eadd_record(uint8_t* record, uint64_t vaddr, uint64_t flags)
+{
+    memcpy(record, "EADD\0\0\0", 8);
+    memcpy(record + 8, &vaddr, sizeof(vaddr));
+    memcpy(record + 16, &flags, sizeof(flags));
+}
+
+/* Set the offsets of the EEXTEND records of the page at vaddr */
+static void _set_eextend_offsets(uint8_t* records, uint64_t vaddr)
+{
+    for (size_t i = 0; i < _EEXTEND_RECORDS_PER_PAGE; i++)
+    {
+        const uint64_t moffset = vaddr + i * _EEXTEND_CHUNK_SIZE;
+
+        memcpy(records + i * _EEXTEND_RECORD_SIZE + 8, &moffset, 8);
+    }
+}
+
+/* Set the EEXTEND records of a page (at offset zero) with zeroed padding */
+static void _set_eextend_records(uint8_t* records, const uint8_t* page)
+{
+    memset(records, 0, _EEXTEND_RECORDS_SIZE);
+
+    for (size_t i = 0; i < _EEXTEND_RECORDS_PER_PAGE; i++)
+    {
+        uint8_t* record = records + i * _EEXTEND_RECORD_SIZE;
+
+        memcpy(record, "EEXTEND", 8);
+        memcpy(
+            record + _RECORD_SIZE,
+            page + i * _EEXTEND_CHUNK_SIZE,
+            _EEXTEND_CHUNK_SIZE);
+    }
+}
+
+static void _fill_page(oe_page_t* page, uint32_t filler)
+{
+    uint32_t* p = (uint32_t*)page;
+
+    for (size_t n = OE_PAGE_SIZE / sizeof(uint32_t); n; n--)
+        *p++ = filler;
+}
+
+static void _initialize_filler_records(void)
+{
+    oe_page_t page;
+
+    for (size_t i = 0; i < OE_COUNTOF(_filler_records); i++)
+    {
+        _fill_page(&page, _filler_records[i].filler);
+        _set_eextend_records(_filler_records[i].records, page.data);
+    }
+}
+
+/* Measure EADD only, several pages per update */
+static void _measure_eadd_pages(
+    oe_sha256_context_t* context,
+    uint64_t vaddr,
+    size_t npages,
+    uint64_t flags)
+{
+    uint8_t buffer[_EADD_RECORDS_PER_UPDATE * _RECORD_SIZE];
+
+    memset(buffer, 0, sizeof(buffer));
+
+    while (npages)
+    {
+        size_t n = npages;
+
+        if (n > _EADD_RECORDS_PER_UPDATE)
+            n = _EADD_RECORDS_PER_UPDATE;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            _set_eadd_record(buffer + i * _RECORD_SIZE, vaddr, flags);
+            vaddr += OE_PAGE_SIZE;
+        }
+
+        oe_sha256_update(context, buffer, n * _RECORD_SIZE);
+        npages -= n;
+    }
+}
+
+oe_result_t oe_sgx_measure_load_enclave_pages(
+    oe_sha256_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    size_t npages,
+    uint64_t flags,
+    bool extend)
 {
     oe_result_t result = OE_UNEXPECTED;
     uint64_t vaddr = addr - base;
+    uint8_t buffer[_PAGE_RECORDS_SIZE];
 
     if (!context || !base || !addr || !src || !flags || addr < base)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    /* Measure EADD */
-    oe_sha256_update(context, "EADD\0\0\0", 8);
-    oe_sha256_update(context, &vaddr, sizeof(vaddr));
-    oe_sha256_update(context, &flags, sizeof(flags));
-    _measure_zeros(context, 40);
+    if (!extend)
+    {
+        _measure_eadd_pages(context, vaddr, npages, flags);
+        result = OE_OK;
+        goto done;
+    }
 
-    /* Measure EEXTEND if requested */
-    if (extend)
-        _measure_eextend(context, vaddr, flags, (void*)src);
+    memset(buffer, 0, _RECORD_SIZE);
+
+    /* Measure EADD followed by the EEXTEND of each chunk */
+    for (size_t i = 0; i < npages; i++)
+    {
+        _set_eadd_record(buffer, vaddr, flags);
+        _set_eextend_records(
+            buffer + _RECORD_SIZE, (const uint8_t*)src + i * OE_PAGE_SIZE);
+        _set_eextend_offsets(buffer + _RECORD_SIZE, vaddr);
+        oe_sha256_update(context, buffer, _PAGE_RECORDS_SIZE);
+        vaddr += OE_PAGE_SIZE;
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_sgx_measure_load_enclave_filled_pages(
+    oe_sha256_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    size_t npages,
+    uint32_t filler,
+    uint64_t flags,
+    bool extend)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    uint64_t vaddr = addr - base;
+    uint8_t buffer[_PAGE_RECORDS_SIZE];
+    const uint8_t* records = NULL;
+
+    if (!context || !base || !addr || !flags || addr < base)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!extend)
+    {
+        _measure_eadd_pages(context, vaddr, npages, flags);
+        result = OE_OK;
+        goto done;
+    }
+
+    /* Use the precomputed records of a known filler */
+    oe_once(&_filler_records_once, _initialize_filler_records);
+
+    for (size_t i = 0; i < OE_COUNTOF(_filler_records); i++)
+    {
+        if (_filler_records[i].filler == filler)
+        {
+            records = _filler_records[i].records;
+            break;
+        }
+    }
+
+    memset(buffer, 0, _RECORD_SIZE);
+
+    if (records)
+    {
+        memcpy(buffer + _RECORD_SIZE, records, _EEXTEND_RECORDS_SIZE);
+    }
+    else
+    {
+        oe_page_t page;
+
+        _fill_page(&page, filler);
+        _set_eextend_records(buffer + _RECORD_SIZE, page.data);
+    }
+
+    /* Only the offsets differ from one page to the next */
+    for (size_t i = 0; i < npages; i++)
+    {
+        _set_eadd_record(buffer, vaddr, flags);
+        _set_eextend_offsets(buffer + _RECORD_SIZE, vaddr);
+        oe_sha256_update(context, buffer, _PAGE_RECORDS_SIZE);
+        vaddr += OE_PAGE_SIZE;
+    }
 
     result = OE_OK;
 
@@ -21,6 +21,31 @@ oe_result_t oe_sgx_measure_load_enclave_data(
     uint64_t flags,
     bool extend);
 
+/* Fillers of stack pages and of zeroed pages, whose EEXTEND records are
+ * precomputed by oe_sgx_measure_load_enclave_filled_pages() */
+#define OE_SGX_ZERO_PAGE_FILLER 0
+#define OE_SGX_STACK_PAGE_FILLER 0xcccccccc
+
+/* Measure npages pages with the given flags from contiguous memory at src */
+oe_result_t oe_sgx_measure_load_enclave_pages(
+    oe_sha256_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    size_t npages,
+    uint64_t flags,
+    bool extend);
+
+/* Measure npages pages with the given flags, each filled with filler */
+oe_result_t oe_sgx_measure_load_enclave_filled_pages(
+    oe_sha256_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    size_t npages,
+    uint32_t filler,
+    uint64_t flags,
+    bool extend);
+
 oe_result_t oe_sgx_measure_initialize_enclave(
     oe_sha256_context_t* context,
     OE_SHA256* mrenclave);
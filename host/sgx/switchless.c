@@ -0,0 +1,529 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <Windows.h>
+#endif
+
+#include <openenclave/host.h>
+#include <openenclave/internal/atomic.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/switchless.h>
+#include <openenclave/internal/utils.h>
+#include "enclave.h"
+#include "ocalls.h"
+
+/*
+**==============================================================================
+**
+** _worker_wait()
+**
+**     Park a worker until a call is posted to it or it is stopped. Used for
+**     host workers directly and for enclave workers on behalf of the
+**     OE_OCALL_WAIT_ENCLAVE_WORKER OCALL.
+**
+**==============================================================================
+*/
+
+static void _worker_wait(
+    oe_switchless_worker_t* worker,
+    void* volatile* call_arg)
+{
+    volatile uint32_t* event = &worker->event;
+
+    oe_atomic_exchange_u32(event, (uint32_t)-1);
+
+    /* A call may have been posted before the event was set */
+    while (*event == (uint32_t)-1 && !*call_arg && !worker->is_stopping)
+    {
+#if defined(__linux__)
+        syscall(
+            __NR_futex,
+            (uint32_t*)event,
+            FUTEX_WAIT_PRIVATE,
+            (uint32_t)-1,
+            NULL,
+            NULL,
+            0);
+#elif defined(_WIN32)
+        uint32_t parked = (uint32_t)-1;
+        WaitOnAddress(event, &parked, sizeof(parked), INFINITE);
+#endif
+    }
+
+    oe_atomic_exchange_u32(event, 0);
+}
+
+static void _worker_wake(volatile uint32_t* event)
+{
+    if (oe_atomic_exchange_u32(event, 0) == (uint32_t)-1)
+    {
+#if defined(__linux__)
+        syscall(
+            __NR_futex, (uint32_t*)event, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#elif defined(_WIN32)
+        WakeByAddressSingle((void*)event);
+#endif
+    }
+}
+
+/*
+**==============================================================================
+**
+** _switchless_ocall_worker()
+**
+**     The thread function of a host worker. Polls the call_arg slot of its
+**     context and dispatches the posted OCALL through the enclave's OCALL
+**     table. Clearing call_arg makes the worker available again.
+**
+**==============================================================================
+*/
+
+static void* _switchless_ocall_worker(void* arg)
+{
+    oe_host_worker_context_t* context = (oe_host_worker_context_t*)arg;
+    uint64_t spin_count = 0;
+
+    while (!context->worker.is_stopping)
+    {
+        oe_call_host_function_args_t* call_arg = context->call_arg;
+
+        if (call_arg)
+        {
+            oe_result_t result = oe_dispatch_call_host_function(
+                (uint64_t)call_arg, context->enclave);
+
+            context->total_call_count++;
+            context->total_spin_count += spin_count;
+            spin_count = 0;
+
+            /* Publishing the result completes the call: the enclave may then
+             * free call_arg and reuse its memory for the next call, so it
+             * must be the last access to call_arg, after the worker is made
+             * available again. The volatile stores are not reordered on
+             * x86. */
+            context->call_arg = NULL;
+            *(volatile oe_result_t*)&call_arg->result = result;
+        }
+        else if (++spin_count >= OE_HOST_WORKER_SPIN_COUNT_THRESHOLD)
+        {
+            context->total_spin_count += spin_count;
+            spin_count = 0;
+            _worker_wait(&context->worker, (void* volatile*)&context->call_arg);
+        }
+        else
+        {
+            oe_cpu_relax();
+        }
+    }
+
+    return NULL;
+}
+
+/*
+**==============================================================================
+**
+** _switchless_ecall_worker()
+**
+**     The thread function that launches an enclave worker. The ECALL only
+**     returns once the worker is stopped, so the thread keeps its TCS for the
+**     lifetime of the manager.
+**
+**==============================================================================
+*/
+
+static void* _switchless_ecall_worker(void* arg)
+{
+    oe_enclave_worker_context_t* context = (oe_enclave_worker_context_t*)arg;
+    uint64_t arg_out = 0;
+
+    /* On failure is_running is never set and no calls are posted to it */
+    oe_ecall(
+        context->enclave,
+        OE_ECALL_LAUNCH_ENCLAVE_WORKER,
+        (uint64_t)context,
+        &arg_out);
+
+    return NULL;
+}
+
+static void _stop_worker(oe_switchless_worker_t* worker)
+{
+    worker->is_stopping = true;
+    _worker_wake(&worker->event);
+}
+
+static void _join_workers(oe_thread* threads, size_t num_workers)
+{
+    for (size_t i = 0; i < num_workers; i++)
+        oe_thread_join(threads[i]);
+}
+
+static void _stop_host_workers(
+    oe_host_worker_context_t* contexts,
+    oe_thread* threads,
+    size_t num_workers)
+{
+    for (size_t i = 0; i < num_workers; i++)
+        _stop_worker(&contexts[i].worker);
+
+    _join_workers(threads, num_workers);
+}
+
+static void _stop_enclave_workers(
+    oe_enclave_worker_context_t* contexts,
+    oe_thread* threads,
+    size_t num_workers)
+{
+    for (size_t i = 0; i < num_workers; i++)
+        _stop_worker(&contexts[i].worker);
+
+    _join_workers(threads, num_workers);
+}
+
+/*
+**==============================================================================
+**
+** oe_start_switchless_manager()
+**
+**     Start the host and enclave worker threads and pass the manager to the
+**     enclave.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_start_switchless_manager(
+    oe_enclave_t* enclave,
+    size_t num_host_workers,
+    size_t num_enclave_workers)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager = NULL;
+    oe_host_worker_context_t* host_contexts = NULL;
+    oe_enclave_worker_context_t* enclave_contexts = NULL;
+    oe_thread* host_threads = NULL;
+    oe_thread* enclave_threads = NULL;
+    size_t num_host_started = 0;
+    size_t num_enclave_started = 0;
+
+    if (!enclave || enclave->switchless_manager)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (num_host_workers == 0 && num_enclave_workers == 0)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    /* Leave at least one TCS for regular ECALLs */
+    if (num_enclave_workers >= enclave->num_bindings)
+        OE_RAISE_MSG(
+            OE_INVALID_PARAMETER,
+            "max_enclave_workers must be less than the number of TCSs\n",
+            NULL);
+
+    if (!(manager = (oe_switchless_call_manager_t*)calloc(1, sizeof(*manager))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (num_host_workers)
+    {
+        if (!(host_contexts = (oe_host_worker_context_t*)calloc(
+                  num_host_workers, sizeof(oe_host_worker_context_t))))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        if (!(host_threads =
+                  (oe_thread*)calloc(num_host_workers, sizeof(oe_thread))))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    if (num_enclave_workers)
+    {
+        if (!(enclave_contexts = (oe_enclave_worker_context_t*)calloc(
+                  num_enclave_workers, sizeof(oe_enclave_worker_context_t))))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        if (!(enclave_threads =
+                  (oe_thread*)calloc(num_enclave_workers, sizeof(oe_thread))))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    manager->host_worker_contexts = host_contexts;
+    manager->num_host_workers = num_host_workers;
+    manager->enclave_worker_contexts = enclave_contexts;
+    manager->num_enclave_workers = num_enclave_workers;
+
+    for (; num_host_started < num_host_workers; num_host_started++)
+    {
+        host_contexts[num_host_started].enclave = enclave;
+
+        if (oe_thread_create(
+                &host_threads[num_host_started],
+                _switchless_ocall_worker,
+                &host_contexts[num_host_started]) != 0)
+        {
+            OE_RAISE_MSG(OE_FAILURE, "failed to start host worker\n", NULL);
+        }
+    }
+
+    enclave->switchless_manager = manager;
+    enclave->switchless_host_worker_threads = host_threads;
+    enclave->switchless_enclave_worker_threads = enclave_threads;
+
+    /* Let the enclave know about the host workers */
+    if (num_host_workers)
+    {
+        uint64_t arg_out = 0;
+        OE_CHECK(oe_ecall(
+            enclave,
+            OE_ECALL_INIT_CONTEXT_SWITCHLESS,
+            (uint64_t)manager,
+            &arg_out));
+        OE_CHECK((oe_result_t)arg_out);
+    }
+
+    for (; num_enclave_started < num_enclave_workers; num_enclave_started++)
+    {
+        enclave_contexts[num_enclave_started].enclave = enclave;
+
+        if (oe_thread_create(
+                &enclave_threads[num_enclave_started],
+                _switchless_ecall_worker,
+                &enclave_contexts[num_enclave_started]) != 0)
+        {
+            OE_RAISE_MSG(OE_FAILURE, "failed to start enclave worker\n", NULL);
+        }
+    }
+
+    manager = NULL;
+    host_contexts = NULL;
+    enclave_contexts = NULL;
+    host_threads = NULL;
+    enclave_threads = NULL;
+    result = OE_OK;
+
+done:
+
+    if (result != OE_OK && enclave)
+    {
+        /* Stop the workers that were started before the failure */
+        _stop_enclave_workers(
+            enclave_contexts, enclave_threads, num_enclave_started);
+        _stop_host_workers(host_contexts, host_threads, num_host_started);
+
+        if (manager && enclave->switchless_manager == manager)
+        {
+            enclave->switchless_manager = NULL;
+            enclave->switchless_host_worker_threads = NULL;
+            enclave->switchless_enclave_worker_threads = NULL;
+        }
+    }
+
+    free(enclave_threads);
+    free(host_threads);
+    free(enclave_contexts);
+    free(host_contexts);
+    free(manager);
+
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_stop_switchless_enclave_workers()
+**
+**     Stop the enclave workers and wait for their ECALLs to return. This must
+**     be done before the enclave destructor runs.
+**
+**==============================================================================
+*/
+
+void oe_stop_switchless_enclave_workers(oe_enclave_t* enclave)
+{
+    oe_switchless_call_manager_t* manager;
+
+    if (!enclave || !(manager = enclave->switchless_manager) ||
+        !enclave->switchless_enclave_worker_threads)
+        return;
+
+    _stop_enclave_workers(
+        manager->enclave_worker_contexts,
+        enclave->switchless_enclave_worker_threads,
+        manager->num_enclave_workers);
+
+    free(enclave->switchless_enclave_worker_threads);
+    enclave->switchless_enclave_worker_threads = NULL;
+}
+
+/*
+**==============================================================================
+**
+** oe_stop_switchless_manager()
+**
+**     Stop and join all worker threads and release the manager.
+**
+**==============================================================================
+*/
+
+void oe_stop_switchless_manager(oe_enclave_t* enclave)
+{
+    oe_switchless_call_manager_t* manager;
+
+    if (!enclave || !(manager = enclave->switchless_manager))
+        return;
+
+    oe_stop_switchless_enclave_workers(enclave);
+
+    _stop_host_workers(
+        manager->host_worker_contexts,
+        enclave->switchless_host_worker_threads,
+        manager->num_host_workers);
+
+    free(enclave->switchless_host_worker_threads);
+    free(manager->host_worker_contexts);
+    free(manager->enclave_worker_contexts);
+    free(manager);
+
+    enclave->switchless_host_worker_threads = NULL;
+    enclave->switchless_manager = NULL;
+}
+
+/*
+**==============================================================================
+**
+** oe_post_switchless_ecall()
+**
+**     Post the call to an idle enclave worker and wait for its completion
+**     without entering the enclave. Returns OE_CONTEXT_SWITCHLESS_ECALL_MISSED
+**     if there are no enclave workers or all of them are busy, in which case
+**     the caller should make a regular ECALL.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_post_switchless_ecall(
+    oe_enclave_t* enclave,
+    oe_call_enclave_function_args_t* args)
+{
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+    volatile oe_result_t* call_result = &args->result;
+
+    if (!manager)
+        return OE_CONTEXT_SWITCHLESS_ECALL_MISSED;
+
+    args->result = OE_SWITCHLESS_CALL_PENDING;
+
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+    {
+        oe_enclave_worker_context_t* context =
+            &manager->enclave_worker_contexts[i];
+
+        if (!context->is_running || context->worker.is_stopping)
+            continue;
+
+        if (!oe_atomic_compare_and_swap_ptr(
+                (void* volatile*)&context->call_arg, NULL, args))
+            continue;
+
+        /* Wake the worker if it parked itself before seeing the call */
+        if (context->worker.event == (uint32_t)-1)
+            _worker_wake(&context->worker.event);
+
+        while (*call_result == OE_SWITCHLESS_CALL_PENDING)
+            oe_cpu_relax();
+
+        return OE_OK;
+    }
+
+    return OE_CONTEXT_SWITCHLESS_ECALL_MISSED;
+}
+
+/*
+**==============================================================================
+**
+** oe_get_switchless_stats()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_get_switchless_stats(
+    oe_enclave_t* enclave,
+    oe_switchless_stats_t* stats)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const oe_switchless_call_manager_t* manager;
+
+    if (!enclave || !stats)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    manager = enclave->switchless_manager;
+    stats->host_worker_calls = 0;
+    stats->enclave_worker_calls = 0;
+
+    for (size_t i = 0; manager && i < manager->num_host_workers; i++)
+        stats->host_worker_calls +=
+            manager->host_worker_contexts[i].total_call_count;
+
+    for (size_t i = 0; manager && i < manager->num_enclave_workers; i++)
+        stats->enclave_worker_calls +=
+            manager->enclave_worker_contexts[i].total_call_count;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_handle_wake_host_worker()
+**
+**     Handle OE_OCALL_WAKE_HOST_WORKER: the enclave posted a call to a worker
+**     that is parked.
+**
+**==============================================================================
+*/
+
+void oe_handle_wake_host_worker(oe_enclave_t* enclave, uint64_t arg_in)
+{
+    oe_host_worker_context_t* context = (oe_host_worker_context_t*)arg_in;
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+
+    /* Only wake contexts that belong to this enclave */
+    if (!manager || context < manager->host_worker_contexts ||
+        context >= manager->host_worker_contexts + manager->num_host_workers)
+        return;
+
+    _worker_wake(&context->worker.event);
+}
+
+/*
+**==============================================================================
+**
+** oe_handle_wait_enclave_worker()
+**
+**     Handle OE_OCALL_WAIT_ENCLAVE_WORKER: an enclave worker has been idle
+**     for too long and parks until the host posts a call or stops it.
+**
+**==============================================================================
+*/
+
+void oe_handle_wait_enclave_worker(oe_enclave_t* enclave, uint64_t arg_in)
+{
+    oe_enclave_worker_context_t* context = (oe_enclave_worker_context_t*)arg_in;
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+
+    /* Only park contexts that belong to this enclave */
+    if (!manager || context < manager->enclave_worker_contexts ||
+        context >=
+            manager->enclave_worker_contexts + manager->num_enclave_workers)
+        return;
+
+    _worker_wait(&context->worker, (void* volatile*)&context->call_arg);
+}
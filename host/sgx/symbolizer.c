@@ -0,0 +1,247 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "symbolizer.h"
+#include <openenclave/bits/safemath.h>
+#include <openenclave/internal/elf.h>
+#include <openenclave/internal/raise.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+**==============================================================================
+**
+** Symbolizer
+**
+**     Maps addresses of an enclave image to the names of the functions that
+**     contain them. The function symbols of .symtab are read once, when the
+**     symbolizer is created, into a table sorted by start address with the
+**     names copied next to it, so the image file is not kept in memory and a
+**     lookup is a binary search instead of a scan of the symbol table.
+**
+**     Function ranges may overlap (aliases, nested local functions), so each
+**     entry also records the largest end address of the entries up to it. A
+**     lookup walks back from the last function starting at or before the
+**     address only while that bound shows a match is still possible.
+**
+**     A stripped image (no .symtab) gets an empty table, whose lookups all
+**     return NULL, so that callers can still print unknown names.
+**
+**==============================================================================
+*/
+
+typedef struct _function
+{
+    uint64_t start;
+
+    /* Last address of the function (inclusive, as elf64_get_function_name()
+     * matches) */
+    uint64_t end;
+
+    /* Largest end of this function and of the functions before it */
+    uint64_t max_end;
+
+    const char* name;
+} function_t;
+
+struct _oe_symbolizer
+{
+    function_t* functions;
+    size_t num_functions;
+    char* names;
+};
+
+static bool _get_function(
+    const elf64_t* elf,
+    const elf64_sym_t* sym,
+    uint64_t* end,
+    const char** name)
+{
+    if ((sym->st_info & 0x0F) != STT_FUNC)
+        return false;
+
+    if (oe_safe_add_u64(sym->st_value, sym->st_size, end) != OE_OK)
+        return false;
+
+    if (!(*name = elf64_get_string_from_strtab(elf, sym->st_name)))
+        return false;
+
+    return true;
+}
+
+static int _compare_functions(const void* p1, const void* p2)
+{
+    const function_t* f1 = (const function_t*)p1;
+    const function_t* f2 = (const function_t*)p2;
+
+    if (f1->start != f2->start)
+        return f1->start < f2->start ? -1 : 1;
+
+    return 0;
+}
+
+oe_result_t oe_symbolizer_create(
+    const char* path,
+    oe_symbolizer_t** symbolizer_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    elf64_t elf = ELF64_INIT;
+    bool elf_loaded = false;
+    const elf64_sym_t* symtab = NULL;
+    size_t num_symbols = 0;
+    size_t num_functions = 0;
+    size_t names_size = 0;
+    oe_symbolizer_t* symbolizer = NULL;
+    uint64_t end;
+    const char* name;
+
+    if (symbolizer_out)
+        *symbolizer_out = NULL;
+
+    if (!path || !symbolizer_out)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (elf64_load(path, &elf) != 0)
+        OE_RAISE(OE_FAILURE);
+
+    elf_loaded = true;
+
+    /* A stripped image has no functions to look up */
+    if (elf64_get_symbol_table(&elf, &symtab, &num_symbols) != 0)
+    {
+        symtab = NULL;
+        num_symbols = 0;
+    }
+
+    /* Count the functions and the space for their names */
+    for (size_t i = 1; i < num_symbols; i++)
+    {
+        if (!_get_function(&elf, &symtab[i], &end, &name))
+            continue;
+
+        num_functions++;
+        OE_CHECK(oe_safe_add_sizet(names_size, strlen(name) + 1, &names_size));
+    }
+
+    if (!(symbolizer = (oe_symbolizer_t*)calloc(1, sizeof(oe_symbolizer_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (num_functions)
+    {
+        symbolizer->functions =
+            (function_t*)calloc(num_functions, sizeof(function_t));
+        symbolizer->names = (char*)malloc(names_size);
+
+        if (!symbolizer->functions || !symbolizer->names)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    /* Copy the functions and their names */
+    {
+        char* p = symbolizer->names;
+
+        for (size_t i = 1; i < num_symbols; i++)
+        {
+            function_t* function;
+            size_t name_size;
+
+            if (!_get_function(&elf, &symtab[i], &end, &name))
+                continue;
+
+            function = &symbolizer->functions[symbolizer->num_functions++];
+            name_size = strlen(name) + 1;
+            memcpy(p, name, name_size);
+
+            function->start = symtab[i].st_value;
+            function->end = end;
+            function->name = p;
+            p += name_size;
+        }
+    }
+
+    qsort(
+        symbolizer->functions,
+        symbolizer->num_functions,
+        sizeof(function_t),
+        _compare_functions);
+
+    for (size_t i = 0; i < symbolizer->num_functions; i++)
+    {
+        function_t* function = &symbolizer->functions[i];
+        function->max_end = function->end;
+
+        if (i > 0 && function[-1].max_end > function->max_end)
+            function->max_end = function[-1].max_end;
+    }
+
+    *symbolizer_out = symbolizer;
+    symbolizer = NULL;
+    result = OE_OK;
+
+done:
+
+    if (elf_loaded)
+        elf64_unload(&elf);
+
+    oe_symbolizer_free(symbolizer);
+
+    return result;
+}
+
+const char* oe_symbolizer_lookup(
+    const oe_symbolizer_t* symbolizer,
+    uint64_t vaddr)
+{
+    const function_t* functions;
+    size_t lo = 0;
+    size_t hi;
+
+    if (!symbolizer)
+        return NULL;
+
+    functions = symbolizer->functions;
+    hi = symbolizer->num_functions;
+
+    /* Find the first function that starts after vaddr */
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (functions[mid].start <= vaddr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    /* Find the closest function before it that contains vaddr */
+    for (size_t i = lo; i > 0 && functions[i - 1].max_end >= vaddr; i--)
+    {
+        if (functions[i - 1].end >= vaddr)
+            return functions[i - 1].name;
+    }
+
+    return NULL;
+}
+
+void oe_symbolizer_lookup_batch(
+    const oe_symbolizer_t* symbolizer,
+    const uint64_t* vaddrs,
+    size_t count,
+    const char** names)
+{
+    if (!vaddrs || !names)
+        return;
+
+    for (size_t i = 0; i < count; i++)
+        names[i] = oe_symbolizer_lookup(symbolizer, vaddrs[i]);
+}
+
+void oe_symbolizer_free(oe_symbolizer_t* symbolizer)
+{
+    if (symbolizer)
+    {
+        free(symbolizer->functions);
+        free(symbolizer->names);
+        free(symbolizer);
+    }
+}
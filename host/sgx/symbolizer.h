@@ -0,0 +1,36 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_SYMBOLIZER_H
+#define _OE_HOST_SYMBOLIZER_H
+
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+
+OE_EXTERNC_BEGIN
+
+typedef struct _oe_symbolizer oe_symbolizer_t;
+
+/* Build the table of the functions of the ELF enclave image at path. The
+ * table is empty if the image has no symbol table. */
+oe_result_t oe_symbolizer_create(
+    const char* path,
+    oe_symbolizer_t** symbolizer);
+
+/* Return the name of the function that contains vaddr or NULL */
+const char* oe_symbolizer_lookup(
+    const oe_symbolizer_t* symbolizer,
+    uint64_t vaddr);
+
+/* Set names[i] to the name of the function that contains vaddrs[i] */
+void oe_symbolizer_lookup_batch(
+    const oe_symbolizer_t* symbolizer,
+    const uint64_t* vaddrs,
+    size_t count,
+    const char** names);
+
+void oe_symbolizer_free(oe_symbolizer_t* symbolizer);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_SYMBOLIZER_H */
@@ -1,8 +1,10 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/raise.h>
+#include <openenclave/internal/time.h>
 #include <openenclave/internal/trace.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -15,7 +17,8 @@
 #include "../hostthread.h"
 #include "enclave.h"
 
-#define LOGGING_FORMAT_STRING "%02d:%02d:%02d:%06ld tid(0x%lx) (%s)[%s]%s"
+#define LOGGING_FORMAT_STRING \
+    "%02d:%02d:%02d:%06ld tid(0x%llx) (%s)[%s]%s%s%s"
 static char* _log_level_strings[OE_LOG_LEVEL_MAX] =
     {"NONE", "FATAL", "ERROR", "WARN", "INFO", "VERBOSE"};
 static oe_mutex _log_lock = OE_H_MUTEX_INITIALIZER;
@@ -87,21 +90,37 @@ static void _write_header_info_to_stream(FILE* stream)
     fprintf(stream, "Last commit:%s\n\n", OE_REPO_LAST_COMMIT);
 }
 
+static uint64_t _get_realtime_ns(void)
+{
+#if defined(__linux__)
+    struct timeval time_now;
+    gettimeofday(&time_now, NULL);
+    return (uint64_t)time_now.tv_sec * 1000000000 +
+           (uint64_t)time_now.tv_usec * 1000;
+#else
+    return (uint64_t)time(NULL) * 1000000000;
+#endif
+}
+
 static void _write_message_to_stream(
     FILE* stream,
     bool is_enclave,
-    oe_log_args_t* args)
+    log_level_t level,
+    uint64_t thread_id,
+    uint64_t realtime_ns,
+    const char* prefix,
+    const char* message)
 {
+    time_t sec = (time_t)(realtime_ns / 1000000000);
+    long usec = (long)(realtime_ns % 1000000000 / 1000);
 #if defined(__linux__)
-    struct timeval time_now;
-    gettimeofday(&time_now, NULL);
-    struct tm* t = gmtime(&time_now.tv_sec);
+    struct tm* t = gmtime(&sec);
 #else
-    time_t lt = time(NULL);
-    struct tm* t = localtime(&lt);
+    struct tm* t = localtime(&sec);
 #endif
 
-    oe_thread thread_id = oe_thread_self();
+    if (!t || level >= OE_LOG_LEVEL_MAX)
+        return;
 
     fprintf(
         stream,
@@ -109,15 +128,43 @@ static void _write_message_to_stream(
         t->tm_hour,
         t->tm_min,
         t->tm_sec,
-#if defined(__linux__)
-        time_now.tv_usec,
-#else
-        0,
-#endif
-        thread_id,
+        usec,
+        (unsigned long long)thread_id,
         (is_enclave ? "E" : "H"),
-        _log_level_strings[args->level],
-        args->message);
+        _log_level_strings[level],
+        prefix ? prefix : "",
+        prefix ? ":" : "",
+        message);
+}
+
+/* Open the log file or return stdout. Called with _log_lock held. */
+static FILE* _open_log_stream(void)
+{
+    FILE* log_file = NULL;
+
+    if (!_log_file_name)
+        return stdout;
+
+    if (_log_creation_failed_before)
+        return NULL;
+
+    log_file = fopen(_log_file_name, "a");
+    if (log_file == NULL)
+    {
+        fprintf(stderr, "Failed to create logfile %s\n", _log_file_name);
+        _log_creation_failed_before = true;
+    }
+
+    return log_file;
+}
+
+static void _close_log_stream(FILE* stream)
+{
+    if (stream && stream != stdout)
+    {
+        fflush(stream);
+        fclose(stream);
+    }
 }
 
 static void _log_session_header()
@@ -151,15 +198,203 @@ static void _log_session_header()
     }
 }
 
+/*
+**==============================================================================
+**
+** Log ring
+**
+**     Debug enclaves append their log records to a ring in host memory (see
+**     oe_log_ring_t) instead of making an OCALL per record. A host thread
+**     drains the ring every OE_LOG_RING_DRAIN_INTERVAL milliseconds and
+**     formats the records, and so does the OE_OCALL_DRAIN_LOG OCALL that the
+**     enclave makes when the ring is full. There is no ring, and so no
+**     thread, when the log level discards every record.
+**
+**==============================================================================
+*/
+
+#define OE_LOG_RING_DRAIN_INTERVAL 10
+
+static void _copy_from_log_ring(
+    const oe_log_ring_t* ring,
+    uint32_t offset,
+    void* data,
+    size_t size)
+{
+    size_t start = offset & (OE_LOG_RING_SIZE - 1);
+    size_t n = OE_LOG_RING_SIZE - start;
+
+    if (n > size)
+        n = size;
+
+    memcpy(data, &ring->data[start], n);
+    memcpy((uint8_t*)data + n, ring->data, size - n);
+}
+
+static void _zero_log_ring(oe_log_ring_t* ring, uint32_t offset, size_t size)
+{
+    size_t start = offset & (OE_LOG_RING_SIZE - 1);
+    size_t n = OE_LOG_RING_SIZE - start;
+
+    if (n > size)
+        n = size;
+
+    memset(&ring->data[start], 0, n);
+    memset(ring->data, 0, size - n);
+}
+
+/* Return the file name of the enclave image, which prefixes its messages */
+static const char* _get_enclave_name(const char* path)
+{
+    const char* name = path;
+
+    for (const char* p = path; *p; p++)
+    {
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+    }
+
+    return name;
+}
+
+/* Return whether the incomplete record at tail has been incomplete for
+ * OE_LOG_RING_STALL_TIMEOUT milliseconds. Called with _log_lock held. */
+static bool _is_log_record_stalled(oe_enclave_t* enclave, uint32_t tail)
+{
+    uint64_t now = oe_get_time();
+
+    if (enclave->log_ring_stall_time == 0 ||
+        enclave->log_ring_stall_tail != tail)
+    {
+        enclave->log_ring_stall_tail = tail;
+        enclave->log_ring_stall_time = now;
+        return false;
+    }
+
+    return now - enclave->log_ring_stall_time >= OE_LOG_RING_STALL_TIMEOUT;
+}
+
+void oe_drain_log_ring(oe_enclave_t* enclave)
+{
+    oe_log_ring_t* ring = enclave->log_ring;
+    const char* name;
+    FILE* stream = NULL;
+    uint32_t tail;
+
+    if (!ring || oe_mutex_lock(&_log_lock) != 0)
+        return;
+
+    name = _get_enclave_name(enclave->path);
+    tail = ring->tail;
+
+    while (tail != ring->head)
+    {
+        volatile uint32_t* commit =
+            (volatile uint32_t*)&ring->data[tail & (OE_LOG_RING_SIZE - 1)];
+        oe_log_record_t record;
+        char message[OE_LOG_MESSAGE_LEN_MAX];
+        uint32_t size = *commit;
+
+        /* Stop at the first record that is not complete yet, unless it has
+         * stalled, in which case its space is skipped */
+        if (size == 0 || (size & OE_LOG_RECORD_PENDING))
+        {
+            if (!_is_log_record_stalled(enclave, tail))
+                break;
+
+            /* Without a size, skip everything reserved so far */
+            size = size ? size & ~OE_LOG_RECORD_PENDING : ring->head - tail;
+
+            if (size == 0 || size > OE_LOG_RING_SIZE || (size & 7))
+                break;
+
+            _zero_log_ring(ring, tail, size);
+            tail += size;
+            oe_atomic_exchange_u32(&ring->tail, tail);
+            continue;
+        }
+
+        /* A malformed record stops draining, after which the enclave
+         * falls back to OE_OCALL_LOG once the ring is full */
+        if (size < sizeof(record) || size > OE_LOG_RING_SIZE || (size & 7))
+            break;
+
+        enclave->log_ring_stall_time = 0;
+
+        _copy_from_log_ring(ring, tail, &record, sizeof(record));
+
+        if (record.message_size > size - sizeof(record) ||
+            record.message_size >= sizeof(message))
+            record.message_size = 0;
+
+        _copy_from_log_ring(
+            ring,
+            tail + (uint32_t)sizeof(record),
+            message,
+            record.message_size);
+        message[record.message_size] = '\0';
+
+        /* Free the space for the enclave, zeroed as records are complete
+         * once their size is set */
+        _zero_log_ring(ring, tail, size);
+        tail += size;
+        oe_atomic_exchange_u32(&ring->tail, tail);
+
+        if (record.level > (uint32_t)_log_level)
+            continue;
+
+        if (!stream && !(stream = _open_log_stream()))
+            continue;
+
+        _write_message_to_stream(
+            stream,
+            true,
+            (log_level_t)record.level,
+            record.thread_id,
+            record.realtime_ns == (uint64_t)-1 ? _get_realtime_ns()
+                                               : record.realtime_ns,
+            name,
+            message);
+    }
+
+    _close_log_stream(stream);
+    oe_mutex_unlock(&_log_lock);
+}
+
+static void* _log_ring_thread(void* arg)
+{
+    oe_enclave_t* enclave = (oe_enclave_t*)arg;
+
+    while (!enclave->log_ring_stopping)
+    {
+        oe_drain_log_ring(enclave);
+        oe_sleep(OE_LOG_RING_DRAIN_INTERVAL);
+    }
+
+    return NULL;
+}
+
 oe_result_t oe_log_enclave_init(oe_enclave_t* enclave)
 {
     oe_result_t result = OE_UNEXPECTED;
-    log_level_t level = _log_level;
+    oe_log_filter_t* arg = NULL;
+    oe_log_ring_t* ring = NULL;
 
     _initialize_log_config();
 
+    // Only debug enclaves log, and only if the level lets any record through
+    if ((enclave->debug || enclave->simulate) &&
+        _log_level > OE_LOG_LEVEL_NONE)
+    {
+        if (!(ring = (oe_log_ring_t*)calloc(1, sizeof(oe_log_ring_t))))
+        {
+            result = OE_OUT_OF_MEMORY;
+            goto done;
+        }
+    }
+
     // Populate arg fields.
-    oe_log_filter_t* arg = calloc(1, sizeof(oe_log_filter_t));
+    arg = calloc(1, sizeof(oe_log_filter_t));
     if (arg == NULL)
     {
         result = OE_OUT_OF_MEMORY;
@@ -167,17 +402,51 @@ oe_result_t oe_log_enclave_init(oe_enclave_t* enclave)
     }
     arg->path = enclave->path;
     arg->path_len = strlen(enclave->path);
-    arg->level = level;
+    arg->level = _log_level;
+    arg->ring = ring;
     // Call enclave
     result = oe_ecall(enclave, OE_ECALL_LOG_INIT, (uint64_t)arg, NULL);
     if (result != OE_OK)
         goto done;
 
+    if (ring)
+    {
+        enclave->log_ring = ring;
+        enclave->log_ring_stopping = 0;
+        ring = NULL;
+
+        if (oe_thread_create(
+                &enclave->log_ring_thread, _log_ring_thread, enclave) != 0)
+        {
+            // The ring is still drained when it is full
+            enclave->log_ring_stopping = 1;
+        }
+    }
+
     result = OE_OK;
 done:
+    free(ring);
+    free(arg);
     return result;
 }
 
+void oe_log_enclave_terminate(oe_enclave_t* enclave)
+{
+    if (!enclave || !enclave->log_ring)
+        return;
+
+    if (!enclave->log_ring_stopping)
+    {
+        enclave->log_ring_stopping = 1;
+        oe_thread_join(enclave->log_ring_thread);
+    }
+
+    oe_drain_log_ring(enclave);
+
+    free(enclave->log_ring);
+    enclave->log_ring = NULL;
+}
+
 void oe_log(log_level_t level, const char* fmt, ...)
 {
     if (_initialized)
@@ -216,26 +485,21 @@ void log_message(bool is_enclave, oe_log_args_t* args)
     // Take the log file lock.
     if (oe_mutex_lock(&_log_lock) == OE_OK)
     {
-        if (!_log_file_name)
-        {
-            _write_message_to_stream(stdout, is_enclave, args);
-        }
-        else if (!_log_creation_failed_before)
+        FILE* stream = _open_log_stream();
+
+        if (stream)
         {
-            FILE* log_file = NULL;
-            log_file = fopen(_log_file_name, "a");
-            if (log_file == NULL)
-            {
-                fprintf(
-                    stderr, "Failed to create logfile %s\n", _log_file_name);
-                oe_mutex_unlock(&_log_lock);
-                _log_creation_failed_before = true;
-                return;
-            }
-            _write_message_to_stream(log_file, is_enclave, args);
-            fflush(log_file);
-            fclose(log_file);
+            _write_message_to_stream(
+                stream,
+                is_enclave,
+                args->level,
+                (uint64_t)oe_thread_self(),
+                _get_realtime_ns(),
+                NULL,
+                args->message);
+            _close_log_stream(stream);
         }
+
         // Release the log file lock.
         oe_mutex_unlock(&_log_lock);
     }
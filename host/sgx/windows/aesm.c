@@ -258,6 +258,21 @@ void aesm_disconnect(aesm_t* aesm)
     }
 }
 
+/* Every request creates its own COM instance, so there is nothing to pool */
+aesm_t* aesm_acquire(void)
+{
+    return aesm_connect();
+}
+
+void aesm_release(aesm_t* aesm)
+{
+    aesm_disconnect(aesm);
+}
+
+void aesm_clear_pool(void)
+{
+}
+
 oe_result_t aesm_get_launch_token(
     aesm_t* aesm,
     uint8_t mrenclave[OE_SHA256_SIZE],
@@ -23,6 +23,93 @@ int oe_thread_equal(oe_thread thread1, oe_thread thread2)
     return thread1 == thread2;
 }
 
+typedef struct _thread_start_args
+{
+    void* (*func)(void*);
+    void* arg;
+} thread_start_args_t;
+
+static DWORD WINAPI _thread_start(LPVOID param)
+{
+    thread_start_args_t args = *(thread_start_args_t*)param;
+    free(param);
+    args.func(args.arg);
+    return 0;
+}
+
+/* Handles of the threads created by oe_thread_create() and not yet joined.
+ * Holding the handle keeps the identifier of the thread from being reused,
+ * so oe_thread_join() waits on the very thread that was created. */
+typedef struct _thread_handle
+{
+    oe_thread thread;
+    HANDLE handle;
+    struct _thread_handle* next;
+} thread_handle_t;
+
+static SRWLOCK _thread_handles_lock = SRWLOCK_INIT;
+static thread_handle_t* _thread_handles;
+
+int oe_thread_create(oe_thread* thread, void* (*func)(void*), void* arg)
+{
+    thread_start_args_t* args;
+    thread_handle_t* entry;
+
+    if (!(args = (thread_start_args_t*)malloc(sizeof(thread_start_args_t))))
+        return 1;
+
+    if (!(entry = (thread_handle_t*)malloc(sizeof(thread_handle_t))))
+    {
+        free(args);
+        return 1;
+    }
+
+    args->func = func;
+    args->arg = arg;
+
+    if (!(entry->handle =
+              CreateThread(NULL, 0, _thread_start, args, 0, thread)))
+    {
+        free(entry);
+        free(args);
+        return 1;
+    }
+
+    entry->thread = *thread;
+
+    AcquireSRWLockExclusive(&_thread_handles_lock);
+    entry->next = _thread_handles;
+    _thread_handles = entry;
+    ReleaseSRWLockExclusive(&_thread_handles_lock);
+
+    return 0;
+}
+
+int oe_thread_join(oe_thread thread)
+{
+    thread_handle_t* entry = NULL;
+
+    AcquireSRWLockExclusive(&_thread_handles_lock);
+    for (thread_handle_t** p = &_thread_handles; *p; p = &(*p)->next)
+    {
+        if ((*p)->thread == thread)
+        {
+            entry = *p;
+            *p = entry->next;
+            break;
+        }
+    }
+    ReleaseSRWLockExclusive(&_thread_handles_lock);
+
+    if (!entry)
+        return 1;
+
+    WaitForSingleObject(entry->handle, INFINITE);
+    CloseHandle(entry->handle);
+    free(entry);
+    return 0;
+}
+
 /*
 **==============================================================================
 **
@@ -103,11 +190,12 @@ int oe_mutex_destroy(oe_mutex* Lock)
 **==============================================================================
 */
 
-int oe_thread_key_create(oe_thread_key* key)
+/* Fiber local storage is used since, unlike TLS, it runs destructors */
+int oe_thread_key_create(oe_thread_key* key, void (*destructor)(void* value))
 {
     oe_thread_key k;
-    k = TlsAlloc();
-    if (k == TLS_OUT_OF_INDEXES)
+    k = FlsAlloc((PFLS_CALLBACK_FUNCTION)destructor);
+    if (k == FLS_OUT_OF_INDEXES)
         return 1;
 
     *key = k;
@@ -116,15 +204,15 @@ int oe_thread_key_create(oe_thread_key* key)
 
 int oe_thread_key_delete(oe_thread_key key)
 {
-    return !TlsFree(key);
+    return !FlsFree(key);
 }
 
 int oe_thread_setspecific(oe_thread_key key, void* value)
 {
-    return !TlsSetValue(key, value);
+    return !FlsSetValue(key, value);
 }
 
 void* oe_thread_getspecific(oe_thread_key key)
 {
-    return TlsGetValue(key);
+    return FlsGetValue(key);
 }
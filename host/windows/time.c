@@ -3,6 +3,7 @@
 
 #include <limits.h>
 #include <openenclave/bits/types.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/time.h>
 #include <windows.h>
 
@@ -46,6 +47,39 @@ static uint64_t _time()
     return (x.QuadPart / TICKS_PER_MILLISECOND);
 }
 
+/* Return nanoseconds elapsed since the Epoch. */
+static uint64_t _realtime_ns()
+{
+    FILETIME ft;
+    ULARGE_INTEGER x;
+    const uint64_t NSEC_PER_TICK = 100UL;
+
+    GetSystemTimePreciseAsFileTime(&ft);
+    x.u.LowPart = ft.dwLowDateTime;
+    x.u.HighPart = ft.dwHighDateTime;
+    x.QuadPart -= POSIX_TO_WINDOWS_EPOCH_TICKS;
+
+    return x.QuadPart * NSEC_PER_TICK;
+}
+
+/* Return nanoseconds elapsed since the performance counter started. */
+static uint64_t _monotonic_ns()
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    const uint64_t NSEC_PER_SEC = 1000000000UL;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&counter);
+
+    /* Split the conversion to avoid overflowing 64 bits */
+    return ((uint64_t)counter.QuadPart / frequency.QuadPart) * NSEC_PER_SEC +
+           ((uint64_t)counter.QuadPart % frequency.QuadPart) * NSEC_PER_SEC /
+               frequency.QuadPart;
+}
+
 void oe_handle_sleep(uint64_t arg_in)
 {
     const uint64_t milliseconds = arg_in;
@@ -58,6 +92,26 @@ void oe_handle_sleep(uint64_t arg_in)
     Sleep((DWORD)mod);
 }
 
+int oe_sleep(uint64_t milliseconds)
+{
+    oe_handle_sleep(milliseconds);
+    return 0;
+}
+
+uint64_t oe_get_time(void)
+{
+    return _time();
+}
+
+void oe_update_shared_clock(oe_shared_clock_t* clock)
+{
+    /* Make the sequence odd while the times are inconsistent */
+    oe_atomic_increment(&clock->sequence);
+    clock->realtime_ns = _realtime_ns();
+    clock->monotonic_ns = _monotonic_ns();
+    oe_atomic_increment(&clock->sequence);
+}
+
 void oe_handle_get_time(uint64_t arg_in, uint64_t* arg_out)
 {
     OE_UNUSED(arg_in);
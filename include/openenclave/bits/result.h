@@ -269,6 +269,18 @@ typedef enum _oe_result
      */
     OE_VERIFY_CRL_EXPIRED,
 
+    /**
+     * A switchless call could not be posted because all host worker threads
+     * were busy. The caller falls back to a regular (context-switching) call.
+     */
+    OE_CONTEXT_SWITCHLESS_OCALL_MISSED,
+
+    /**
+     * A switchless call could not be posted because all enclave worker
+     * threads were busy. The caller falls back to a regular ECALL.
+     */
+    OE_CONTEXT_SWITCHLESS_ECALL_MISSED,
+
     __OE_RESULT_MAX = OE_ENUM_MAX,
 } oe_result_t;
 /**< typedef enum _oe_result oe_result_t*/
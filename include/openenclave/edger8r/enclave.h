@@ -21,6 +21,7 @@
 #include <openenclave/bits/result.h>
 #include <openenclave/bits/types.h>
 #include <openenclave/edger8r/common.h>
+#include <openenclave/enclave.h> // for oe_stream_reader_t
 
 OE_EXTERNC_BEGIN
 
@@ -73,6 +74,38 @@ oe_result_t oe_call_host_function(
     size_t output_buffer_size,
     size_t* output_bytes_written);
 
+/**
+ * Perform a switchless host function call (OCALL).
+ *
+ * Same as oe_call_host_function() except that the call is posted to one of
+ * the host worker threads configured with
+ * **OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS** and the calling thread does not
+ * leave the enclave. If the enclave has no host workers or all of them are
+ * busy, the call is made as a regular OCALL.
+ *
+ * @param function_id The id of the host function that will be called.
+ * @param input_buffer Buffer containing inputs data.
+ * @param input_buffer_size Size of the input data buffer.
+ * @param output_buffer Buffer where the outputs of the host function are
+ * written to.
+ * @param output_buffer_size Size of the output buffer.
+ * @param output_bytes_written Number of bytes written in the output buffer.
+ *
+ * @return OE_OK the call was successful.
+ * @return OE_NOT_FOUND if the function_id does not correspond to a function.
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_FAILURE the call failed.
+ * @return OE_BUFFER_TOO_SMALL the input or output buffer was smaller than
+ * expected.
+ */
+oe_result_t oe_switchless_call_host_function(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    size_t* output_bytes_written);
+
 /**
  * Allocate a buffer of given size for doing an ocall.
  *
@@ -92,6 +125,57 @@ void* oe_allocate_ocall_buffer(size_t size);
  */
 void oe_free_ocall_buffer(void* buffer);
 
+/**
+ * Set up a reader over the host buffer of a **stream** parameter.
+ *
+ * Fails with OE_INVALID_PARAMETER unless the buffer lies outside the enclave.
+ * A NULL buffer is read as an empty one. The windows are allocated by the
+ * first oe_stream_read() and released by oe_stream_reader_free().
+ *
+ * @param reader The reader to set up.
+ * @param data The buffer in host memory.
+ * @param size The size of the buffer.
+ */
+oe_result_t oe_stream_reader_init(
+    oe_stream_reader_t* reader,
+    const void* data,
+    size_t size);
+
+/**
+ * Release the windows of a reader set up with oe_stream_reader_init().
+ */
+void oe_stream_reader_free(oe_stream_reader_t* reader);
+
+/**
+ * Set up a writer to the host buffer of a **stream** parameter.
+ *
+ * Fails with OE_INVALID_PARAMETER unless the buffer lies outside the enclave.
+ * A NULL buffer is treated as an empty one.
+ *
+ * @param writer The writer to set up.
+ * @param data The buffer in host memory.
+ * @param size The size of the buffer.
+ */
+oe_result_t oe_stream_writer_init(
+    oe_stream_writer_t* writer,
+    void* data,
+    size_t size);
+
+/**
+ * Set up the reader or writer of a stream parameter. Used by generated code.
+ */
+#define OE_SET_IN_STREAM(argname, argsize)                                   \
+    if ((_result = oe_stream_reader_init(                                    \
+             &_##argname##_stream, pargs_in->argname, (size_t)(argsize))) != \
+        OE_OK)                                                               \
+        goto done;
+
+#define OE_SET_OUT_STREAM(argname, argsize)                                  \
+    if ((_result = oe_stream_writer_init(                                    \
+             &_##argname##_stream, pargs_in->argname, (size_t)(argsize))) != \
+        OE_OK)                                                               \
+        goto done;
+
 /**
  * For hand-written enclaves, that use the older calling mechanism, define empty
  * ecall tables.
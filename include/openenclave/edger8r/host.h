@@ -66,6 +66,110 @@ oe_result_t oe_call_enclave_function(
     size_t output_buffer_size,
     size_t* output_bytes_written);
 
+/**
+ * Perform a switchless enclave function call (ECALL).
+ *
+ * Same as oe_call_enclave_function() except that the call is posted to one
+ * of the enclave worker threads configured with
+ * **OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS** and the calling thread does not
+ * enter the enclave. If the enclave has no enclave workers or all of them
+ * are busy, the call is made as a regular ECALL.
+ *
+ * @param function_id The id of the enclave function that will be called.
+ * @param input_buffer Buffer containing inputs data.
+ * @param input_buffer_size Size of the input data buffer.
+ * @param output_buffer Buffer where the outputs of the host function are
+ * written to.
+ * @param output_buffer_size Size of the output buffer.
+ * @param output_bytes_written Number of bytes written in the output buffer.
+ *
+ * @return OE_OK the call was successful.
+ * @return OE_NOT_FOUND if the function_id does not correspond to a function.
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_FAILURE the call failed.
+ * @return OE_BUFFER_TOO_SMALL the input or output buffer was smaller than
+ * expected.
+ *
+ */
+oe_result_t oe_switchless_call_enclave_function(
+    oe_enclave_t* enclave,
+    uint32_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    size_t* output_bytes_written);
+
+/**
+ * An enclave function call of a batch (see oe_call_enclave_function_batch()).
+ */
+typedef struct _oe_enclave_function_call
+{
+    /** The id of the enclave function to call. */
+    uint64_t function_id;
+
+    /** Buffer containing the input data. */
+    const void* input_buffer;
+
+    /** Size of the input buffer. */
+    size_t input_buffer_size;
+
+    /** Buffer where the outputs of the enclave function are written to. */
+    void* output_buffer;
+
+    /** Size of the output buffer. */
+    size_t output_buffer_size;
+
+    /** Set to the number of bytes written in the output buffer. */
+    size_t output_bytes_written;
+
+    /** Set to the result of the call, as oe_call_enclave_function() would
+     * return it. */
+    oe_result_t result;
+} oe_enclave_function_call_t;
+
+/**
+ * Perform a batch of enclave function calls (ECALLs) in one enclave entry.
+ *
+ * The calls are made in order, as by oe_call_enclave_function(), but the
+ * calling thread enters the enclave once for all of them. The result and the
+ * number of output bytes written of each call are stored in its
+ * oe_enclave_function_call_t. A call that fails does not stop the later
+ * calls of the batch.
+ *
+ * @param enclave The enclave to call.
+ * @param calls The calls to make.
+ * @param num_calls The number of calls.
+ *
+ * @return OE_OK the calls were made (each call has its own result).
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_FAILURE the enclave could not be entered.
+ *
+ */
+oe_result_t oe_call_enclave_function_batch(
+    oe_enclave_t* enclave,
+    oe_enclave_function_call_t* calls,
+    size_t num_calls);
+
+/**
+ * Allocate a buffer of given size for doing an ecall.
+ *
+ * The buffer is reused by later ecalls of the calling thread once it is freed
+ * and must be freed by the thread that allocated it.
+ *
+ * @param size The size in bytes of the buffer.
+ * @returns pointer to the allocated buffer.
+ * @return NULL if allocation failed.
+ */
+void* oe_allocate_ecall_buffer(size_t size);
+
+/**
+ * Free the buffer allocated for ecalls.
+ *
+ * @param buffer The buffer allocated via oe_allocate_ecall_buffer.
+ */
+void oe_free_ecall_buffer(void* buffer);
+
 OE_EXTERNC_END
 
 #endif // _OE_EDGER8R_HOST_H
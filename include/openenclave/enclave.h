@@ -859,6 +859,86 @@ oe_enclave_t* oe_get_enclave(void);
  */
 oe_result_t oe_random(void* data, size_t size);
 
+/**
+ * Reader over a buffer in host memory.
+ *
+ * Enclave functions receive a pointer to a reader for each parameter that is
+ * declared with the **in** and **stream** EDL attributes. The buffer is not
+ * copied into the enclave when the function is called. Instead,
+ * oe_stream_read() copies it one window at a time into enclave memory, so
+ * the enclave memory used does not depend on the size of the buffer.
+ */
+typedef struct _oe_stream_reader
+{
+    /* The buffer in host memory, its size and the offset of the next read */
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+
+    /* Two windows in enclave memory and the one returned last */
+    uint8_t* windows[2];
+    size_t window_size;
+    size_t current;
+} oe_stream_reader_t;
+
+/**
+ * Writer to a buffer in host memory.
+ *
+ * Enclave functions receive a pointer to a writer for each parameter that is
+ * declared with the **out** and **stream** EDL attributes. Data passed to
+ * oe_stream_write() is copied straight to the buffer, rather than through an
+ * output buffer in enclave memory.
+ */
+typedef struct _oe_stream_writer
+{
+    /* The buffer in host memory, its size and the offset of the next write */
+    uint8_t* data;
+    size_t size;
+    size_t offset;
+} oe_stream_writer_t;
+
+/**
+ * Read the next window of a host buffer.
+ *
+ * This function copies the next window (up to 64 KB) of the host buffer into
+ * enclave memory. The reader alternates between two windows, so the window
+ * returned by the previous call remains valid until the next call, which
+ * lets the caller handle data that spans two windows.
+ *
+ * @param reader The reader passed to the enclave function.
+ * @param data Set to the window in enclave memory.
+ * @param size Set to the number of bytes in the window, or zero once the
+ * whole buffer has been read.
+ *
+ * @return OE_OK on success
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_OUT_OF_MEMORY the window could not be allocated.
+ */
+oe_result_t oe_stream_read(
+    oe_stream_reader_t* reader,
+    const void** data,
+    size_t* size);
+
+/**
+ * Append data to a host buffer.
+ *
+ * This function copies **size** bytes to the host buffer after the bytes
+ * written so far.
+ *
+ * @param writer The writer passed to the enclave function.
+ * @param data The data to write.
+ * @param size The number of bytes to write.
+ *
+ * @return OE_OK on success
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_BUFFER_TOO_SMALL the host buffer has less than **size** bytes
+ * left, in which case nothing is written.
+ */
+oe_result_t oe_stream_write(
+    oe_stream_writer_t* writer,
+    const void* data,
+    size_t size);
+
 OE_EXTERNC_END
 
 #endif /* _OE_ENCLAVE_H */
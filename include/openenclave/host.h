@@ -53,6 +53,58 @@ OE_EXTERNC_BEGIN
  * @endcond
  */
 
+/**
+ * Types of settings passed into **oe_create_enclave**
+ */
+typedef enum _oe_enclave_setting_type
+{
+    OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS = 0xdc73a628,
+    __OE_ENCLAVE_SETTING_MAX = OE_ENUM_MAX,
+} oe_enclave_setting_type_t;
+
+/**
+ * The setting for switchless calls.
+ */
+typedef struct _oe_enclave_setting_context_switchless
+{
+    /**
+     * The max number of worker threads the host starts to service switchless
+     * OCALLs. Zero disables switchless OCALLs; functions marked with
+     * **transition_using_threads** then fall back to regular OCALLs.
+     */
+    size_t max_host_workers;
+
+    /**
+     * The max number of worker threads that are parked inside the enclave to
+     * service switchless ECALLs. Each worker permanently occupies one TCS, so
+     * this must be less than the number of TCSs of the enclave. Zero disables
+     * switchless ECALLs.
+     */
+    size_t max_enclave_workers;
+} oe_enclave_setting_context_switchless_t;
+
+/**
+ * The uniform structure type containing a specific type of enclave
+ * setting.
+ */
+typedef struct _oe_enclave_setting
+{
+    /**
+     * The type of the setting in the union.
+     */
+    oe_enclave_setting_type_t setting_type;
+
+    /**
+     * The specific setting for the enclave, such as for configuring
+     * context-switchless calls.
+     */
+    union {
+        const oe_enclave_setting_context_switchless_t*
+            context_switchless_setting;
+        /* Add new setting types here. */
+    } u;
+} oe_enclave_setting_t;
+
 /**
  * Type of each function in an ocall-table.
  */
@@ -82,10 +134,11 @@ typedef void (*oe_ocall_func_t)(
  *     - OE_ENCLAVE_FLAG_DEBUG - runs the enclave in debug mode.
  *                               DO NOT SHIP CODE with this flag
  *
- * @param config Additional enclave creation configuration data for the specific
- * enclave type. This parameter is reserved and must be NULL.
+ * @param config An optional array of **oe_enclave_setting_t** structures that
+ * configure the enclave, such as the number of host worker threads used for
+ * switchless calls. May be NULL.
  *
- * @param config_size The size of the **config** data buffer in bytes.
+ * @param config_size The number of settings in the **config** array.
  *
  * @param ocall_table Pointer to table of ocall functions generated by
  * oeedger8r.
@@ -121,6 +174,128 @@ oe_result_t oe_create_enclave(
  */
 oe_result_t oe_terminate_enclave(oe_enclave_t* enclave);
 
+/**
+ * Type of the enclave creation functions generated by oeedger8r, such as
+ * **oe_create_<name>_enclave()**.
+ */
+typedef oe_result_t (*oe_create_enclave_func_t)(
+    const char* path,
+    oe_enclave_type_t type,
+    uint32_t flags,
+    const void* config,
+    uint32_t config_size,
+    oe_enclave_t** enclave);
+
+/**
+ * A pool of enclave instances created from the same enclave image.
+ */
+typedef struct _oe_enclave_pool oe_enclave_pool_t;
+
+/**
+ * Create a pool of pre-created enclave instances.
+ *
+ * This function creates a pool of enclaves, all created by calling
+ * **create_enclave** with the given path, type, flags and settings.
+ * Background threads keep at least **min_enclaves** enclaves created and
+ * initialized (global constructors run) but not in use, without exceeding
+ * **max_enclaves** enclaves in total, so that oe_enclave_pool_acquire()
+ * does not normally create an enclave itself.
+ *
+ * The background threads also check the enclaves that are not in use
+ * periodically and terminate the ones that are no longer healthy, i.e. for
+ * which oe_get_enclave_status() in the enclave does not return OE_OK.
+ *
+ * @param create_enclave The enclave creation function generated by
+ * oeedger8r for the enclave, e.g. **oe_create_<name>_enclave**.
+ *
+ * @param path The path of the enclave image file.
+ *
+ * @param type The type of the enclaves (see oe_create_enclave()).
+ *
+ * @param flags The flags of the enclaves (see oe_create_enclave()).
+ *
+ * @param config The enclave settings (see oe_create_enclave()). The
+ * settings must remain valid until the pool is terminated.
+ *
+ * @param config_size The number of settings in the **config** array.
+ *
+ * @param min_enclaves The number of enclaves to keep ready for use.
+ *
+ * @param max_enclaves The maximum number of enclaves of the pool, including
+ * the enclaves in use. It must not be zero or less than **min_enclaves**.
+ *
+ * @param pool This points to the pool upon success.
+ *
+ * @returns Returns OE_OK on success.
+ *
+ */
+oe_result_t oe_create_enclave_pool(
+    oe_create_enclave_func_t create_enclave,
+    const char* path,
+    oe_enclave_type_t type,
+    uint32_t flags,
+    const void* config,
+    uint32_t config_size,
+    size_t min_enclaves,
+    size_t max_enclaves,
+    oe_enclave_pool_t** pool);
+
+/**
+ * Take an enclave from a pool for exclusive use.
+ *
+ * This function returns an enclave of the pool that is not in use in
+ * constant time. If there is none, it creates one unless the pool already
+ * has **max_enclaves** enclaves. The enclave must be given back with
+ * oe_enclave_pool_release() and not terminated by the caller.
+ *
+ * @param pool The pool to take the enclave from.
+ *
+ * @param enclave This points to the enclave upon success.
+ *
+ * @returns Returns OE_OK on success.
+ * @returns OE_BUSY if the pool has **max_enclaves** enclaves and none of
+ * them is ready for use.
+ *
+ */
+oe_result_t oe_enclave_pool_acquire(
+    oe_enclave_pool_t* pool,
+    oe_enclave_t** enclave);
+
+/**
+ * Give an enclave taken with oe_enclave_pool_acquire() back to its pool.
+ *
+ * This function checks the health of the enclave with one ECALL to
+ * oe_get_enclave_status(). A healthy enclave can be acquired again in
+ * constant time. An enclave that crashed is retired and terminated by a
+ * background thread of the pool, which creates a new one if needed.
+ *
+ * The state that the enclave holds is kept as is, so enclaves that must
+ * not share state across uses should not be released to a pool.
+ *
+ * @param pool The pool that the enclave was taken from.
+ *
+ * @param enclave The enclave to give back.
+ *
+ * @returns Returns OE_OK on success.
+ *
+ */
+oe_result_t oe_enclave_pool_release(
+    oe_enclave_pool_t* pool,
+    oe_enclave_t* enclave);
+
+/**
+ * Terminate a pool and all its enclaves.
+ *
+ * All the enclaves taken from the pool must have been released.
+ *
+ * @param pool The pool to terminate.
+ *
+ * @returns Returns OE_OK on success.
+ * @returns OE_BUSY if an enclave of the pool is still in use.
+ *
+ */
+oe_result_t oe_terminate_enclave_pool(oe_enclave_pool_t* pool);
+
 /**
  * Perform a high-level enclave function call (ECALL).
  *
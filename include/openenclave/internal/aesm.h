@@ -18,6 +18,32 @@ aesm_t* aesm_connect(void);
 
 void aesm_disconnect(aesm_t* aesm);
 
+/**
+ * Get a connection to AESM from the pool, or open a new one if the pool is
+ * empty. Requests on a pooled connection that AESM has since closed are
+ * retried on a new connection.
+ */
+aesm_t* aesm_acquire(void);
+
+/**
+ * Return a connection obtained with aesm_acquire() to the pool. The
+ * connection is closed instead if the pool is full or a request broke it.
+ */
+void aesm_release(aesm_t* aesm);
+
+/**
+ * Close every idle connection in the pool.
+ */
+void aesm_clear_pool(void);
+
+#if defined(__linux__)
+/**
+ * Connect to AESM at the given UNIX socket path instead of the default one
+ * and empty the pool. Used by tests.
+ */
+oe_result_t aesm_set_socket_path(const char* path);
+#endif
+
 oe_result_t aesm_get_launch_token(
     aesm_t* aesm,
     uint8_t mrenclave[OE_SHA256_SIZE],
@@ -10,8 +10,27 @@
 #if defined(_MSC_VER)
 #pragma intrinsic(_InterlockedIncrement64)
 #pragma intrinsic(_InterlockedDecrement64)
+#pragma intrinsic(_InterlockedExchange)
+#pragma intrinsic(_InterlockedCompareExchange)
+#pragma intrinsic(_InterlockedCompareExchangePointer)
+#pragma intrinsic(_InterlockedCompareExchange64)
+#pragma intrinsic(_mm_pause)
 __int64 _InterlockedIncrement64(__int64* lpAddend);
 __int64 _InterlockedDecrement64(__int64* lpAddend);
+long _InterlockedExchange(long volatile* Target, long Value);
+long _InterlockedCompareExchange(
+    long volatile* Destination,
+    long Exchange,
+    long Comparand);
+void* _InterlockedCompareExchangePointer(
+    void* volatile* Destination,
+    void* Exchange,
+    void* Comparand);
+__int64 _InterlockedCompareExchange64(
+    __int64 volatile* Destination,
+    __int64 Exchange,
+    __int64 Comparand);
+void _mm_pause(void);
 #endif
 
 /* Atomically increment **x** and return its new value */
@@ -38,4 +57,82 @@ OE_INLINE uint64_t oe_atomic_decrement(volatile uint64_t* x)
 #endif
 }
 
+/* Atomically set **x** to **value** and return its previous value. This is a
+ * full memory barrier. */
+OE_INLINE uint32_t oe_atomic_exchange_u32(volatile uint32_t* x, uint32_t value)
+{
+#if defined(__GNUC__)
+    return __atomic_exchange_n(x, value, __ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+    return (uint32_t)_InterlockedExchange((long volatile*)x, (long)value);
+#else
+#error "unsupported"
+#endif
+}
+
+/* Atomically set **x** to **desired** if it equals **expected**. Return true
+ * if **x** was updated. This is a full memory barrier. */
+OE_INLINE bool oe_atomic_compare_and_swap_u32(
+    volatile uint32_t* x,
+    uint32_t expected,
+    uint32_t desired)
+{
+#if defined(__GNUC__)
+    return __sync_bool_compare_and_swap(x, expected, desired);
+#elif defined(_MSC_VER)
+    return _InterlockedCompareExchange(
+               (long volatile*)x, (long)desired, (long)expected) ==
+           (long)expected;
+#else
+#error "unsupported"
+#endif
+}
+
+/* Atomically set **x** to **desired** if it equals **expected**. Return true
+ * if **x** was updated. This is a full memory barrier. */
+OE_INLINE bool oe_atomic_compare_and_swap_ptr(
+    void* volatile* x,
+    void* expected,
+    void* desired)
+{
+#if defined(__GNUC__)
+    return __sync_bool_compare_and_swap(x, expected, desired);
+#elif defined(_MSC_VER)
+    return _InterlockedCompareExchangePointer(x, desired, expected) ==
+           expected;
+#else
+#error "unsupported"
+#endif
+}
+
+/* Atomically set **x** to **desired** if it equals **expected**. Return true
+ * if **x** was updated. This is a full memory barrier. */
+OE_INLINE bool oe_atomic_compare_and_swap_u64(
+    volatile uint64_t* x,
+    uint64_t expected,
+    uint64_t desired)
+{
+#if defined(__GNUC__)
+    return __sync_bool_compare_and_swap(x, expected, desired);
+#elif defined(_MSC_VER)
+    return _InterlockedCompareExchange64(
+               (__int64 volatile*)x, (__int64)desired, (__int64)expected) ==
+           (__int64)expected;
+#else
+#error "unsupported"
+#endif
+}
+
+/* Tell the processor that the caller is in a spin-wait loop */
+OE_INLINE void oe_cpu_relax(void)
+{
+#if defined(__GNUC__)
+    asm volatile("pause" ::: "memory");
+#elif defined(_MSC_VER)
+    _mm_pause();
+#else
+#error "unsupported"
+#endif
+}
+
 #endif /* _OE_ATOMIC_H */
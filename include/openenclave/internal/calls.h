@@ -78,6 +78,10 @@ typedef enum _oe_func
     OE_ECALL_GET_SGX_REPORT,
     OE_ECALL_VIRTUAL_EXCEPTION_HANDLER,
     OE_ECALL_LOG_INIT,
+    OE_ECALL_INIT_CONTEXT_SWITCHLESS,
+    OE_ECALL_LAUNCH_ENCLAVE_WORKER,
+    OE_ECALL_GET_ENCLAVE_STATUS,
+    OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH,
     /* Caution: always add new ECALL function numbers here */
 
     OE_OCALL_CALL_HOST = OE_OCALL_BASE,
@@ -98,6 +102,12 @@ typedef enum _oe_func
     OE_OCALL_GET_TIME,
     OE_OCALL_BACKTRACE_SYMBOLS,
     OE_OCALL_LOG,
+    OE_OCALL_WAKE_HOST_WORKER,
+    OE_OCALL_WAIT_ENCLAVE_WORKER,
+    OE_OCALL_GET_QUOTE_V2,
+    OE_OCALL_DRAIN_LOG,
+    OE_OCALL_START_SHARED_CLOCK,
+    OE_OCALL_GROW_OCALL_ARENA,
     /* Caution: always add new OCALL function numbers here */
 
     __OE_FUNC_MAX = OE_ENUM_MAX,
@@ -224,6 +234,23 @@ typedef struct _oe_call_enclave_function_args
     oe_result_t result;
 } oe_call_enclave_function_args_t;
 
+/*
+**==============================================================================
+**
+** oe_call_enclave_function_batch_args_t
+**
+**     The calls of a batch lie in host memory and have the layout of
+**     oe_enclave_function_call_t (see <openenclave/edger8r/host.h>).
+**
+**==============================================================================
+*/
+
+typedef struct _oe_call_enclave_function_batch_args
+{
+    oe_call_enclave_function_args_t* calls;
+    uint64_t num_calls;
+} oe_call_enclave_function_batch_args_t;
+
 /*
 **==============================================================================
 **
@@ -346,14 +373,26 @@ typedef struct _oe_realloc_args
 **     Runtime state to initialize enclave state with, includes
 **     - First 8 leaves of CPUID for enclave emulation
 **     - Enclave handle obtained by oe_create_enclave()
+**     - Untrusted arenas for OCALL buffers, one per TCS
+**     - Shared clock page refreshed by the host
 **
 **==============================================================================
 */
 
+/* Size of the untrusted arena the host maps for each TCS */
+#define OE_OCALL_ARENA_SIZE (64 * 1024)
+
+/* Largest size an arena may grow to with OE_OCALL_GROW_OCALL_ARENA */
+#define OE_OCALL_ARENA_MAX_SIZE (1024 * 1024)
+
 typedef struct _oe_init_enclave_args
 {
     uint32_t cpuid_table[OE_CPUID_LEAF_COUNT][OE_CPUID_REG_COUNT];
     oe_enclave_t* enclave;
+    void* ocall_arenas;
+    size_t ocall_arena_size;
+    size_t num_ocall_arenas;
+    const void* shared_clock;
 } oe_init_enclave_args_t;
 
 /*
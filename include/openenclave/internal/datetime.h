@@ -45,6 +45,11 @@ oe_result_t oe_datetime_from_string(
     size_t str_length,
     oe_datetime_t* issue_date);
 
+/**
+ * Get the current UTC time (from oe_get_time()).
+ */
+oe_result_t oe_datetime_now(oe_datetime_t* datetime);
+
 /**
  * Compare given datetime values.
  */
@@ -222,9 +222,9 @@ typedef struct
 } elf64_rela_t;
 
 #define ELF_MAGIC 0x7d7ad33b
-#define ELF64_INIT         \
-    {                      \
-        ELF_MAGIC, NULL, 0 \
+#define ELF64_INIT                \
+    {                             \
+        ELF_MAGIC, NULL, 0, 0, -1 \
     }
 
 typedef struct
@@ -237,10 +237,20 @@ typedef struct
 
     /* File image size */
     size_t size;
+
+    /* Size of the private mapping of the file that data points to, or zero
+     * if data is on the heap (see elf64_load()) */
+    size_t mapped_size;
+
+    /* Descriptor of the mapped file (valid only if mapped_size is not zero) */
+    int fd;
 } elf64_t;
 
 int elf64_test_header(const elf64_ehdr_t* header);
 
+/* Load the ELF file at path. On Linux, the file is mapped copy-on-write
+ * rather than read, so pages are only read when accessed and only copied
+ * when written. */
 int elf64_load(const char* path, elf64_t* elf);
 
 int elf64_unload(elf64_t* elf);
@@ -250,6 +260,11 @@ int elf64_get_dynamic_symbol_table(
     const elf64_sym_t** symtab,
     size_t* size);
 
+int elf64_get_symbol_table(
+    const elf64_t* elf,
+    const elf64_sym_t** symtab,
+    size_t* size);
+
 void elf64_dump_header(const elf64_ehdr_t* ehdr);
 
 void elf64_dump_shdr(const elf64_shdr_t* sh, size_t index);
@@ -11,6 +11,21 @@ OE_EXTERNC_BEGIN
 
 int oe_host_write(int device, const char* str, size_t size);
 
+/* A buffer to be written by oe_host_writev(), laid out like struct iovec */
+typedef struct _oe_host_iovec
+{
+    const void* base;
+    size_t size;
+} oe_host_iovec_t;
+
+/**
+ * Write the concatenation of the given buffers to the host's stdout (device 0)
+ * or stderr (device 1) with a single OCALL.
+ *
+ * @returns 0 on success and -1 on failure.
+ */
+int oe_host_writev(int device, const oe_host_iovec_t* iov, size_t iovcnt);
+
 int oe_host_vfprintf(int device, const char* fmt, oe_va_list ap_);
 
 /**
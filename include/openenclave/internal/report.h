@@ -49,6 +49,25 @@ typedef struct _oe_get_quote_args
     uint8_t quote[1];
 } oe_get_quote_args_t;
 
+/*
+**==============================================================================
+**
+** oe_get_quote_v2_args_t
+**
+**     Like oe_get_quote_args_t, except that the host allocates the quote
+**     buffer, so that the quote is generated once without knowing its size
+**     beforehand. The enclave must free the quote with oe_host_free.
+**
+**==============================================================================
+*/
+typedef struct _oe_get_quote_v2_args
+{
+    oe_result_t result;      /* out */
+    sgx_report_t sgx_report; /* in */
+    uint8_t* quote;          /* out */
+    size_t quote_size;       /* out */
+} oe_get_quote_v2_args_t;
+
 /*
 **==============================================================================
 **
@@ -59,6 +59,10 @@ struct _oe_sgx_load_context
 
     /* Hash context used to measure enclave as it is loaded */
     oe_sha256_context_t hash_context;
+
+    /* MRENCLAVE of the enclave if it is already known, in which case the
+     * pages are not measured as they are loaded (simulation mode only) */
+    const OE_SHA256* mrenclave;
 };
 
 oe_result_t oe_sgx_initialize_load_context(
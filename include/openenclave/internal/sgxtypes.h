@@ -554,7 +554,7 @@ oe_thread_data_t* oe_get_thread_data(void);
 
 #define TD_MAGIC 0xc90afe906c5d19a3
 
-#define OE_THREAD_LOCAL_SPACE (3840)
+#define OE_THREAD_LOCAL_SPACE (3760)
 
 typedef struct _callsite Callsite;
 
@@ -595,6 +595,27 @@ typedef struct _td
     /* Simulation mode is active if non-zero */
     uint64_t simulate;
 
+    /* Untrusted arena of this TCS for OCALL buffers (see arena.c) */
+    uint64_t ocall_arena_base;
+    uint64_t ocall_arena_size;
+    uint64_t ocall_arena_used;
+    uint64_t ocall_arena_count;
+
+    /* Number of OCALLs in progress (non-zero while the thread is outside) */
+    volatile uint64_t ocall_depth;
+
+    /* Wake-up state used by the enclave thread library (see thread.c) */
+    volatile uint32_t wait_state;
+    uint32_t __reserved;
+
+    /* Small-block cache of this TCS used by oe_malloc() (see malloc.c) */
+    uint64_t malloc_cache;
+
+    /* Reusable ECALL marshaling buffer of this TCS (see calls.c) */
+    uint64_t ecall_buffer;
+    uint64_t ecall_buffer_size;
+    uint64_t ecall_buffer_in_use;
+
     /* Reserved for thread-local variables. */
     uint8_t thread_local_data[OE_THREAD_LOCAL_SPACE];
 } td_t;
@@ -0,0 +1,123 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _OE_INTERNAL_SWITCHLESS_H
+#define _OE_INTERNAL_SWITCHLESS_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/types.h>
+#include <openenclave/internal/calls.h>
+
+OE_EXTERNC_BEGIN
+
+/*
+**==============================================================================
+**
+** Switchless calls
+**
+**     The host starts a number of worker threads that poll for requests
+**     posted by the enclave in untrusted memory. The enclave posts an
+**     oe_call_host_function_args_t to the call_arg slot of an idle worker
+**     (compare-and-swap from NULL) and spins until the worker writes the
+**     result, without leaving the enclave. When every worker is busy, the
+**     enclave falls back to a regular OCALL.
+**
+**     A worker that stays idle for OE_HOST_WORKER_SPIN_COUNT_THRESHOLD polls
+**     parks itself by setting event to -1 and waiting on it. An enclave that
+**     posts to a parked worker wakes it with OE_OCALL_WAKE_HOST_WORKER.
+**
+**     Switchless ECALLs work the other way around: the host launches enclave
+**     workers with OE_ECALL_LAUNCH_ENCLAVE_WORKER, each of which stays inside
+**     the enclave on its own TCS and polls the call_arg slot of its context
+**     for an oe_call_enclave_function_args_t posted by the host. An idle
+**     enclave worker parks itself with OE_OCALL_WAIT_ENCLAVE_WORKER and the
+**     host wakes it directly.
+**
+**==============================================================================
+*/
+
+#define OE_HOST_WORKER_SPIN_COUNT_THRESHOLD (1UL << 20)
+#define OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD (1UL << 20)
+
+/* Value of oe_call_host_function_args_t.result while the call is pending */
+#define OE_SWITCHLESS_CALL_PENDING __OE_RESULT_MAX
+
+/* How the host wakes and stops a worker, the first member of both kinds of
+ * worker contexts */
+typedef struct _oe_switchless_worker
+{
+    /* Zero while the worker is running, (uint32_t)-1 while it is parked */
+    volatile uint32_t event;
+
+    /* Set by the host when the worker must exit */
+    volatile uint32_t is_stopping;
+} oe_switchless_worker_t;
+
+typedef struct _oe_host_worker_context
+{
+    oe_switchless_worker_t worker;
+
+    /* The call posted by the enclave or NULL if the worker is idle */
+    oe_call_host_function_args_t* volatile call_arg;
+
+    /* The enclave whose OCALL table is used to dispatch the call */
+    oe_enclave_t* enclave;
+
+    /* Statistics */
+    uint64_t total_spin_count;
+    uint64_t total_call_count;
+} oe_host_worker_context_t;
+
+typedef struct _oe_enclave_worker_context
+{
+    oe_switchless_worker_t worker;
+
+    /* The call posted by the host or NULL if the worker is idle */
+    oe_call_enclave_function_args_t* volatile call_arg;
+
+    /* The enclave that runs the worker */
+    oe_enclave_t* enclave;
+
+    /* Set by the enclave while the worker runs its dispatch loop */
+    volatile uint32_t is_running;
+
+    /* Statistics */
+    uint64_t total_spin_count;
+    uint64_t total_call_count;
+} oe_enclave_worker_context_t;
+
+typedef struct _oe_switchless_call_manager
+{
+    oe_host_worker_context_t* host_worker_contexts;
+    size_t num_host_workers;
+    oe_enclave_worker_context_t* enclave_worker_contexts;
+    size_t num_enclave_workers;
+} oe_switchless_call_manager_t;
+
+typedef struct _oe_switchless_stats
+{
+    uint64_t host_worker_calls;
+    uint64_t enclave_worker_calls;
+} oe_switchless_stats_t;
+
+/**
+ * Obtains switchless call statistics of an enclave (host only).
+ *
+ * The counts are the OCALLs serviced by the host workers and the ECALLs
+ * serviced by the enclave workers so far. Calls that fell back to regular
+ * OCALLs or ECALLs are not counted, and both counts are zero for an enclave
+ * created without switchless workers.
+ *
+ * @param enclave[in] the enclave
+ * @param stats[out] the switchless call statistics
+ *
+ * @return OE_OK on success
+ * @return OE_INVALID_PARAMETER if an argument is null
+ */
+oe_result_t oe_get_switchless_stats(
+    oe_enclave_t* enclave,
+    oe_switchless_stats_t* stats);
+
+OE_EXTERNC_END
+
+#endif /* _OE_INTERNAL_SWITCHLESS_H */
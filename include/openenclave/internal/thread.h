@@ -22,6 +22,10 @@ typedef struct _oe_thread_wake_wait_args
     const void* self_tcs;
 } oe_thread_wake_wait_args_t;
 
+/* Default number of iterations that a blocked enclave thread spins before
+ * asking the host to wait (see oe_thread_set_spin_count()) */
+#define OE_THREAD_DEFAULT_SPIN_COUNT 256
+
 #ifdef _OE_ENCLAVE_H
 OE_EXTERNC_BEGIN
 
@@ -225,8 +229,9 @@ oe_result_t oe_mutex_init(oe_mutex_t* mutex);
  *
  * This function acquires a lock on a mutex.
  *
- * For enclaves, oe_mutex_lock() performs an OCALL to wait for the mutex to
- * be signaled.
+ * For enclaves, oe_mutex_lock() first spins while the mutex is held by a
+ * thread running in the enclave, then performs an OCALL to wait for the mutex
+ * to be signaled. See oe_thread_set_spin_count().
  *
  * @param mutex Acquire a lock on this mutex.
  *
@@ -259,7 +264,7 @@ oe_result_t oe_mutex_trylock(oe_mutex_t* mutex);
  * oe_mutex_lock() or oe_mutex_trylock().
  *
  * In enclaves, this function performs an OCALL, where it wakes the next
- * thread waiting on a mutex.
+ * thread waiting on a mutex, unless that thread is still spinning.
  *
  * @param mutex Release the lock on this mutex.
  *
@@ -638,6 +643,28 @@ oe_result_t oe_thread_setspecific(oe_thread_key_t key, const void* value);
  */
 void* oe_thread_getspecific(oe_thread_key_t key);
 
+/**
+ * Set the number of spin iterations for enclave synchronization primitives.
+ *
+ * A thread that blocks in oe_mutex_lock(), oe_cond_wait(), oe_rwlock_rdlock()
+ * or oe_rwlock_wrlock() spins with the pause instruction for up to this many
+ * iterations, as long as the thread it waits for is running in the enclave,
+ * before it performs an OCALL to wait on the host. A waiter that is woken
+ * while spinning also spares the waker an OCALL. Zero disables spinning.
+ *
+ * @param spin_count The number of iterations.
+ */
+void oe_thread_set_spin_count(uint64_t spin_count);
+
+/**
+ * Get the number of wait and wake OCALLs performed by the enclave
+ * synchronization primitives since the enclave was created.
+ *
+ * @param num_waits Receives the number of wait OCALLs (may be null).
+ * @param num_wakes Receives the number of wake OCALLs (may be null).
+ */
+void oe_thread_get_ocall_counts(uint64_t* num_waits, uint64_t* num_wakes);
+
 OE_EXTERNC_END
 
 #endif //_OE_ENCLAVE_H
@@ -30,11 +30,82 @@ int oe_sleep(uint64_t milliseconds);
 **
 **     The Epoch is defined as: 1970-01-01 00:00:00 +0000 (UTC)
 **
+**     In an enclave with a shared clock page (see below), this time and the
+**     ones from oe_get_realtime_ns() and oe_get_monotonic_ns() only change
+**     when the host refreshes the page. Their resolution is therefore
+**     OE_SHARED_CLOCK_UPDATE_INTERVAL (1 ms), and they may be that much
+**     behind the host's clocks, even though they are in nanoseconds.
+**
 **==============================================================================
 */
 
 uint64_t oe_get_time(void);
 
+/*
+**==============================================================================
+**
+** oe_shared_clock_t
+**
+**     Clock page in host memory that a host thread refreshes every
+**     OE_SHARED_CLOCK_UPDATE_INTERVAL milliseconds, so that the enclave can
+**     read the time without an OCALL. The thread is started by the
+**     OE_OCALL_START_SHARED_CLOCK OCALL the first time the enclave reads the
+**     time, so enclaves that never do so cost no wakeups. The OCALL returns
+**     zero in arg_out on success. The host makes sequence odd while it
+**     updates the page; a reader retries until it sees the same even sequence
+**     before and after reading the times. A sequence of zero means the page
+**     has not been published yet.
+**
+**==============================================================================
+*/
+
+#define OE_SHARED_CLOCK_UPDATE_INTERVAL 1
+
+typedef struct _oe_shared_clock
+{
+    volatile uint64_t sequence;
+
+    /* Nanoseconds elapsed since the Epoch */
+    volatile uint64_t realtime_ns;
+
+    /* Nanoseconds elapsed since an unspecified starting point */
+    volatile uint64_t monotonic_ns;
+} oe_shared_clock_t;
+
+/*
+**==============================================================================
+**
+** oe_set_shared_clock()
+** oe_get_realtime_ns()
+** oe_get_monotonic_ns()
+**
+**     Enclave: read the time from the shared clock page passed by the host,
+**     or with an OE_OCALL_GET_TIME OCALL if there is none. The monotonic time
+**     never goes backwards, even if the host-supplied value does. Both return
+**     (uint64_t)-1 on error. The unit is nanoseconds, but the resolution is
+**     that of the page (see oe_get_time()) or of the OCALL (milliseconds).
+**
+**==============================================================================
+*/
+
+void oe_set_shared_clock(const oe_shared_clock_t* clock);
+
+uint64_t oe_get_realtime_ns(void);
+
+uint64_t oe_get_monotonic_ns(void);
+
+/*
+**==============================================================================
+**
+** oe_update_shared_clock()
+**
+**     Host: publish the current time to the given shared clock page.
+**
+**==============================================================================
+*/
+
+void oe_update_shared_clock(oe_shared_clock_t* clock);
+
 OE_EXTERNC_END
 
 #endif /* _OE_INCLUDE_TIME_H */
@@ -7,6 +7,7 @@
 #include <openenclave/bits/defs.h>
 #include <openenclave/bits/result.h>
 #include <openenclave/bits/types.h>
+#include <openenclave/internal/defs.h>
 
 typedef enum _log_level_
 {
@@ -23,11 +24,84 @@ typedef enum _log_level_
 #define OE_LOG_MESSAGE_LEN_MAX 2048U
 #define MAX_FILENAME_LEN 256U
 
+/*
+**==============================================================================
+**
+** oe_log_ring_t
+**
+**     Ring of log records in host memory, shared by all threads of an
+**     enclave. A thread reserves space by advancing head with a
+**     compare-and-swap, sets the size of the record with
+**     OE_LOG_RECORD_PENDING, copies its record into data[] and then sets the
+**     plain size, which marks it complete. A host thread drains complete
+**     records in order, zeroes them and advances tail. When the ring is full,
+**     the enclave drains it with OE_OCALL_DRAIN_LOG.
+**
+**     A record that stays incomplete for OE_LOG_RING_STALL_TIMEOUT
+**     milliseconds (e.g. because its thread was aborted) is skipped. If its
+**     size was not even set, all the records reserved so far are skipped.
+**
+**     head and tail count bytes since the ring was created and wrap around;
+**     their offset in data[] is taken modulo OE_LOG_RING_SIZE. Records start
+**     at multiples of 8 bytes but may wrap around the end of data[].
+**
+**==============================================================================
+*/
+
+/* Size of the data of the ring (a power of two) */
+#define OE_LOG_RING_SIZE (64U * 1024U)
+
+/* Flag of the size of a record that is being written */
+#define OE_LOG_RECORD_PENDING 0x80000000U
+
+/* Milliseconds after which the host skips an incomplete record */
+#define OE_LOG_RING_STALL_TIMEOUT 1000
+
+typedef struct _oe_log_record
+{
+    /* Size of the record including the message, rounded up to a multiple of
+     * 8 bytes. Zero until the space is reserved, then flagged with
+     * OE_LOG_RECORD_PENDING until the record is complete. */
+    uint32_t size;
+
+    /* The log_level_t of the record */
+    uint32_t level;
+
+    /* Time the record was written in nanoseconds since the Epoch, or
+     * (uint64_t)-1 if the enclave could not get the time */
+    uint64_t realtime_ns;
+
+    /* Identifier of the enclave thread that wrote the record */
+    uint64_t thread_id;
+
+    /* Length of the message that follows the record (not zero-terminated) */
+    uint32_t message_size;
+    uint32_t reserved;
+} oe_log_record_t;
+
+OE_STATIC_ASSERT(sizeof(oe_log_record_t) == 32);
+
+typedef struct _oe_log_ring
+{
+    /* Bytes reserved by the enclave */
+    volatile uint32_t head;
+    uint8_t padding1[60];
+
+    /* Bytes drained by the host */
+    volatile uint32_t tail;
+    uint8_t padding2[60];
+
+    uint8_t data[OE_LOG_RING_SIZE];
+} oe_log_ring_t;
+
 typedef struct _oe_log_filter
 {
     const char* path;
     uint64_t path_len;
     log_level_t level;
+
+    /* The ring to write records to or NULL to log with OE_OCALL_LOG */
+    oe_log_ring_t* ring;
 } oe_log_filter_t;
 
 typedef struct _oe_log_args
@@ -47,6 +121,8 @@ OE_EXTERNC_END
 #include <stdio.h>
 OE_EXTERNC_BEGIN
 oe_result_t oe_log_enclave_init(oe_enclave_t* enclave);
+void oe_log_enclave_terminate(oe_enclave_t* enclave);
+void oe_drain_log_ring(oe_enclave_t* enclave);
 void oe_log(log_level_t level, const char* fmt, ...);
 log_level_t get_current_logging_level(void);
 void log_message(bool is_enclave, oe_log_args_t* args);
@@ -25,9 +25,8 @@
 static oe_syscall_hook_t _hook;
 static oe_spinlock_t _lock;
 
-static const uint64_t _SEC_TO_MSEC = 1000UL;
-static const uint64_t _MSEC_TO_USEC = 1000UL;
-static const uint64_t _MSEC_TO_NSEC = 1000000UL;
+static const uint64_t _SEC_TO_NSEC = 1000000000UL;
+static const uint64_t _USEC_TO_NSEC = 1000UL;
 
 static long
 _syscall_open(long n, long x1, long x2, long x3, long x4, long x5, long x6)
@@ -126,38 +125,90 @@ _syscall_writev(long n, long x1, long x2, long x3, long x4, long x5, long x6)
     }
 
     for (unsigned long i = 0; i < iovcnt; i++)
-    {
-        oe_host_write(device, iov[i].iov_base, iov[i].iov_len);
         ret += iov[i].iov_len;
-    }
+
+    /* Write the buffered data and the new data of the stream together */
+    if (oe_host_writev(device, (const oe_host_iovec_t*)iov, iovcnt) != 0)
+        return -EIO;
 
     return ret;
 }
 
+/*
+**==============================================================================
+**
+** Buffering of stdout and stderr
+**
+**     Every write to the host takes an OCALL, so the enclave relies on the
+**     buffering of the standard streams to write whole lines or buffers at
+**     once. stdout is line buffered and stderr, which is unbuffered by
+**     default, is made line buffered too. An enclave may select full
+**     buffering and the size of the buffer with setvbuf(), e.g.
+**
+**         static char buffer[64 * 1024];
+**         setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+**
+**     Buffered data is written when the buffer fills up, on fflush() and when
+**     the enclave is terminated.
+**
+**==============================================================================
+*/
+
+OE_STATIC_ASSERT(sizeof(oe_host_iovec_t) == sizeof(struct iovec));
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_host_iovec_t, base) == OE_OFFSETOF(struct iovec, iov_base));
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_host_iovec_t, size) == OE_OFFSETOF(struct iovec, iov_len));
+
+static char _stderr_buffer[BUFSIZ];
+
+__attribute__((constructor)) static void _init_stdio(void)
+{
+    setvbuf(stderr, _stderr_buffer, _IOLBF, sizeof(_stderr_buffer));
+}
+
+__attribute__((destructor)) static void _flush_stdio(void)
+{
+    fflush(NULL);
+}
+
 static long _syscall_clock_gettime(long n, long x1, long x2)
 {
     clockid_t clk_id = (clockid_t)x1;
     struct timespec* tp = (struct timespec*)x2;
     int ret = -1;
-    uint64_t msec;
+    uint64_t nsec;
 
     OE_UNUSED(n);
 
     if (!tp)
         goto done;
 
-    if (clk_id != CLOCK_REALTIME)
+    switch (clk_id)
     {
-        /* Only supporting CLOCK_REALTIME */
-        oe_assert("clock_gettime(): panic" == NULL);
-        goto done;
+        case CLOCK_REALTIME:
+        case CLOCK_REALTIME_COARSE:
+            nsec = oe_get_realtime_ns();
+            break;
+
+        case CLOCK_MONOTONIC:
+        case CLOCK_MONOTONIC_RAW:
+        case CLOCK_MONOTONIC_COARSE:
+        case CLOCK_BOOTTIME:
+            nsec = oe_get_monotonic_ns();
+            break;
+
+        default:
+            /* Only supporting the realtime and monotonic clocks */
+            oe_assert("clock_gettime(): panic" == NULL);
+            goto done;
     }
 
-    if ((msec = oe_get_time()) == (uint64_t)-1)
+    if (nsec == (uint64_t)-1)
         goto done;
 
-    tp->tv_sec = msec / _SEC_TO_MSEC;
-    tp->tv_nsec = (msec % _SEC_TO_MSEC) * _MSEC_TO_NSEC;
+    tp->tv_sec = nsec / _SEC_TO_NSEC;
+    tp->tv_nsec = nsec % _SEC_TO_NSEC;
 
     ret = 0;
 
@@ -171,7 +222,7 @@ static long _syscall_gettimeofday(long n, long x1, long x2)
     struct timeval* tv = (struct timeval*)x1;
     void* tz = (void*)x2;
     int ret = -1;
-    uint64_t msec;
+    uint64_t nsec;
 
     OE_UNUSED(n);
 
@@ -184,11 +235,11 @@ static long _syscall_gettimeofday(long n, long x1, long x2)
     if (!tv)
         goto done;
 
-    if ((msec = oe_get_time()) == (uint64_t)-1)
+    if ((nsec = oe_get_realtime_ns()) == (uint64_t)-1)
         goto done;
 
-    tv->tv_sec = msec / _SEC_TO_MSEC;
-    tv->tv_usec = msec % _MSEC_TO_USEC;
+    tv->tv_sec = nsec / _SEC_TO_NSEC;
+    tv->tv_usec = (nsec % _SEC_TO_NSEC) / _USEC_TO_NSEC;
 
     ret = 0;
 
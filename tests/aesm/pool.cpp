@@ -0,0 +1,304 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/aesm.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+**==============================================================================
+**
+** Mock AESM service
+**
+**     Serves the requests of host/sgx/linux/aesm.c on a UNIX socket: each
+**     request is a 32-bit size followed by an envelope whose tag holds the
+**     message type. Responses carry errcode 0 and fixed payloads.
+**
+**==============================================================================
+*/
+
+#define MESSAGE_TYPE_INIT_QUOTE 1
+#define MESSAGE_TYPE_GET_QUOTE 2
+#define MESSAGE_TYPE_GET_LAUNCH_TOKEN 3
+
+#define TEST_QUOTE_SIZE 1024
+
+static std::atomic<uint32_t> _num_connections;
+static std::atomic<uint32_t> _num_requests;
+
+/* Close each connection after this many requests (0 means never) */
+static std::atomic<uint32_t> _requests_per_connection;
+
+static bool _read(int sock, void* data, size_t size)
+{
+    uint8_t* p = (uint8_t*)data;
+
+    while (size > 0)
+    {
+        ssize_t n = read(sock, p, size);
+
+        if (n <= 0)
+            return false;
+
+        p += n;
+        size -= (size_t)n;
+    }
+
+    return true;
+}
+
+static void _pack_varint(std::string& s, uint32_t x)
+{
+    while (x >= 0x80)
+    {
+        s += (char)(x | 0x80);
+        x >>= 7;
+    }
+
+    s += (char)x;
+}
+
+static void _pack_bytes(std::string& s, uint8_t field, size_t size, char c)
+{
+    s += (char)((field << 3) | 2);
+    _pack_varint(s, (uint32_t)size);
+    s.append(size, c);
+}
+
+static std::string _make_response(uint8_t type)
+{
+    std::string message;
+
+    /* errcode = 0 */
+    message += (char)(1 << 3);
+    message += (char)0;
+
+    switch (type)
+    {
+        case MESSAGE_TYPE_INIT_QUOTE:
+            _pack_bytes(message, 2, sizeof(sgx_target_info_t), 'T');
+            _pack_bytes(message, 3, sizeof(sgx_epid_group_id_t), 'G');
+            break;
+        case MESSAGE_TYPE_GET_QUOTE:
+            _pack_bytes(message, 2, TEST_QUOTE_SIZE, 'Q');
+            break;
+        case MESSAGE_TYPE_GET_LAUNCH_TOKEN:
+            _pack_bytes(message, 2, sizeof(sgx_launch_token_t), 'L');
+            break;
+    }
+
+    std::string envelope;
+    envelope += (char)((type << 3) | 2);
+    _pack_varint(envelope, (uint32_t)message.size());
+    envelope += message;
+
+    uint32_t size = (uint32_t)envelope.size();
+    return std::string((const char*)&size, sizeof(size)) + envelope;
+}
+
+static void _serve(int sock)
+{
+    uint32_t num_requests = 0;
+    uint32_t size;
+    std::vector<uint8_t> envelope;
+
+    while (_read(sock, &size, sizeof(size)))
+    {
+        envelope.resize(size);
+
+        if (size == 0 || !_read(sock, envelope.data(), size))
+            break;
+
+        std::string response = _make_response(envelope[0] >> 3);
+        _num_requests++;
+
+        if (send(sock, response.data(), response.size(), MSG_NOSIGNAL) !=
+            (ssize_t)response.size())
+            break;
+
+        uint32_t limit = _requests_per_connection;
+        if (limit && ++num_requests == limit)
+            break;
+    }
+
+    close(sock);
+}
+
+static void _listen(int listener)
+{
+    int sock;
+
+    while ((sock = accept(listener, NULL, NULL)) >= 0)
+    {
+        _num_connections++;
+        std::thread(_serve, sock).detach();
+    }
+}
+
+/*
+**==============================================================================
+**
+** Tests
+**
+**==============================================================================
+*/
+
+static void _init_quote(void)
+{
+    aesm_t* aesm = aesm_acquire();
+    OE_TEST(aesm != NULL);
+
+    sgx_target_info_t target_info;
+    sgx_epid_group_id_t epid_group_id;
+    OE_TEST(aesm_init_quote(aesm, &target_info, &epid_group_id) == OE_OK);
+    OE_TEST(((uint8_t*)&target_info)[0] == 'T');
+    OE_TEST(((uint8_t*)&epid_group_id)[0] == 'G');
+
+    aesm_release(aesm);
+}
+
+static void _reset(uint32_t requests_per_connection)
+{
+    aesm_clear_pool();
+    _requests_per_connection = requests_per_connection;
+    _num_connections = 0;
+    _num_requests = 0;
+}
+
+static void _test_reuse(void)
+{
+    _reset(0);
+
+    for (uint32_t i = 0; i < 100; i++)
+        _init_quote();
+
+    /* Every request went over the same connection */
+    OE_TEST(_num_connections == 1);
+    OE_TEST(_num_requests == 100);
+
+    /* Other request types share the connection and its buffers */
+    aesm_t* aesm = aesm_acquire();
+    OE_TEST(aesm != NULL);
+
+    static uint8_t quote[TEST_QUOTE_SIZE];
+    sgx_report_t report = {};
+    sgx_spid_t spid = {};
+    OE_TEST(
+        aesm_get_quote(
+            aesm,
+            &report,
+            SGX_QUOTE_TYPE_UNLINKABLE_SIGNATURE,
+            &spid,
+            NULL,
+            NULL,
+            0,
+            NULL,
+            (sgx_quote_t*)quote,
+            sizeof(quote)) == OE_OK);
+    OE_TEST(quote[0] == 'Q' && quote[sizeof(quote) - 1] == 'Q');
+
+    uint8_t mrenclave[OE_SHA256_SIZE] = {};
+    uint8_t modulus[OE_KEY_SIZE] = {};
+    sgx_attributes_t attributes = {};
+    sgx_launch_token_t token;
+    OE_TEST(
+        aesm_get_launch_token(
+            aesm, mrenclave, modulus, &attributes, &token) == OE_OK);
+    OE_TEST(((uint8_t*)&token)[0] == 'L');
+
+    aesm_release(aesm);
+    OE_TEST(_num_connections == 1);
+
+    printf("=== passed %s()\n", __FUNCTION__);
+}
+
+static void _test_reconnect(void)
+{
+    /* The service closes every connection after 3 requests */
+    _reset(3);
+
+    for (uint32_t i = 0; i < 30; i++)
+        _init_quote();
+
+    OE_TEST(_num_requests == 30);
+    OE_TEST(_num_connections == 10);
+
+    printf("=== passed %s()\n", __FUNCTION__);
+}
+
+static void _test_unavailable(const char* path)
+{
+    OE_TEST(aesm_set_socket_path("/nonexistent/aesm.socket") == OE_OK);
+    OE_TEST(aesm_acquire() == NULL);
+    OE_TEST(aesm_set_socket_path(path) == OE_OK);
+
+    printf("=== passed %s()\n", __FUNCTION__);
+}
+
+static void _test_concurrency(void)
+{
+    const uint32_t num_threads = 8;
+    const uint32_t iterations = 200;
+    std::vector<std::thread> threads;
+
+    _reset(0);
+
+    for (uint32_t i = 0; i < num_threads; i++)
+    {
+        threads.push_back(std::thread([iterations]() {
+            for (uint32_t j = 0; j < iterations; j++)
+                _init_quote();
+        }));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    /* A connection is only opened when every pooled one is in use */
+    OE_TEST(_num_requests == num_threads * iterations);
+    OE_TEST(_num_connections <= num_threads);
+
+    printf("=== passed %s()\n", __FUNCTION__);
+}
+
+int main()
+{
+    char dir[] = "/tmp/oe_aesm_pool_XXXXXX";
+    OE_TEST(mkdtemp(dir) != NULL);
+    std::string path = std::string(dir) + "/aesm.socket";
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    OE_TEST(listener >= 0);
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    OE_TEST(path.size() < sizeof(addr.sun_path));
+    strcpy(addr.sun_path, path.c_str());
+    OE_TEST(bind(listener, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    OE_TEST(listen(listener, 16) == 0);
+    std::thread(_listen, listener).detach();
+
+    OE_TEST(aesm_set_socket_path(path.c_str()) == OE_OK);
+
+    _test_reuse();
+    _test_reconnect();
+    _test_unavailable(path.c_str());
+    _test_concurrency();
+
+    aesm_clear_pool();
+    unlink(path.c_str());
+    rmdir(dir);
+
+    printf("=== passed all tests (aesm_pool)\n");
+    return 0;
+}
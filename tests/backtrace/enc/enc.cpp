@@ -99,6 +99,18 @@ extern "C" bool test(size_t num_syms, const char** syms)
     char** _syms = oe_backtrace_symbols(b.buffer, b.size);
     OE_TEST(_syms != NULL);
 
+    /* Later calls are served by the symbolizer cached by the host */
+    for (int i = 0; i < 100; i++)
+    {
+        char** cached_syms = oe_backtrace_symbols(b.buffer, b.size);
+        OE_TEST(cached_syms != NULL);
+
+        for (int j = 0; j < b.size; j++)
+            OE_TEST(strcmp(_syms[j], cached_syms[j]) == 0);
+
+        oe_host_free(cached_syms);
+    }
+
     _print_backtrace(b.buffer, (size_t)b.size, num_syms, syms);
 #endif
 
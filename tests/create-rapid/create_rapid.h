@@ -0,0 +1,11 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef _CREATE_RAPID_H
+#define _CREATE_RAPID_H
+
+/* Size of the enclave used by the page-add benchmark (64 MB of heap) */
+#define CREATE_RAPID_BENCHMARK_HEAP_PAGES 16384
+#define CREATE_RAPID_BENCHMARK_STACK_PAGES 256
+
+#endif /* _CREATE_RAPID_H */
@@ -2,6 +2,7 @@
 // Licensed under the MIT License.
 
 #include <openenclave/enclave.h>
+#include "../create_rapid.h"
 #include "create_rapid_t.h"
 
 int test(int arg)
@@ -9,6 +10,24 @@ int test(int arg)
     return arg * 2;
 }
 
+void crash()
+{
+    oe_abort();
+}
+
+#if defined(CREATE_RAPID_BENCHMARK)
+
+/* Large heap for measuring the page-add rate (see host.cpp) */
+OE_SET_ENCLAVE_SGX(
+    1,                                  /* ProductID */
+    1,                                  /* SecurityVersion */
+    true,                               /* AllowDebug */
+    CREATE_RAPID_BENCHMARK_HEAP_PAGES,  /* HeapPageCount */
+    CREATE_RAPID_BENCHMARK_STACK_PAGES, /* StackPageCount */
+    1);                                 /* TCSCount */
+
+#else
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
@@ -16,3 +35,5 @@ OE_SET_ENCLAVE_SGX(
     128,  /* HeapPageCount */
     128,  /* StackPageCount */
     1);   /* TCSCount */
+
+#endif
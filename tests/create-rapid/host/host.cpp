@@ -5,15 +5,20 @@
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/error.h>
 #include <openenclave/internal/tests.h>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <thread>
 #include <vector>
+#include "../../../host/sgx/imagecache.h"
+#include "../create_rapid.h"
 #include "create_rapid_u.h"
 
 #define MAX_ENCLAVES 200
 #define MAX_SIMULTANEOUS_ENCLAVES 32
 #define MAX_THREADS 32
+#define BENCHMARK_ENCLAVES 10
 
 static void _launch_enclave(const char* path, uint32_t flags, bool call_enclave)
 {
@@ -140,16 +145,218 @@ static void _test_multithreaded(
         thread.join();
 }
 
+/* Enclaves built from the image cache must be the same as the first one */
+static void _test_image_cache(const char* path, uint32_t flags)
+{
+    oe_enclave_t* enclaves[2];
+
+    oe_image_cache_clear();
+
+    for (int i = 0; i < 2; i++)
+    {
+        OE_TEST(
+            oe_create_create_rapid_enclave(
+                path, OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclaves[i]) ==
+            OE_OK);
+    }
+
+    /* The second enclave shares the entry of the first one */
+    OE_TEST(enclaves[0]->image_cache_entry != NULL);
+    OE_TEST(enclaves[1]->image_cache_entry == enclaves[0]->image_cache_entry);
+    OE_TEST(
+        memcmp(&enclaves[0]->hash, &enclaves[1]->hash, sizeof(OE_SHA256)) ==
+        0);
+
+    for (int i = 0; i < 2; i++)
+    {
+        int return_value;
+        OE_TEST(test(enclaves[i], &return_value, i) == OE_OK);
+        OE_TEST(return_value == 2 * i);
+        OE_TEST(oe_terminate_enclave(enclaves[i]) == OE_OK);
+    }
+}
+
+static oe_enclave_t* _acquire(oe_enclave_pool_t* pool)
+{
+    oe_enclave_t* enclave = NULL;
+    oe_result_t result;
+
+    /* Wait for the pool threads to create an enclave if none is ready */
+    while ((result = oe_enclave_pool_acquire(pool, &enclave)) == OE_BUSY)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    OE_TEST(result == OE_OK);
+    return enclave;
+}
+
+static void _test_pool(const char* path, uint32_t flags)
+{
+    oe_enclave_pool_t* pool = NULL;
+    oe_enclave_t* enclaves[4];
+
+    OE_TEST(
+        oe_create_enclave_pool(
+            oe_create_create_rapid_enclave,
+            path,
+            OE_ENCLAVE_TYPE_SGX,
+            flags,
+            NULL,
+            0,
+            2,
+            4,
+            &pool) == OE_OK);
+
+    /* Use every enclave of the pool at once */
+    for (int i = 0; i < 4; i++)
+    {
+        int return_value;
+        enclaves[i] = _acquire(pool);
+        OE_TEST(test(enclaves[i], &return_value, i) == OE_OK);
+        OE_TEST(return_value == 2 * i);
+    }
+
+    OE_TEST(oe_enclave_pool_acquire(pool, &enclaves[0]) == OE_BUSY);
+    OE_TEST(oe_terminate_enclave_pool(pool) == OE_BUSY);
+
+    for (int i = 0; i < 4; i++)
+        OE_TEST(oe_enclave_pool_release(pool, enclaves[i]) == OE_OK);
+
+    /* A crashed enclave is retired and replaced */
+    for (int i = 0; i < 10; i++)
+    {
+        int return_value;
+        oe_enclave_t* enclave = _acquire(pool);
+
+        OE_TEST(test(enclave, &return_value, i) == OE_OK);
+        OE_TEST(return_value == 2 * i);
+
+        if (i % 3 == 0)
+            OE_TEST(crash(enclave) == OE_ENCLAVE_ABORTING);
+
+        OE_TEST(oe_enclave_pool_release(pool, enclave) == OE_OK);
+    }
+
+    OE_TEST(oe_terminate_enclave_pool(pool) == OE_OK);
+}
+
+/* Return the time it takes to create an enclave in seconds */
+static double _create_enclave(const char* path, uint32_t flags)
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    auto start = std::chrono::steady_clock::now();
+
+    result = oe_create_create_rapid_enclave(
+        path, OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+
+    if (result != OE_OK)
+        oe_put_err("oe_create_create_rapid_enclave(): result=%u", result);
+
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+
+    result = oe_terminate_enclave(enclave);
+    if (result != OE_OK)
+        oe_put_err("oe_terminate_enclave(): result=%u", result);
+
+    return seconds;
+}
+
+/* Report how fast enclave pages are added, measured and initialized, and
+ * how long creating an enclave takes with and without the image cache */
+static void _benchmark(const char* path, uint32_t flags)
+{
+    const size_t pages_per_enclave = CREATE_RAPID_BENCHMARK_HEAP_PAGES +
+                                     CREATE_RAPID_BENCHMARK_STACK_PAGES;
+    double uncached = 0;
+    double seconds = 0;
+
+    /* The first enclave loads the image, the others use the cache */
+    for (int i = 0; i < BENCHMARK_ENCLAVES; i++)
+    {
+        oe_image_cache_clear();
+        uncached += _create_enclave(path, flags);
+    }
+
+    for (int i = 0; i < BENCHMARK_ENCLAVES; i++)
+        seconds += _create_enclave(path, flags);
+
+    /* Only heap and stack pages are counted (image pages are negligible) */
+    printf(
+        "=== create-rapid benchmark: %d enclaves of %zu pages in %.3f "
+        "seconds (%.0f pages/sec)\n",
+        BENCHMARK_ENCLAVES,
+        pages_per_enclave,
+        seconds,
+        (double)(pages_per_enclave * BENCHMARK_ENCLAVES) / seconds);
+
+    printf(
+        "=== create-rapid benchmark: create latency %.3f ms (image cached), "
+        "%.3f ms (image loaded)\n",
+        seconds * 1000 / BENCHMARK_ENCLAVES,
+        uncached * 1000 / BENCHMARK_ENCLAVES);
+
+    /* Enclaves are ready when acquired from a pool */
+    {
+        oe_enclave_pool_t* pool = NULL;
+        double acquire = 0;
+
+        OE_TEST(
+            oe_create_enclave_pool(
+                oe_create_create_rapid_enclave,
+                path,
+                OE_ENCLAVE_TYPE_SGX,
+                flags,
+                NULL,
+                0,
+                BENCHMARK_ENCLAVES,
+                BENCHMARK_ENCLAVES,
+                &pool) == OE_OK);
+
+        for (int i = 0; i < BENCHMARK_ENCLAVES; i++)
+            oe_enclave_pool_release(pool, _acquire(pool));
+
+        for (int i = 0; i < BENCHMARK_ENCLAVES; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            oe_enclave_t* enclave = _acquire(pool);
+            acquire += std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+            OE_TEST(oe_enclave_pool_release(pool, enclave) == OE_OK);
+        }
+
+        OE_TEST(oe_terminate_enclave_pool(pool) == OE_OK);
+
+        printf(
+            "=== create-rapid benchmark: pool acquire latency %.3f ms\n",
+            acquire * 1000 / BENCHMARK_ENCLAVES);
+    }
+}
+
 int main(int argc, const char* argv[])
 {
-    if (argc != 2)
+    if (argc != 2 && !(argc == 3 && strcmp(argv[2], "--benchmark") == 0))
     {
-        fprintf(stderr, "Usage: %s ENCLAVE\n", argv[0]);
+        fprintf(stderr, "Usage: %s ENCLAVE [--benchmark]\n", argv[0]);
         exit(1);
     }
 
     const uint32_t flags = oe_get_create_flags();
 
+    if (argc == 3)
+    {
+        _benchmark(argv[1], flags);
+        return 0;
+    }
+
+    // Test that enclaves built from the image cache are correct.
+    _test_image_cache(argv[1], flags);
+
+    // Test enclave pools.
+    _test_pool(argv[1], flags);
+
     // Test rapid enclave creation sequentially.
     _test_sequential(argv[1], flags, false);
     _test_sequential(argv[1], flags, true);
@@ -151,6 +151,11 @@ void enc_test(test_args* args)
     }
 }
 
+int enc_lookup(int key)
+{
+    return key * 2 + 1;
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
@@ -158,3 +163,16 @@ OE_SET_ENCLAVE_SGX(
     1024, /* HeapPageCount */
     1024, /* StackPageCount */
     2);   /* TCSCount */
+
+/* Make calls that nest through the host, alternating between two enclaves,
+ * and return the result of the innermost call */
+uint64_t enc_nest(int depth)
+{
+    uint64_t inner = 0;
+
+    if (depth == 0)
+        return OE_OK;
+
+    OE_TEST(host_nest(&inner, depth - 1) == OE_OK);
+    return inner;
+}
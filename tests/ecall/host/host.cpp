@@ -1,6 +1,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <openenclave/edger8r/host.h>
 #include <openenclave/host.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/error.h>
@@ -9,6 +10,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include "ecall_u.h"
 
 #if 0
@@ -59,6 +61,126 @@ void TestECall(oe_enclave_t* enclave)
     prev = args.thread_data.last_sp;
 }
 
+static double _elapsed_ms(clock_t start)
+{
+    return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+void TestECallBatch(oe_enclave_t* enclave)
+{
+    const size_t N = 10000;
+    static int keys[N];
+    static int retvals[N];
+    static oe_result_t results[N];
+    clock_t start;
+
+    for (size_t i = 0; i < N; i++)
+        keys[i] = (int)i;
+
+    /* One ECALL per call */
+    start = clock();
+    for (size_t i = 0; i < N; i++)
+    {
+        OE_TEST(enc_lookup(enclave, &retvals[i], keys[i]) == OE_OK);
+        OE_TEST(retvals[i] == keys[i] * 2 + 1);
+    }
+    printf("%zu ECALLs took %.1f ms\n", N, _elapsed_ms(start));
+
+    /* All calls in one ECALL */
+    memset(retvals, 0, sizeof(retvals));
+    start = clock();
+    OE_TEST(enc_lookup_batch(enclave, N, retvals, results, keys) == OE_OK);
+    printf("%zu batched ECALLs took %.1f ms\n", N, _elapsed_ms(start));
+
+    for (size_t i = 0; i < N; i++)
+    {
+        OE_TEST(results[i] == OE_OK);
+        OE_TEST(retvals[i] == keys[i] * 2 + 1);
+    }
+
+    OE_TEST(enc_lookup_batch(enclave, 0, NULL, NULL, NULL) == OE_OK);
+    OE_TEST(
+        enc_lookup_batch(enclave, 1, retvals, NULL, keys) ==
+        OE_INVALID_PARAMETER);
+
+    /* A call that fails does not stop the others */
+    {
+        const size_t size = OE_EDGER8R_BUFFER_ALIGNMENT * 4;
+        OE_STATIC_ASSERT(sizeof(enc_lookup_args_t) <= size);
+        static uint8_t in[4][size];
+        static uint8_t out[4][size];
+        oe_enclave_function_call_t calls[4];
+
+        memset(calls, 0, sizeof(calls));
+        for (size_t i = 0; i < 4; i++)
+        {
+            enc_lookup_args_t* args = (enc_lookup_args_t*)in[i];
+
+            memset(args, 0, sizeof(*args));
+            args->key = (int)i;
+            calls[i].function_id = fcn_id_enc_lookup;
+            calls[i].input_buffer = in[i];
+            calls[i].input_buffer_size = size;
+            calls[i].output_buffer = out[i];
+            calls[i].output_buffer_size = size;
+        }
+
+        /* No such function */
+        calls[1].function_id = 1000;
+
+        /* Misaligned buffer size */
+        calls[2].input_buffer_size = size - 1;
+
+        OE_TEST(oe_call_enclave_function_batch(enclave, calls, 4) == OE_OK);
+        OE_TEST(calls[0].result == OE_OK);
+        OE_TEST(calls[1].result == OE_NOT_FOUND);
+        OE_TEST(calls[2].result == OE_INVALID_PARAMETER);
+        OE_TEST(calls[3].result == OE_OK);
+        OE_TEST(((enc_lookup_args_t*)out[0])->_retval == 1);
+        OE_TEST(((enc_lookup_args_t*)out[3])->_retval == 7);
+        OE_TEST(calls[3].output_bytes_written != 0);
+        OE_TEST(calls[1].output_bytes_written == 0);
+    }
+}
+
+/* The enclaves that nested calls alternate between */
+static oe_enclave_t* _nest_enclaves[2];
+
+uint64_t host_nest(int depth)
+{
+    uint64_t inner = 0;
+    oe_result_t result = enc_nest(_nest_enclaves[depth % 2], &inner, depth);
+
+    /* Report the result of the innermost call to the outer calls */
+    if (depth == 0)
+        return result;
+
+    OE_TEST(result == OE_OK);
+    return inner;
+}
+
+/* Call A -> B -> A on one host thread. The nested call to A must be bound to
+ * the TCS that the outer call to A already runs on, where the enclave
+ * rejects it as reentrant. It would succeed on a second TCS. */
+void TestNestedECalls(oe_enclave_t* enclave, const char* path)
+{
+    const uint32_t flags = oe_get_create_flags();
+    oe_enclave_t* other = NULL;
+    uint64_t inner = 0;
+
+    OE_TEST(
+        oe_create_ecall_enclave(
+            path, OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &other) == OE_OK);
+
+    _nest_enclaves[0] = enclave;
+    _nest_enclaves[1] = other;
+
+    OE_TEST(enc_nest(enclave, &inner, 2) == OE_OK);
+    OE_TEST(inner == OE_REENTRANT_ECALL);
+
+    OE_TEST(oe_terminate_enclave(other) == OE_OK);
+}
+
 int main(int argc, const char* argv[])
 {
     oe_result_t result;
@@ -87,6 +209,12 @@ int main(int argc, const char* argv[])
         TestECall(enclave);
     }
 
+    printf("=== TestECallBatch()\n");
+    TestECallBatch(enclave);
+
+    printf("=== TestNestedECalls()\n");
+    TestNestedECalls(enclave, argv[1]);
+
     if ((result = oe_terminate_enclave(enclave)) != OE_OK)
     {
         oe_put_err("oe_terminate_enclave(): result=%u", result);
@@ -8,6 +8,7 @@
 #include <openenclave/internal/thread.h>
 #include <openenclave/internal/trace.h>
 #include <stdio.h>
+#include <string.h>
 #include <mutex>
 #include <system_error>
 #include "ecall_ocall_t.h"
@@ -141,6 +142,40 @@ void enc_set_factor(uint32_t factor)
     g_factor = factor;
 }
 
+static uint64_t _sum_buffer(const uint8_t* buffer, size_t size)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; i++)
+        sum += buffer[i];
+    return sum;
+}
+
+// Sum the buffer, which lives in the marshaling buffer of this ECALL, and
+// make a nested ECALL with a larger buffer via the host if depth is non-zero.
+uint64_t enc_sum_buffer(const uint8_t* buffer, size_t size, uint32_t depth)
+{
+    OE_TEST(oe_is_within_enclave(buffer, size));
+    uint64_t sum = _sum_buffer(buffer, size);
+
+    if (depth > 0)
+    {
+        uint64_t nested_sum = 0;
+        oe_result_t result = host_nested_sum_buffer(
+            &nested_sum, g_enclave_id, size * 2 + 1, depth - 1);
+        OE_TEST(OE_OK == result);
+
+        // The nested ECALL must not have reused the buffer of this one
+        OE_TEST(_sum_buffer(buffer, size) == sum);
+    }
+
+    return sum;
+}
+
+void enc_fill_buffer(uint8_t* buffer, size_t size, uint8_t value)
+{
+    memset(buffer, value, size);
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
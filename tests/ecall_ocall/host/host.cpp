@@ -256,6 +256,88 @@ static void test_cross_enclave_calls()
     printf("=== test_cross_enclave_calls passed\n");
 }
 
+static uint64_t _fill_buffer(std::vector<uint8_t>& buffer)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < buffer.size(); i++)
+    {
+        buffer[i] = static_cast<uint8_t>(i * 7 + buffer.size());
+        sum += buffer[i];
+    }
+    return sum;
+}
+
+// OCall handler for the nested marshaling test - make an ECALL from within
+// the OCALL, while the marshaling buffers of the outer ECALL are in use. The
+// ECALL goes to the next enclave, since the calling enclave would reject it
+// as reentrant.
+uint64_t host_nested_sum_buffer(
+    uint32_t enclave_id,
+    size_t size,
+    uint32_t depth)
+{
+    std::vector<uint8_t> buffer(size);
+    uint64_t expected_sum = _fill_buffer(buffer);
+    uint64_t sum = 0;
+    uint32_t next_id =
+        static_cast<uint32_t>((enclave_id + 1) % enclave_wrap::count());
+
+    OE_TEST(next_id != enclave_id);
+
+    oe_result_t result = enc_sum_buffer(
+        enclave_wrap::get(next_id), &sum, buffer.data(), size, depth);
+    OE_TEST(OE_OK == result);
+    OE_TEST(sum == expected_sum);
+
+    return sum;
+}
+
+// The host and enclave reuse their marshaling buffers across ECALLs. Verify
+// that shrinking and growing parameters and nested ECALLs marshal correctly.
+// The nested ECALL is made to another enclave, so at least two must exist.
+static void test_marshaling_buffers(unsigned enclave_id)
+{
+    static const size_t sizes[] = {1, 4096, 65536, 16, 32768, 65537, 100};
+
+    for (size_t size : sizes)
+    {
+        std::vector<uint8_t> buffer(size);
+        uint64_t expected_sum = _fill_buffer(buffer);
+        uint64_t sum = 0;
+
+        oe_result_t result = enc_sum_buffer(
+            enclave_wrap::get(enclave_id), &sum, buffer.data(), size, 0);
+        OE_TEST(OE_OK == result);
+        OE_TEST(sum == expected_sum);
+
+        uint8_t value = static_cast<uint8_t>(size);
+        result = enc_fill_buffer(
+            enclave_wrap::get(enclave_id), buffer.data(), size, value);
+        OE_TEST(OE_OK == result);
+        for (size_t i = 0; i < size; i++)
+            OE_TEST(buffer[i] == value);
+    }
+
+    // Make one ECALL to another enclave from an OCALL of this one, on the
+    // same host thread
+    {
+        std::vector<uint8_t> buffer(1000);
+        uint64_t expected_sum = _fill_buffer(buffer);
+        uint64_t sum = 0;
+
+        oe_result_t result = enc_sum_buffer(
+            enclave_wrap::get(enclave_id),
+            &sum,
+            buffer.data(),
+            buffer.size(),
+            1);
+        OE_TEST(OE_OK == result);
+        OE_TEST(sum == expected_sum);
+    }
+
+    printf("=== test_marshaling_buffers passed\n");
+}
+
 int main(int argc, const char* argv[])
 {
     if (argc != 2)
@@ -286,6 +368,9 @@ int main(int argc, const char* argv[])
     OE_TEST(g_init_ocall_values[1] == enc2.get_base());
     test_init_ocall_result(enc2.get_id());
 
+    // verify marshaling buffers are reused correctly
+    test_marshaling_buffers(enc1.get_id());
+
     // verify threads execute in parallel across enclaves
     test_execution_parallel({enc1.get_id(), enc2.get_id()}, THREAD_COUNT);
 
@@ -0,0 +1,31 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <openenclave/internal/trace.h>
+#include "log_ring_t.h"
+
+void enc_log(uint32_t thread_index, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        /* Every 100th record is close to the maximum size */
+        OE_TEST(
+            oe_log(
+                OE_LOG_LEVEL_INFO,
+                "log_ring %u %u %*s\n",
+                thread_index,
+                i,
+                (i % 100 == 0) ? 1800 : 10,
+                "x") == OE_OK);
+    }
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    1024, /* StackPageCount */
+    4);   /* TCSCount */
@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "log_ring_u.h"
+
+#define NUM_THREADS 4
+#define NUM_RECORDS 5000
+
+static oe_enclave_t* _enclave;
+
+static void* _log_thread(void* arg)
+{
+    uint32_t thread_index = (uint32_t)(uintptr_t)arg;
+
+    OE_TEST(enc_log(_enclave, thread_index, NUM_RECORDS) == OE_OK);
+
+    return NULL;
+}
+
+/* Check that every record of every thread was logged once and in order */
+static void _check_log_file(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    uint32_t next[NUM_THREADS] = {0};
+    static char line[4096];
+
+    OE_TEST(file != NULL);
+
+    while (fgets(line, sizeof(line), file))
+    {
+        const char* p = strstr(line, "log_ring ");
+        uint32_t thread_index;
+        uint32_t i;
+
+        if (!p)
+            continue;
+
+        /* Enclave records are prefixed with the name of the enclave */
+        OE_TEST(strstr(line, "(E)[INFO]log_ring_enc:") != NULL);
+
+        OE_TEST(sscanf(p, "log_ring %u %u", &thread_index, &i) == 2);
+        OE_TEST(thread_index < NUM_THREADS);
+        OE_TEST(i == next[thread_index]);
+        next[thread_index]++;
+    }
+
+    for (uint32_t t = 0; t < NUM_THREADS; t++)
+        OE_TEST(next[t] == NUM_RECORDS);
+
+    fclose(file);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    pthread_t threads[NUM_THREADS];
+    char path[] = "/tmp/oe_log_ring_XXXXXX";
+    int fd;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    /* Log to a file, read when the enclave is created */
+    OE_TEST((fd = mkstemp(path)) >= 0);
+    close(fd);
+    setenv("OE_LOG_LEVEL", "INFO", 1);
+    setenv("OE_LOG_DEVICE", path, 1);
+
+    const uint32_t flags = oe_get_create_flags();
+
+    if ((result = oe_create_log_ring_enclave(
+             argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &_enclave)) !=
+        OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+        OE_TEST(
+            pthread_create(&threads[i], NULL, _log_thread, (void*)i) == 0);
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    /* Terminating the enclave logs the records left in the ring */
+    if ((result = oe_terminate_enclave(_enclave)) != OE_OK)
+        oe_put_err("oe_terminate_enclave(): result=%u", result);
+
+    _check_log_file(path);
+    unlink(path);
+
+    printf("=== passed all tests (log_ring)\n");
+
+    return 0;
+}
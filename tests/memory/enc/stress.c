@@ -188,3 +188,58 @@ void malloc_stress_test(int threads)
 
     _run_malloc_test(size);
 }
+
+/* Each thread frees the blocks allocated by the next one */
+#define CROSS_THREAD_MAX_THREADS 4
+#define CROSS_THREAD_BLOCKS 256
+#define CROSS_THREAD_ROUNDS 16
+
+static unsigned char* _cross_thread_blocks[CROSS_THREAD_MAX_THREADS]
+                                          [CROSS_THREAD_BLOCKS];
+static int _cross_thread_arrivals;
+
+static void _cross_thread_barrier(int threads, int round)
+{
+    __atomic_add_fetch(&_cross_thread_arrivals, 1, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&_cross_thread_arrivals, __ATOMIC_SEQ_CST) <
+           threads * round)
+        ;
+}
+
+void malloc_cross_thread_test(int index, int threads)
+{
+    OE_TEST(threads > 0 && threads <= CROSS_THREAD_MAX_THREADS);
+    OE_TEST(index >= 0 && index < threads);
+
+    for (int round = 0; round < CROSS_THREAD_ROUNDS; round++)
+    {
+        unsigned char** mine = _cross_thread_blocks[index];
+        unsigned char** next = _cross_thread_blocks[(index + 1) % threads];
+        int owner = (index + 1) % threads;
+
+        /* Small sizes that are all served by the thread caches if enabled */
+        for (int i = 0; i < CROSS_THREAD_BLOCKS; i++)
+        {
+            size_t size = (size_t)(i * 7 % 500) + 1;
+
+            OE_TEST((mine[i] = (unsigned char*)malloc(size)) != NULL);
+            memset(mine[i], index + i, size);
+        }
+
+        _cross_thread_barrier(threads, 2 * round + 1);
+
+        for (int i = 0; i < CROSS_THREAD_BLOCKS; i++)
+        {
+            size_t size = (size_t)(i * 7 % 500) + 1;
+
+            for (size_t j = 0; j < size; j++)
+                OE_TEST(next[i][j] == (unsigned char)(owner + i));
+
+            free(next[i]);
+            next[i] = NULL;
+        }
+
+        _cross_thread_barrier(threads, 2 * round + 2);
+    }
+}
@@ -42,11 +42,30 @@ static void _malloc_stress_test_multithread(oe_enclave_t* enclave)
         t.join();
 }
 
+static void _malloc_cross_thread_test_single_thread(
+    oe_enclave_t* enclave,
+    int index)
+{
+    OE_TEST(malloc_cross_thread_test(enclave, index, 4) == OE_OK);
+}
+
+static void _malloc_cross_thread_test(oe_enclave_t* enclave)
+{
+    std::vector<std::thread> vec;
+    for (int i = 0; i < 4; i++)
+        vec.push_back(
+            std::thread(_malloc_cross_thread_test_single_thread, enclave, i));
+
+    for (auto& t : vec)
+        t.join();
+}
+
 static void _malloc_stress_test(oe_enclave_t* enclave)
 {
     OE_TEST(init_malloc_stress_test(enclave) == OE_OK);
     _malloc_stress_test_single_thread(enclave, 1);
     _malloc_stress_test_multithread(enclave);
+    _malloc_cross_thread_test(enclave);
 }
 
 static void _malloc_boundary_test(oe_enclave_t* enclave, uint32_t flags)
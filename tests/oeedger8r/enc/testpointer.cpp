@@ -1551,3 +1551,46 @@ void ecall_size_attribute_all_types(
     unsigned long long unsigned_long_long_size)
 {
 }
+
+// Sums the streamed input and fills the streamed output with the low byte
+// of the offset of each element, a chunk at a time.
+uint64_t ecall_pointer_stream(
+    oe_stream_reader_t* data,
+    size_t data_size,
+    oe_stream_writer_t* result,
+    size_t result_size)
+{
+    uint64_t sum = 0;
+    size_t total = 0;
+    const void* window;
+    size_t size;
+
+    while (oe_stream_read(data, &window, &size) == OE_OK && size > 0)
+    {
+        // Each window fits in the enclave regardless of the buffer size.
+        OE_TEST(oe_is_within_enclave(window, size));
+
+        for (size_t i = 0; i < size; ++i)
+            sum += ((const uint8_t*)window)[i];
+
+        total += size;
+    }
+
+    OE_TEST(total == data_size);
+
+    uint8_t chunk[1000];
+    for (size_t offset = 0; offset < result_size; offset += sizeof(chunk))
+    {
+        size_t n = std::min(sizeof(chunk), result_size - offset);
+
+        for (size_t i = 0; i < n; ++i)
+            chunk[i] = (uint8_t)(offset + i);
+
+        OE_TEST(oe_stream_write(result, chunk, n) == OE_OK);
+    }
+
+    // Writing past the end of the buffer fails.
+    OE_TEST(oe_stream_write(result, chunk, 1) == OE_BUFFER_TOO_SMALL);
+
+    return sum;
+}
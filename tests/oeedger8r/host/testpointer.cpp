@@ -6,6 +6,7 @@
 #include <openenclave/host.h>
 #include <openenclave/internal/tests.h>
 #include <algorithm>
+#include <vector>
 #include "all_u.h"
 
 template <typename T, typename F>
@@ -160,6 +161,38 @@ static void test_ecall_pointer_fun(oe_enclave_t* enclave, F ecall_pointer_fun)
             psize) == OE_OK);
 }
 
+static void test_ecall_pointer_stream(oe_enclave_t* enclave)
+{
+    // Larger than the stream window of the enclave.
+    std::vector<uint8_t> data(1024 * 1024 + 123);
+    std::vector<uint8_t> result(300 * 1024 + 7);
+    uint64_t expected = 0;
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = (uint8_t)(i * 7);
+        expected += data[i];
+    }
+
+    OE_TEST(
+        ecall_pointer_stream(
+            enclave,
+            &sum,
+            data.data(),
+            data.size(),
+            result.data(),
+            result.size()) == OE_OK);
+    OE_TEST(sum == expected);
+
+    for (size_t i = 0; i < result.size(); ++i)
+        OE_TEST(result[i] == (uint8_t)i);
+
+    // Empty streams.
+    OE_TEST(ecall_pointer_stream(enclave, &sum, NULL, 0, NULL, 0) == OE_OK);
+    OE_TEST(sum == 0);
+}
+
 void test_pointer_edl_ecalls(oe_enclave_t* enclave)
 {
     test_ecall_pointer_fun<char>(enclave, ecall_pointer_char);
@@ -194,6 +227,8 @@ void test_pointer_edl_ecalls(oe_enclave_t* enclave)
     test_ecall_pointer_fun<unsigned long long>(
         enclave, ecall_pointer_unsigned_long_long);
 
+    test_ecall_pointer_stream(enclave);
+
     OE_TEST(ecall_pointer_assert_all_called(enclave) == OE_OK);
     printf("=== test_pointer_edl_ecalls passed\n");
 }
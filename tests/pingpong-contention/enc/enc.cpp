@@ -0,0 +1,23 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include "pingpong_t.h"
+
+int Ping(int value)
+{
+    int result = 0;
+
+    if (Pong(&result, value) != OE_OK)
+        return -1;
+
+    return result;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    64,   /* StackPageCount */
+    16);  /* TCSCount */
@@ -0,0 +1,91 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "pingpong_u.h"
+
+// Must not exceed the TCSCount of the enclave.
+#define MAX_THREADS 16
+#define NUM_CALLS_PER_THREAD 20000
+
+static std::atomic<int> _num_failures(0);
+
+int Pong(int value)
+{
+    return value + 1;
+}
+
+static void _ping_loop(oe_enclave_t* enclave, int id)
+{
+    for (int i = 0; i < NUM_CALLS_PER_THREAD; i++)
+    {
+        int result = 0;
+        int value = id * NUM_CALLS_PER_THREAD + i;
+
+        if (Ping(enclave, &result, value) != OE_OK || result != value + 1)
+            _num_failures++;
+    }
+}
+
+// Measure ECALL+OCALL throughput with an increasing number of host threads
+// calling into the same enclave, which exercises TCS assignment under
+// contention.
+static void _run_benchmark(oe_enclave_t* enclave, int num_threads)
+{
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < num_threads; i++)
+        threads.push_back(std::thread(_ping_loop, enclave, i));
+
+    for (auto& thread : threads)
+        thread.join();
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double num_calls = (double)num_threads * NUM_CALLS_PER_THREAD;
+
+    printf(
+        "%2d threads: %8.0f calls/sec (%.2f us/call)\n",
+        num_threads,
+        num_calls / elapsed.count(),
+        elapsed.count() * 1000000.0 / num_calls);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    result = oe_create_pingpong_enclave(
+        argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+    if (result != OE_OK)
+        oe_put_err("oe_create_pingpong_enclave(): result=%u", result);
+
+    for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2)
+        _run_benchmark(enclave, num_threads);
+
+    OE_TEST(_num_failures == 0);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (pingpong-contention)\n");
+
+    return 0;
+}
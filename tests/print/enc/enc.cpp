@@ -53,6 +53,23 @@ int enclave_test_print()
     return 0;
 }
 
+int enclave_test_print_buffered()
+{
+    static char buffer[BUFSIZ];
+
+    /* Nothing reaches the host until the buffer is flushed */
+    OE_TEST(setvbuf(stdout, buffer, _IOFBF, sizeof(buffer)) == 0);
+
+    printf("printf(stdout, _IOFBF)\n");
+    oe_host_printf("oe_host_printf(stdout, _IOFBF)\n");
+    OE_TEST(fflush(stdout) == 0);
+
+    /* Written when the enclave is terminated */
+    printf("printf(stdout, unflushed)\n");
+
+    return 0;
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
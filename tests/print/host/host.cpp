@@ -21,6 +21,17 @@ void TestPrint(oe_enclave_t* enclave)
     OE_TEST(return_value == 0);
 }
 
+void TestPrintBuffered(oe_enclave_t* enclave)
+{
+    oe_result_t result;
+    int return_value;
+
+    printf("=== %s() \n", __FUNCTION__);
+    result = enclave_test_print_buffered(enclave, &return_value);
+    OE_TEST(result == OE_OK);
+    OE_TEST(return_value == 0);
+}
+
 int main(int argc, const char* argv[])
 {
     oe_result_t result;
@@ -41,6 +52,7 @@ int main(int argc, const char* argv[])
     }
 
     TestPrint(enclave);
+    TestPrintBuffered(enclave);
 
     if ((result = oe_terminate_enclave(enclave)) != OE_OK)
     {
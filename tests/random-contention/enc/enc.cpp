@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <string.h>
+#include "random_t.h"
+
+#define MAX_SIZE 4096
+
+int generate_random(size_t size, size_t count)
+{
+    unsigned char previous[MAX_SIZE];
+    unsigned char buffer[MAX_SIZE];
+
+    if (size == 0 || size > MAX_SIZE)
+        return -1;
+
+    memset(previous, 0, size);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (oe_random(buffer, size) != OE_OK)
+            return -1;
+
+        /* Two requests must never return the same data */
+        if (memcmp(buffer, previous, size) == 0)
+            return -1;
+
+        memcpy(previous, buffer, size);
+    }
+
+    return 0;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    64,   /* StackPageCount */
+    16);  /* TCSCount */
@@ -0,0 +1,93 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "random_u.h"
+
+// Must not exceed the TCSCount of the enclave.
+#define MAX_THREADS 16
+#define NUM_CALLS_PER_THREAD 100
+#define NUM_RANDOM_PER_CALL 200
+
+static std::atomic<int> _num_failures(0);
+
+static void _random_loop(oe_enclave_t* enclave, size_t size)
+{
+    for (int i = 0; i < NUM_CALLS_PER_THREAD; i++)
+    {
+        int result = -1;
+
+        if (generate_random(enclave, &result, size, NUM_RANDOM_PER_CALL) !=
+                OE_OK ||
+            result != 0)
+            _num_failures++;
+    }
+}
+
+// Measure oe_random() throughput with an increasing number of threads
+// drawing random data in the same enclave at the same time.
+static void _run_benchmark(oe_enclave_t* enclave, int num_threads, size_t size)
+{
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < num_threads; i++)
+        threads.push_back(std::thread(_random_loop, enclave, size));
+
+    for (auto& thread : threads)
+        thread.join();
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double num_calls =
+        (double)num_threads * NUM_CALLS_PER_THREAD * NUM_RANDOM_PER_CALL;
+
+    printf(
+        "%4zu bytes, %2d threads: %9.0f calls/sec (%7.2f MB/sec)\n",
+        size,
+        num_threads,
+        num_calls / elapsed.count(),
+        num_calls * (double)size / elapsed.count() / (1024 * 1024));
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    result = oe_create_random_enclave(
+        argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave);
+    if (result != OE_OK)
+        oe_put_err("oe_create_random_enclave(): result=%u", result);
+
+    // 16 bytes takes the hardware path and 1024 bytes a DRBG instance.
+    for (size_t size = 16; size <= 1024; size *= 64)
+    {
+        for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2)
+            _run_benchmark(enclave, num_threads, size);
+    }
+
+    OE_TEST(_num_failures == 0);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (random-contention)\n");
+
+    return 0;
+}
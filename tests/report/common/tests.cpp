@@ -3,6 +3,7 @@
 
 #include "../common/tests.h"
 #include <openenclave/internal/tests.h>
+#include "../../../common/sgx/collateral.h"
 
 #ifdef OE_BUILD_ENCLAVE
 #include <openenclave/corelibc/string.h>
@@ -1083,3 +1084,34 @@ void test_remote_verify_report()
 #endif
     }
 }
+
+#ifdef OE_USE_LIBSGX
+void test_remote_verify_report_cached(uint32_t iterations)
+{
+    uint8_t report_buffer[OE_MAX_REPORT_SIZE] = {0};
+    size_t report_size = sizeof(report_buffer);
+    oe_collateral_cache_stats_t stats = {0};
+
+    OE_TEST(
+        GetReport(
+            OE_REPORT_FLAGS_REMOTE_ATTESTATION,
+            NULL,
+            0,
+            NULL,
+            0,
+            report_buffer,
+            &report_size) == OE_OK);
+
+    // Only the first verification should validate the PCK certificate chain
+    // and fetch the revocation info.
+    oe_clear_collateral_cache();
+    for (uint32_t i = 0; i < iterations; ++i)
+        OE_TEST(VerifyReport(report_buffer, report_size, NULL) == OE_OK);
+
+    oe_get_collateral_cache_stats(&stats);
+    OE_TEST(stats.pck_chain_hits + stats.pck_chain_misses == iterations);
+    OE_TEST(stats.hits + stats.misses == stats.pck_chain_misses);
+    OE_TEST(iterations == 0 || stats.misses >= 1);
+    OE_TEST(iterations < 2 || stats.pck_chain_hits > 0);
+}
+#endif
@@ -25,5 +25,6 @@ void test_remote_report();
 void test_parse_report_negative();
 void test_local_verify_report();
 void test_remote_verify_report();
+void test_remote_verify_report_cached(uint32_t iterations);
 
 #endif
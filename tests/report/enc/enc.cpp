@@ -148,6 +148,63 @@ void enclave_test_remote_verify_report()
     test_remote_verify_report();
 }
 
+void enclave_test_remote_verify_report_cached(uint32_t iterations)
+{
+#ifdef OE_USE_LIBSGX
+    test_remote_verify_report_cached(iterations);
+#else
+    OE_UNUSED(iterations);
+#endif
+}
+
+void enclave_benchmark_remote_report(uint32_t iterations, bool use_v2)
+{
+    static uint8_t report_buffer[OE_MAX_REPORT_SIZE];
+
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        if (use_v2)
+        {
+            uint8_t* report = NULL;
+            size_t report_size = 0;
+            OE_TEST(
+                oe_get_report_v2(
+                    OE_REPORT_FLAGS_REMOTE_ATTESTATION,
+                    NULL,
+                    0,
+                    NULL,
+                    0,
+                    &report,
+                    &report_size) == OE_OK);
+            oe_free_report(report);
+        }
+        else
+        {
+            // Query the size first, as callers of the v1 API have to.
+            size_t report_size = 0;
+            OE_TEST(
+                oe_get_report_v1(
+                    OE_REPORT_FLAGS_REMOTE_ATTESTATION,
+                    NULL,
+                    0,
+                    NULL,
+                    0,
+                    NULL,
+                    &report_size) == OE_BUFFER_TOO_SMALL);
+            OE_TEST(report_size <= sizeof(report_buffer));
+            OE_TEST(
+                oe_get_report_v1(
+                    OE_REPORT_FLAGS_REMOTE_ATTESTATION,
+                    NULL,
+                    0,
+                    NULL,
+                    0,
+                    report_buffer,
+                    &report_size) == OE_OK);
+        }
+    }
+}
+
 OE_SET_ENCLAVE_SGX(
     0,    /* ProductID */
     0,    /* SecurityVersion */
@@ -7,6 +7,7 @@
 #include <openenclave/internal/hexdump.h>
 #include <openenclave/internal/tests.h>
 #include <openenclave/internal/utils.h>
+#include <chrono>
 #include <ctime>
 #include <vector>
 #include "../../../common/sgx/tcbinfo.h"
@@ -44,6 +45,51 @@ void generate_and_save_report(oe_enclave_t* enclave)
 #endif
 }
 
+#ifdef OE_USE_LIBSGX
+static void _benchmark_remote_verify_report(oe_enclave_t* enclave)
+{
+    const uint32_t iterations = 1000;
+
+    auto start = std::chrono::steady_clock::now();
+    test_remote_verify_report_cached(iterations);
+    auto host_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    OE_TEST(
+        enclave_test_remote_verify_report_cached(enclave, iterations) ==
+        OE_OK);
+    auto enclave_time = std::chrono::steady_clock::now() - start;
+
+    printf(
+        "=== remote report verifications/sec: host %.0f, enclave %.0f\n",
+        iterations / std::chrono::duration<double>(host_time).count(),
+        iterations / std::chrono::duration<double>(enclave_time).count());
+}
+#endif
+
+static void _benchmark_remote_report(oe_enclave_t* enclave)
+{
+    const uint32_t iterations = 100;
+    double reports_per_second[2];
+
+    for (int use_v2 = 0; use_v2 < 2; use_v2++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        OE_TEST(
+            enclave_benchmark_remote_report(
+                enclave, iterations, use_v2 != 0) == OE_OK);
+        auto time = std::chrono::steady_clock::now() - start;
+        reports_per_second[use_v2] =
+            iterations / std::chrono::duration<double>(time).count();
+    }
+
+    printf(
+        "=== remote reports/sec: oe_get_report_v1 %.0f, oe_get_report_v2 "
+        "%.0f\n",
+        reports_per_second[0],
+        reports_per_second[1]);
+}
+
 void load_and_verify_report()
 {
 #ifdef OE_USE_LIBSGX
@@ -120,6 +166,8 @@ int main(int argc, const char* argv[])
 
     OE_TEST(enclave_test_remote_report(enclave) == OE_OK);
 
+    _benchmark_remote_report(enclave);
+
     OE_TEST(enclave_test_parse_report_negative(enclave) == OE_OK);
 
     OE_TEST(enclave_test_local_verify_report(enclave) == OE_OK);
@@ -130,6 +178,10 @@ int main(int argc, const char* argv[])
     TestVerifyTCBInfo(enclave, "./data/tcbInfo.json");
     TestVerifyTCBInfo(enclave, "./data/tcbInfo_with_pceid.json");
 
+    // Must run before test_minimum_issue_date, which makes the enclave
+    // reject all revocation info.
+    _benchmark_remote_verify_report(enclave);
+
     // Get current time and pass it to enclave.
     std::time_t t = std::time(0);
     std::tm* tm = std::gmtime(&t);
@@ -0,0 +1,65 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <sys/time.h>
+#include <time.h>
+#include "sharedclock_t.h"
+
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+#define SLEEP_MSEC 50
+
+static uint64_t _get_ns(clockid_t clock_id)
+{
+    struct timespec ts;
+
+    OE_TEST(clock_gettime(clock_id, &ts) == 0);
+    OE_TEST(ts.tv_nsec >= 0 && (uint64_t)ts.tv_nsec < NSEC_PER_SEC);
+
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+int enc_test_clocks(uint64_t host_realtime_sec, size_t iterations)
+{
+    uint64_t realtime_sec = _get_ns(CLOCK_REALTIME) / NSEC_PER_SEC;
+    uint64_t last;
+    uint64_t start;
+    struct timeval tv;
+
+    /* The real time agrees with the host */
+    OE_TEST(realtime_sec + 2 >= host_realtime_sec);
+    OE_TEST(realtime_sec <= host_realtime_sec + 2);
+
+    /* gettimeofday() reports microseconds */
+    OE_TEST(gettimeofday(&tv, NULL) == 0);
+    OE_TEST(tv.tv_usec >= 0 && tv.tv_usec < 1000000);
+    OE_TEST((uint64_t)tv.tv_sec + 2 >= host_realtime_sec);
+
+    /* The monotonic time never goes backwards */
+    last = _get_ns(CLOCK_MONOTONIC);
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        uint64_t now = _get_ns(CLOCK_MONOTONIC);
+
+        OE_TEST(now >= last);
+        last = now;
+    }
+
+    /* The monotonic time advances while the host refreshes the clock */
+    start = _get_ns(CLOCK_MONOTONIC);
+    OE_TEST(host_sleep_msec(SLEEP_MSEC) == OE_OK);
+    OE_TEST(_get_ns(CLOCK_MONOTONIC) - start >= SLEEP_MSEC / 2 * NSEC_PER_MSEC);
+
+    return 0;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    1024, /* StackPageCount */
+    1);   /* TCSCount */
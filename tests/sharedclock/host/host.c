@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <time.h>
+#include "sharedclock_u.h"
+
+#define NUM_ITERATIONS 1000000
+
+void host_sleep_msec(uint32_t msec)
+{
+    struct timespec ts = {msec / 1000, (long)(msec % 1000) * 1000000};
+
+    nanosleep(&ts, NULL);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    int return_val = -1;
+    struct timespec start;
+    struct timespec end;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    if ((result = oe_create_sharedclock_enclave(
+             argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = enc_test_clocks(
+        enclave, &return_val, (uint64_t)time(NULL), NUM_ITERATIONS);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    OE_TEST(result == OE_OK);
+    OE_TEST(return_val == 0);
+
+    printf(
+        "%d enclave clock reads took %.1f ms\n",
+        NUM_ITERATIONS,
+        (double)(end.tv_sec - start.tv_sec) * 1000.0 +
+            (double)(end.tv_nsec - start.tv_nsec) / 1000000.0);
+
+    if ((result = oe_terminate_enclave(enclave)) != OE_OK)
+        oe_put_err("oe_terminate_enclave(): result=%u", result);
+
+    printf("=== passed all tests (sharedclock)\n");
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/corelibc/string.h>
+#include <openenclave/enclave.h>
+#include "switchless_t.h"
+
+int enc_echo_switchless(const char* in, char out[100], int repeats)
+{
+    oe_result_t result;
+    int return_val;
+
+    if (oe_strcmp(in, "Hello World") != 0)
+        return -1;
+
+    for (int i = 0; i < repeats; i++)
+    {
+        result = host_echo_switchless(&return_val, in, out, "host string");
+        if (result != OE_OK || return_val != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+int enc_echo_regular(const char* in, char out[100], int repeats)
+{
+    oe_result_t result;
+    int return_val;
+
+    if (oe_strcmp(in, "Hello World") != 0)
+        return -1;
+
+    for (int i = 0; i < repeats; i++)
+    {
+        result = host_echo_regular(&return_val, in, out, "host string");
+        if (result != OE_OK || return_val != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/* Back-to-back switchless OCALLs from one thread reuse the same OCALL arena
+ * memory, so a call must not complete before its host function has run */
+int enc_increment_switchless(int repeats)
+{
+    oe_result_t result;
+    int return_val;
+
+    for (int i = 0; i < repeats; i++)
+    {
+        return_val = 0;
+        result = host_increment_switchless(&return_val, i);
+        if (result != OE_OK || return_val != i + 1)
+            return -1;
+    }
+
+    return 0;
+}
+
+int enc_add(int a, int b)
+{
+    return a + b;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    1024, /* StackPageCount */
+    2);   /* TCSCount */
@@ -0,0 +1,165 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/switchless.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "switchless_u.h"
+
+#define NUM_HOST_WORKERS 2
+#define NUM_ENCLAVE_WORKERS 1
+#define NUM_REPEATS 10000
+
+int host_echo_switchless(const char* in, char* out, const char* str1)
+{
+    OE_TEST(strcmp(str1, "host string") == 0);
+
+    strcpy(out, in);
+
+    return 0;
+}
+
+int host_echo_regular(const char* in, char* out, const char* str1)
+{
+    OE_TEST(strcmp(str1, "host string") == 0);
+
+    strcpy(out, in);
+
+    return 0;
+}
+
+int host_increment_switchless(int value)
+{
+    return value + 1;
+}
+
+/* Number of calls serviced by the workers, which is zero if every call fell
+ * back to a regular call */
+static uint64_t _host_worker_calls(oe_enclave_t* enclave)
+{
+    oe_switchless_stats_t stats;
+
+    OE_TEST(oe_get_switchless_stats(enclave, &stats) == OE_OK);
+
+    return stats.host_worker_calls;
+}
+
+static uint64_t _enclave_worker_calls(oe_enclave_t* enclave)
+{
+    oe_switchless_stats_t stats;
+
+    OE_TEST(oe_get_switchless_stats(enclave, &stats) == OE_OK);
+
+    return stats.enclave_worker_calls;
+}
+
+static double _elapsed_ms(clock_t start)
+{
+    return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    oe_enclave_setting_context_switchless_t switchless_setting = {
+        NUM_HOST_WORKERS, NUM_ENCLAVE_WORKERS};
+    oe_enclave_setting_t settings[] = {{
+        .setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS,
+        .u.context_switchless_setting = &switchless_setting,
+    }};
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t flags = oe_get_create_flags();
+
+    if ((result = oe_create_switchless_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             settings,
+             OE_COUNTOF(settings),
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    char out[100];
+    int return_val;
+    clock_t start;
+
+    /* Switchless OCALLs serviced by the host workers */
+    memset(out, 0, sizeof(out));
+    start = clock();
+    result = enc_echo_switchless(
+        enclave, &return_val, "Hello World", out, NUM_REPEATS);
+    OE_TEST(result == OE_OK);
+    OE_TEST(return_val == 0);
+    OE_TEST(strcmp(out, "Hello World") == 0);
+    printf(
+        "%d switchless OCALLs took %.1f ms\n",
+        NUM_REPEATS,
+        _elapsed_ms(start));
+    OE_TEST(_host_worker_calls(enclave) > 0);
+
+    /* Back-to-back switchless OCALLs whose arguments reuse the same memory */
+    result = enc_increment_switchless(enclave, &return_val, NUM_REPEATS);
+    OE_TEST(result == OE_OK);
+    OE_TEST(return_val == 0);
+
+    /* Regular OCALLs for comparison */
+    memset(out, 0, sizeof(out));
+    start = clock();
+    result =
+        enc_echo_regular(enclave, &return_val, "Hello World", out, NUM_REPEATS);
+    OE_TEST(result == OE_OK);
+    OE_TEST(return_val == 0);
+    OE_TEST(strcmp(out, "Hello World") == 0);
+    printf(
+        "%d regular OCALLs took %.1f ms\n", NUM_REPEATS, _elapsed_ms(start));
+
+    /* Switchless ECALLs serviced by the enclave worker */
+    start = clock();
+    for (int i = 0; i < NUM_REPEATS; i++)
+    {
+        result = enc_add(enclave, &return_val, i, 1);
+        OE_TEST(result == OE_OK);
+        OE_TEST(return_val == i + 1);
+    }
+    printf(
+        "%d switchless ECALLs took %.1f ms\n",
+        NUM_REPEATS,
+        _elapsed_ms(start));
+    OE_TEST(_enclave_worker_calls(enclave) > 0);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    /* Without workers switchless calls fall back to regular calls */
+    if ((result = oe_create_switchless_enclave(
+             argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    memset(out, 0, sizeof(out));
+    result = enc_echo_switchless(enclave, &return_val, "Hello World", out, 10);
+    OE_TEST(result == OE_OK);
+    OE_TEST(return_val == 0);
+    OE_TEST(strcmp(out, "Hello World") == 0);
+
+    result = enc_add(enclave, &return_val, 1, 2);
+    OE_TEST(result == OE_OK);
+    OE_TEST(return_val == 3);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (switchless)\n");
+
+    return 0;
+}
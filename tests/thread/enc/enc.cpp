@@ -301,6 +301,49 @@ size_t enc_tcs_used_thread_count()
     return g_tcs_used_thread_count;
 }
 
+// Lock micro-benchmark: short critical sections on one contended mutex
+static oe_mutex_t bench_mutex = OE_MUTEX_INITIALIZER;
+static volatile uint64_t bench_counter = 0;
+static std::atomic<uint64_t> bench_acquisitions(0);
+static uint64_t bench_start_waits = 0;
+static uint64_t bench_start_wakes = 0;
+
+void enc_set_lock_spin_count(uint64_t spin_count)
+{
+    oe_thread_set_spin_count(spin_count);
+
+    // Start a new measurement
+    bench_acquisitions = 0;
+    oe_thread_get_ocall_counts(&bench_start_waits, &bench_start_wakes);
+}
+
+void enc_lock_benchmark(size_t iterations)
+{
+    for (size_t i = 0; i < iterations; i++)
+    {
+        OE_TEST(oe_mutex_lock(&bench_mutex) == OE_OK);
+        bench_counter++;
+        OE_TEST(oe_mutex_unlock(&bench_mutex) == OE_OK);
+    }
+
+    bench_acquisitions += iterations;
+}
+
+void enc_lock_benchmark_results(
+    uint64_t* acquisitions,
+    uint64_t* wait_ocalls,
+    uint64_t* wake_ocalls)
+{
+    uint64_t waits = 0;
+    uint64_t wakes = 0;
+
+    oe_thread_get_ocall_counts(&waits, &wakes);
+
+    *acquisitions = bench_acquisitions;
+    *wait_ocalls = waits - bench_start_waits;
+    *wake_ocalls = wakes - bench_start_wakes;
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
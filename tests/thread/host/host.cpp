@@ -4,6 +4,7 @@
 #include <openenclave/host.h>
 #include <openenclave/internal/error.h>
 #include <openenclave/internal/tests.h>
+#include <openenclave/internal/thread.h>
 #include <atomic>
 #include <cassert>
 #include <chrono>
@@ -211,6 +212,65 @@ void test_thread_locking_patterns(oe_enclave_t* enclave)
 
 void test_readers_writer_lock(oe_enclave_t* enclave);
 
+// Micro-benchmark that reports the number of OCALLs made per mutex
+// acquisition with and without spinning.
+const size_t LOCK_BENCHMARK_ITERATIONS = 20000;
+
+void* lock_benchmark_thread(oe_enclave_t* enclave)
+{
+    OE_TEST(enc_lock_benchmark(enclave, LOCK_BENCHMARK_ITERATIONS) == OE_OK);
+
+    return NULL;
+}
+
+void run_lock_benchmark(oe_enclave_t* enclave, uint64_t spin_count)
+{
+    std::thread threads[NUM_THREADS];
+    uint64_t acquisitions = 0;
+    uint64_t wait_ocalls = 0;
+    uint64_t wake_ocalls = 0;
+
+    OE_TEST(enc_set_lock_spin_count(enclave, spin_count) == OE_OK);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        threads[i] = std::thread(lock_benchmark_thread, enclave);
+    }
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        threads[i].join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    OE_TEST(
+        enc_lock_benchmark_results(
+            enclave, &acquisitions, &wait_ocalls, &wake_ocalls) == OE_OK);
+    OE_TEST(acquisitions == NUM_THREADS * LOCK_BENCHMARK_ITERATIONS);
+
+    printf(
+        "lock benchmark (spin count %llu): %llu acquisitions in %lld ms, "
+        "%.4f wait and %.4f wake OCALLs per acquisition\n",
+        static_cast<unsigned long long>(spin_count),
+        static_cast<unsigned long long>(acquisitions),
+        static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+                .count()),
+        (double)wait_ocalls / (double)acquisitions,
+        (double)wake_ocalls / (double)acquisitions);
+}
+
+void test_lock_benchmark(oe_enclave_t* enclave)
+{
+    // Without spinning, every contended acquisition exits the enclave
+    run_lock_benchmark(enclave, 0);
+
+    run_lock_benchmark(enclave, OE_THREAD_DEFAULT_SPIN_COUNT);
+}
+
 // test_tcs_exhaustion
 static std::atomic<size_t> g_tcs_out_thread_count(0);
 
@@ -318,6 +378,8 @@ int main(int argc, const char* argv[])
 
     test_readers_writer_lock(enclave);
 
+    test_lock_benchmark(enclave);
+
     test_tcs_exhaustion(enclave);
 
     if ((result = oe_terminate_enclave(enclave)) != OE_OK)
@@ -61,6 +61,21 @@ let get_plist_str (fd: Ast.func_decl) =
       (gen_parm_str (List.hd fd.Ast.plist))
       (List.tl fd.Ast.plist)
 
+(** Buffers of parameters with the [stream] attribute are not copied
+    into the marshalling buffers. The trusted function gets a reader
+    ([in]) or writer ([out]) over the host buffer instead. *)
+let get_stream_type (pt: Ast.parameter_type) =
+  match pt with
+  | Ast.PTPtr (_, pa) when pa.Ast.pa_isstream ->
+    if pa.Ast.pa_direction = Ast.PtrOut then Some "oe_stream_writer_t"
+    else Some "oe_stream_reader_t"
+  | _ -> None
+
+(** Whether the buffer of a pointer parameter is copied into the
+    marshalling buffers. *)
+let is_marshalled_ptr (pa: Ast.ptr_attr) =
+  pa.Ast.pa_chkptr && not pa.Ast.pa_isstream
+
 (** [conv_array_to_ptr] is used to convert Array form into Pointer form.
     {[
       int array[10][20] => [count = 200] int* array
@@ -219,6 +234,20 @@ let oe_gen_prototype (fd: Ast.func_decl) =
     else get_plist_str fd in
   sprintf "%s %s(%s)" (get_ret_tystr fd) fd.Ast.fname params_str
 
+(** Generate the prototype of a trusted function, which takes a stream
+    reader or writer for each [stream] parameter. *)
+let oe_gen_trusted_prototype (fd: Ast.func_decl) =
+  let gen_str (pt, declr) =
+    match get_stream_type pt with
+    | Some t -> sprintf "%s* %s" t declr.Ast.identifier
+    | None -> gen_parm_str (pt, declr)
+  in
+  let params_str =
+    if List.length fd.Ast.plist = 0 then
+      "void"
+    else String.concat ",\n        " (List.map gen_str fd.Ast.plist) in
+  sprintf "%s %s(%s)" (get_ret_tystr fd) fd.Ast.fname params_str
+
 let oe_gen_wrapper_prototype (fd: Ast.func_decl) (is_ecall:bool) =
   let plist_str = get_plist_str fd in
   let retval_str =
@@ -334,7 +363,7 @@ let oe_prepare_input_buffer (os:out_channel) (fd:Ast.func_decl) (alloc_func:stri
   List.iter (fun (ptype, decl) ->
       match ptype with
       | Ast.PTPtr (atype, ptr_attr) ->
-        if ptr_attr.Ast.pa_chkptr then
+        if is_marshalled_ptr ptr_attr then
           match ptr_attr.Ast.pa_direction with
           | Ast.PtrIn | Ast.PtrInOut ->
             let size = oe_get_param_size (ptype, decl, "_args.") in
@@ -349,7 +378,7 @@ let oe_prepare_input_buffer (os:out_channel) (fd:Ast.func_decl) (alloc_func:stri
   List.iter (fun (ptype, decl) ->
       match ptype with
       | Ast.PTPtr (atype, ptr_attr) ->
-        if ptr_attr.Ast.pa_chkptr then
+        if is_marshalled_ptr ptr_attr then
           match ptr_attr.Ast.pa_direction with
           | Ast.PtrOut | Ast.PtrInOut ->
             let size = oe_get_param_size (ptype, decl, "_args.") in
@@ -377,7 +406,7 @@ let oe_prepare_input_buffer (os:out_channel) (fd:Ast.func_decl) (alloc_func:stri
   List.iter (fun (ptype, decl) ->
       match ptype with
       | Ast.PTPtr (atype, ptr_attr) ->
-        if ptr_attr.Ast.pa_chkptr then
+        if is_marshalled_ptr ptr_attr then
           let size = oe_get_param_size (ptype, decl, "_args.") in
           match ptr_attr.Ast.pa_direction with
           | Ast.PtrIn -> fprintf os "    OE_WRITE_IN_PARAM(%s, %s);\n" decl.Ast.identifier size
@@ -411,7 +440,7 @@ let oe_process_output_buffer (os:out_channel) (fd:Ast.func_decl) =
   List.iter (fun (ptype, decl) ->
       match ptype with
       | Ast.PTPtr (atype, ptr_attr) ->
-        if ptr_attr.Ast.pa_chkptr then
+        if is_marshalled_ptr ptr_attr then
           let size = oe_get_param_size (ptype, decl, "_args.") in
           match ptr_attr.Ast.pa_direction with
           | Ast.PtrOut -> fprintf os "    OE_READ_OUT_PARAM(%s, (size_t)(%s));\n" decl.Ast.identifier size
@@ -516,7 +545,10 @@ let oe_gen_copy_outputs (os:out_channel) (fd: Ast.func_decl) =
 
 let oe_gen_call_function (os:out_channel) (fd: Ast.func_decl) =
   let params = List.map (fun (pt, decl) ->
-      sprintf "%spargs_in->%s" (get_cast_from_mem_expr (pt, decl))decl.Ast.identifier) fd.Ast.plist
+      match get_stream_type pt with
+      | Some _ -> sprintf "&_%s_stream" decl.Ast.identifier
+      | None ->
+        sprintf "%spargs_in->%s" (get_cast_from_mem_expr (pt, decl))decl.Ast.identifier) fd.Ast.plist
   in
   let params_str = "(\n        " ^ (String.concat ",\n        " params ) ^ ")" in
   let ret_str = match fd.Ast.rtype with
@@ -541,6 +573,18 @@ let oe_gen_ecall_function (os:out_channel) (fd: Ast.func_decl) =
   fprintf os "    %s_args_t* pargs_out = (%s_args_t*) output_buffer;\n\n" fd.Ast.fname fd.Ast.fname;
   fprintf os "    size_t input_buffer_offset = 0;\n";
   fprintf os "    size_t output_buffer_offset = 0;\n";
+  List.iter (fun (ptype, decl) ->
+      match get_stream_type ptype with
+      | Some t -> fprintf os "    %s _%s_stream;\n" t decl.Ast.identifier
+      | None -> ()
+    ) fd.Ast.plist;
+  List.iter (fun (ptype, decl) ->
+      match get_stream_type ptype with
+      | Some _ ->
+        fprintf os "    memset(&_%s_stream, 0, sizeof(_%s_stream));\n"
+          decl.Ast.identifier decl.Ast.identifier
+      | None -> ()
+    ) fd.Ast.plist;
   fprintf os "    OE_ADD_SIZE(input_buffer_offset, sizeof(*pargs_in));\n";
   fprintf os "    OE_ADD_SIZE(output_buffer_offset, sizeof(*pargs_out));\n\n";
 
@@ -556,7 +600,7 @@ let oe_gen_ecall_function (os:out_channel) (fd: Ast.func_decl) =
   List.iter (fun (ptype, decl) ->
       match ptype with
       | Ast.PTPtr (atype, ptr_attr) ->
-        if ptr_attr.Ast.pa_chkptr then
+        if is_marshalled_ptr ptr_attr then
           let size = oe_get_param_size (ptype, decl, "pargs_in->") in
           match ptr_attr.Ast.pa_direction with
           | Ast.PtrIn -> fprintf os "    OE_SET_IN_POINTER(%s, %s);\n" decl.Ast.identifier size
@@ -573,7 +617,7 @@ let oe_gen_ecall_function (os:out_channel) (fd: Ast.func_decl) =
   List.iter (fun (ptype, decl) ->
       match ptype with
       | Ast.PTPtr (atype, ptr_attr) ->
-        if ptr_attr.Ast.pa_chkptr then
+        if is_marshalled_ptr ptr_attr then
           let size = oe_get_param_size (ptype, decl, "pargs_in->") in
           match ptr_attr.Ast.pa_direction with
           | Ast.PtrOut -> fprintf os "    OE_SET_OUT_POINTER(%s, %s);\n" decl.Ast.identifier size
@@ -584,6 +628,22 @@ let oe_gen_ecall_function (os:out_channel) (fd: Ast.func_decl) =
     ) fd.Ast.plist;
   fprintf os "\n";
 
+  (* Stream parameters are read from and written to host memory as the
+     function runs. *)
+  if List.exists (fun (ptype, _) -> get_stream_type ptype <> None) fd.Ast.plist then (
+    fprintf os "    /* Set up stream parameters */\n";
+    List.iter (fun (ptype, decl) ->
+        match ptype with
+        | Ast.PTPtr (_, ptr_attr) when ptr_attr.Ast.pa_isstream ->
+          let size = oe_get_param_size (ptype, decl, "pargs_in->") in
+          if ptr_attr.Ast.pa_direction = Ast.PtrOut then
+            fprintf os "    OE_SET_OUT_STREAM(%s, %s);\n" decl.Ast.identifier size
+          else
+            fprintf os "    OE_SET_IN_STREAM(%s, %s);\n" decl.Ast.identifier size
+        | _ -> ()
+      ) fd.Ast.plist;
+    fprintf os "\n");
+
   (* Call the enclave function *)
   fprintf os "    /* lfence after checks */\n";
   fprintf os "    oe_lfence();\n\n";
@@ -596,6 +656,12 @@ let oe_gen_ecall_function (os:out_channel) (fd: Ast.func_decl) =
   fprintf os "done:\n";
 
   (* oe_gen_free_buffers os fd; *)
+  List.iter (fun (ptype, decl) ->
+      match get_stream_type ptype with
+      | Some "oe_stream_reader_t" ->
+        fprintf os "    oe_stream_reader_free(&_%s_stream);\n" decl.Ast.identifier
+      | _ -> ()
+    ) fd.Ast.plist;
   fprintf os "    if (pargs_out && output_buffer_size >= sizeof(*pargs_out)) \n";
   fprintf os "        pargs_out->_result = _result;\n";
   fprintf os "}\n\n"
@@ -631,7 +697,8 @@ let gen_fill_marshal_struct (os:out_channel) (fd:Ast.func_decl)  (args:string) =
     ) fd.Ast.plist;
   fprintf os "\n"
 
-let oe_get_host_ecall_function (os:out_channel) (fd:Ast.func_decl) =
+let oe_get_host_ecall_function (os:out_channel) (tf:Ast.trusted_func) =
+  let fd = tf.Ast.tf_fdecl in
   fprintf os "%s" (oe_gen_wrapper_prototype fd true);
   fprintf os "\n";
   fprintf os "{\n";
@@ -651,9 +718,11 @@ let oe_get_host_ecall_function (os:out_channel) (fd:Ast.func_decl) =
   fprintf os "    /* Fill marshalling struct */\n";
   fprintf os "    memset(&_args, 0, sizeof(_args));\n";
   gen_fill_marshal_struct os fd "_args";
-  oe_prepare_input_buffer os fd "malloc";
+  oe_prepare_input_buffer os fd "oe_allocate_ecall_buffer";
   fprintf os "    /* Call enclave function */\n";
-  fprintf os "    if((_result = oe_call_enclave_function(\n";
+  fprintf os "    if((_result = %s(\n"
+    (if tf.Ast.tf_is_switchless then "oe_switchless_call_enclave_function"
+     else "oe_call_enclave_function");
   fprintf os "                        enclave,\n";
   fprintf os "                        %s,\n" (get_function_id fd);
   fprintf os "                        _input_buffer, _input_buffer_size,\n";
@@ -664,7 +733,117 @@ let oe_get_host_ecall_function (os:out_channel) (fd:Ast.func_decl) =
   fprintf os "    _result = OE_OK;\n";
   fprintf os "done:    \n";
   fprintf os "    if (_buffer)\n";
-  fprintf os "        free(_buffer);\n";
+  fprintf os "        oe_free_ecall_buffer(_buffer);\n";
+  fprintf os "    return _result;\n";
+  fprintf os "}\n\n"
+
+(** Batch wrappers are generated for ecalls whose parameters are all
+    passed by value, so that the args struct is the whole input and output
+    of a call. *)
+let is_batchable (fd: Ast.func_decl) =
+  List.for_all (fun (ptype, _) ->
+      match ptype with
+      | Ast.PTVal _ -> true
+      | Ast.PTPtr _ -> false
+    ) fd.Ast.plist
+
+(** Generate the prototype of the batch wrapper of an ecall. Each parameter
+    [T p] of the ecall becomes an array [const T* p] of [_count] values, and
+    [_retval] and [_results] receive the return value and the result of
+    each call. *)
+let oe_gen_batch_wrapper_prototype (fd: Ast.func_decl) =
+  let retval_str =
+    if fd.Ast.rtype = Ast.Void then ""
+    else sprintf "%s* _retval" (get_ret_tystr fd) in
+  let params = List.map (fun (ptype, decl) ->
+      sprintf "const %s* %s" (get_tystr (Ast.get_param_atype ptype))
+        decl.Ast.identifier
+    ) fd.Ast.plist in
+  let args =
+    ["oe_enclave_t* enclave"; "size_t _count"; retval_str;
+     "oe_result_t* _results"] @ params in
+  let args = List.filter (fun s-> s <> "") args
+  in
+  sprintf "oe_result_t %s_batch(\n        %s)" fd.Ast.fname (String.concat ",\n        " args)
+
+(** Generate the batch wrapper of an ecall, which makes [_count] calls of
+    the ecall in one enclave entry with
+    [oe_call_enclave_function_batch()]. *)
+let oe_gen_host_ecall_batch_function (os:out_channel) (tf:Ast.trusted_func) =
+  let fd = tf.Ast.tf_fdecl in
+  let arrays =
+    (if fd.Ast.rtype <> Ast.Void then ["_retval"] else []) @
+    ["_results"] @
+    List.map (fun (_, decl) -> decl.Ast.identifier) fd.Ast.plist in
+  fprintf os "%s" (oe_gen_batch_wrapper_prototype fd);
+  fprintf os "\n";
+  fprintf os "{\n";
+  fprintf os "    oe_result_t _result = OE_FAILURE;\n\n";
+  fprintf os "    /* Marshalling structs */ \n";
+  fprintf os "    %s_args_t *_pargs_in = NULL, *_pargs_out = NULL;\n\n" fd.Ast.fname;
+  fprintf os "    /* Calls and marshalling buffer */ \n";
+  fprintf os "    oe_enclave_function_call_t* _calls = NULL;\n";
+  fprintf os "    size_t _args_size = 0;\n";
+  fprintf os "    size_t _total_buffer_size = 0;\n";
+  fprintf os "    uint8_t* _buffer = NULL;\n";
+  fprintf os "    size_t _i;\n\n";
+  fprintf os "    if (_count && (%s)) {\n"
+    (String.concat " || " (List.map (fun a -> "!" ^ a) arrays));
+  fprintf os "        _result = OE_INVALID_PARAMETER;\n";
+  fprintf os "        goto done;\n";
+  fprintf os "    }\n\n";
+  fprintf os "    /* Allocate marshalling buffer: an input and an output args struct\n";
+  fprintf os "       per call, followed by the calls */\n";
+  fprintf os "    OE_ADD_SIZE(_args_size, sizeof(%s_args_t));\n" fd.Ast.fname;
+  fprintf os "    if (_count > OE_SIZE_MAX / (2 * _args_size + sizeof(*_calls))) {\n";
+  fprintf os "        _result = OE_INTEGER_OVERFLOW;\n";
+  fprintf os "        goto done;\n";
+  fprintf os "    }\n";
+  fprintf os "    _total_buffer_size = _count * (2 * _args_size + sizeof(*_calls));\n\n";
+  fprintf os "    _buffer = (uint8_t*) oe_allocate_ecall_buffer(_total_buffer_size ? _total_buffer_size : 1);\n";
+  fprintf os "    if (_buffer == NULL) { \n";
+  fprintf os "        _result = OE_OUT_OF_MEMORY;\n";
+  fprintf os "        goto done;\n";
+  fprintf os "    }\n\n";
+  fprintf os "    memset(_buffer, 0, _total_buffer_size);\n";
+  fprintf os "    *(uint8_t**)&_calls = _buffer + _count * 2 * _args_size;\n\n";
+  fprintf os "    /* Serialize the inputs of each call */\n";
+  fprintf os "    for (_i = 0; _i < _count; _i++) {\n";
+  fprintf os "        *(uint8_t**)&_pargs_in = _buffer + 2 * _i * _args_size;\n";
+  List.iter (fun (_, decl) ->
+      let varname = decl.Ast.identifier in
+      fprintf os "        _pargs_in->%s = %s[_i];\n" varname varname
+    ) fd.Ast.plist;
+  fprintf os "        _calls[_i].function_id = %s;\n" (get_function_id fd);
+  fprintf os "        _calls[_i].input_buffer = _pargs_in;\n";
+  fprintf os "        _calls[_i].input_buffer_size = _args_size;\n";
+  fprintf os "        _calls[_i].output_buffer = (uint8_t*)_pargs_in + _args_size;\n";
+  fprintf os "        _calls[_i].output_buffer_size = _args_size;\n";
+  fprintf os "    }\n\n";
+  fprintf os "    /* Call enclave functions */\n";
+  fprintf os "    if ((_result = oe_call_enclave_function_batch(\n";
+  fprintf os "                        enclave, _calls, _count)) != OE_OK)\n";
+  fprintf os "        goto done;\n\n";
+  fprintf os "    /* Unmarshal the result and return value of each call */\n";
+  fprintf os "    for (_i = 0; _i < _count; _i++) {\n";
+  fprintf os "        *(uint8_t**)&_pargs_out = (uint8_t*)_calls[_i].output_buffer;\n";
+  fprintf os "        if ((_results[_i] = _calls[_i].result) != OE_OK)\n";
+  fprintf os "            continue;\n";
+  fprintf os "        /* Currently exactly _args_size bytes must be written */\n";
+  fprintf os "        if (_calls[_i].output_bytes_written != _args_size) {\n";
+  fprintf os "            _results[_i] = OE_FAILURE;\n";
+  fprintf os "            continue;\n";
+  fprintf os "        }\n";
+  (if fd.Ast.rtype <> Ast.Void then (
+     fprintf os "        if ((_results[_i] = _pargs_out->_result) == OE_OK)\n";
+     fprintf os "            _retval[_i] = _pargs_out->_retval;\n")
+   else
+     fprintf os "        _results[_i] = _pargs_out->_result;\n");
+  fprintf os "    }\n\n";
+  fprintf os "    _result = OE_OK;\n";
+  fprintf os "done:    \n";
+  fprintf os "    if (_buffer)\n";
+  fprintf os "        oe_free_ecall_buffer(_buffer);\n";
   fprintf os "    return _result;\n";
   fprintf os "}\n\n"
 
@@ -704,7 +883,9 @@ let oe_gen_ocall_enclave_wrapper (os:out_channel) (uf:Ast.untrusted_func) =
   gen_fill_marshal_struct os fd "_args";
   oe_prepare_input_buffer os fd "oe_allocate_ocall_buffer";
   fprintf os "    /* Call host function */\n";
-  fprintf os "    if((_result = oe_call_host_function(\n";
+  fprintf os "    if((_result = %s(\n"
+    (if uf.Ast.uf_is_switchless then "oe_switchless_call_host_function"
+     else "oe_call_host_function");
   fprintf os "                        %s,\n" (get_function_id fd);
   fprintf os "                        _input_buffer, _input_buffer_size,\n";
   fprintf os "                        _output_buffer, _output_buffer_size,\n";
@@ -916,8 +1097,15 @@ let validate_oe_support (ec: enclave_content) (ep: edger8r_params) =
   List.iter (fun f ->
       (if f.Ast.tf_is_priv then
          failwithf "Function '%s': 'private' specifier is not supported by oeedger8r" f.Ast.tf_fdecl.fname);
-      (if f.Ast.tf_is_switchless then
-         failwithf "Function '%s': switchless ecalls and ocalls are not yet supported by Open Enclave SDK." f.Ast.tf_fdecl.fname);
+      List.iter (fun (ptype, decl) ->
+          match ptype with
+          | Ast.PTPtr (_, pa) when pa.Ast.pa_isstream ->
+            (if pa.Ast.pa_direction <> Ast.PtrIn && pa.Ast.pa_direction <> Ast.PtrOut then
+               failwithf "Function '%s': stream parameter '%s' must be either 'in' or 'out'." f.Ast.tf_fdecl.fname decl.Ast.identifier);
+            (if pa.Ast.pa_isstr || pa.Ast.pa_iswstr || (pa.Ast.pa_size.Ast.ps_size = None && pa.Ast.pa_size.Ast.ps_count = None) then
+               failwithf "Function '%s': stream parameter '%s' must have a 'size' or 'count'." f.Ast.tf_fdecl.fname decl.Ast.identifier)
+          | _ -> ()
+        ) f.Ast.tf_fdecl.Ast.plist;
     ) ec.tfunc_decls;
   List.iter (fun f ->
       (if f.Ast.uf_fattr.fa_convention <> Ast.CC_NONE then
@@ -927,8 +1115,8 @@ let validate_oe_support (ec: enclave_content) (ep: edger8r_params) =
          failwithf "Function '%s': dllimport is not supported by oeedger8r." f.Ast.uf_fdecl.fname);
       (if f.Ast.uf_allow_list != [] then
          printf "Warning: Function '%s': Reentrant ocalls are not supported by Open Enclave. Allow list ignored.\n" f.Ast.uf_fdecl.fname);
-      (if f.Ast.uf_is_switchless then
-         failwithf "Function '%s': switchless ecalls and ocalls are not yet supported by Open Enclave SDK." f.Ast.uf_fdecl.fname);
+      (if List.exists (fun (ptype, _) -> get_stream_type ptype <> None) f.Ast.uf_fdecl.Ast.plist then
+         failwithf "Function '%s': stream parameters are only supported for ecalls." f.Ast.uf_fdecl.fname);
     ) ec.ufunc_decls;
   (* Map warning functions over trusted and untrusted function
      declarations *)
@@ -954,7 +1142,7 @@ let gen_t_h (ec: enclave_content) (ep: edger8r_params) =
   fprintf os "OE_EXTERNC_BEGIN\n\n";
   if ec.tfunc_decls <> [] then (
     fprintf os "/* List of ecalls */\n\n";
-    List.iter (fun f -> fprintf os "%s;\n" (oe_gen_prototype f.Ast.tf_fdecl)) ec.tfunc_decls;
+    List.iter (fun f -> fprintf os "%s;\n" (oe_gen_trusted_prototype f.Ast.tf_fdecl)) ec.tfunc_decls;
     fprintf os "\n");
   if ec.ufunc_decls <> [] then (
     fprintf os "/* List of ocalls */\n\n";
@@ -1026,7 +1214,12 @@ let gen_u_h (ec: enclave_content) (ep: edger8r_params) =
   if ec.tfunc_decls <> [] then (
     fprintf os "/* List of ecalls */\n\n";
     List.iter (fun f -> fprintf os "%s;\n" (oe_gen_wrapper_prototype f.Ast.tf_fdecl true)) ec.tfunc_decls;
-    fprintf os "\n");
+    fprintf os "\n";
+    let batchable = List.filter (fun f -> is_batchable f.Ast.tf_fdecl) ec.tfunc_decls in
+    if batchable <> [] then (
+      fprintf os "/* Batch wrappers of ecalls (see oe_call_enclave_function_batch) */\n\n";
+      List.iter (fun f -> fprintf os "%s;\n" (oe_gen_batch_wrapper_prototype f.Ast.tf_fdecl)) batchable;
+      fprintf os "\n"));
   if ec.ufunc_decls <> [] then (
     fprintf os "/* List of ocalls */\n\n";
     List.iter (fun d -> fprintf os"%s;\n" (oe_gen_prototype d.Ast.uf_fdecl))  ec.ufunc_decls;
@@ -1047,7 +1240,11 @@ let gen_u_c (ec: enclave_content) (ep: edger8r_params) =
   fprintf os "OE_EXTERNC_BEGIN\n\n";
   if ec.tfunc_decls <> [] then (
     fprintf os "/* Wrappers for ecalls */\n\n";
-    List.iter (fun d -> oe_get_host_ecall_function os d.Ast.tf_fdecl; fprintf os "\n\n")  ec.tfunc_decls);
+    List.iter (fun d -> oe_get_host_ecall_function os d; fprintf os "\n\n")  ec.tfunc_decls;
+    List.iter (fun d ->
+        if is_batchable d.Ast.tf_fdecl then (
+          oe_gen_host_ecall_batch_function os d; fprintf os "\n\n")
+      ) ec.tfunc_decls);
   if ec.ufunc_decls <> [] then (
     fprintf os "\n/* ocall functions */\n\n";
     List.iter (fun d -> oe_gen_ocall_host_wrapper os d) ec.ufunc_decls);